@@ -0,0 +1,49 @@
+/*
+ * @Description: Velodyne cloud transformation and projection into the camera image, shared by the players and the benchmark
+ * @References:
+ */
+#pragma once
+
+// C++
+#include <string>
+// Eigen
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+// OpenCV
+#include <opencv2/core/core.hpp>
+// PCL
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
+namespace kitti_utils {
+
+/**
+ * @brief Transform of TransformKittiCloud: rotation by 90 deg around z (x to the left, y forward), optionally
+ *        lifted by z_shift_value so that the ground is at z = 0
+ */
+Eigen::Affine3f GetKittiCloudTransform(bool do_z_shift = false, float z_shift_value = 1.73);
+
+/**
+ * @brief Rotate a velodyne cloud by GetKittiCloudTransform
+ * @return a new cloud
+ */
+pcl::PointCloud<pcl::PointXYZI>::Ptr TransformKittiCloud(pcl::PointCloud<pcl::PointXYZI>::Ptr kitti_cloud,
+                                                         bool do_z_shift = false, float z_shift_value = 1.73);
+
+/**
+ * @brief Rotate a loaded velodyne cloud by GetKittiCloudTransform in one pass into transformed_cloud,
+ *        whose points are reused, keep it alive between frames
+ */
+void TransformKittiCloud(const pcl::PointCloud<pcl::PointXYZI>& kitti_cloud,
+                         pcl::PointCloud<pcl::PointXYZI>& transformed_cloud,
+                         bool do_z_shift = false, float z_shift_value = 1.73);
+
+/**
+ * @brief Draw the points in front of the vehicle (y >= 0, cloud of TransformKittiCloud) on a copy of the
+ *        image, colored by distance
+ * @param projectmatrix 3x4 from cloud coordinates to image pixels
+ */
+cv::Mat ProjectCloud2Image(const pcl::PointCloud<pcl::PointXYZI>::ConstPtr cloudIn, const cv::Mat& imageIn,
+                           const Eigen::MatrixXf& projectmatrix);
+
+} // namespace kitti_utils
@@ -0,0 +1,37 @@
+/*
+ * @Description: Whole file reading shared by the image decoding and the OXTS parsing
+ * @References:
+ */
+#pragma once
+
+// C++
+#include <cstdio>
+#include <string>
+
+namespace kitti_utils {
+
+/**
+ * @brief Read the whole file into content, a std::string or std::vector<uchar>. The capacity of content is kept
+ *        between calls, so reuse it to avoid allocations. An empty file gives an empty content.
+ * @return false if the file cannot be opened or read
+ */
+template <class Buffer>
+bool ReadFile(const std::string& filename, Buffer& content) {
+  static_assert(sizeof(typename Buffer::value_type) == 1, "ReadFile reads bytes");
+  FILE* file = std::fopen(filename.c_str(), "rb");
+  if (!file) {
+    return false;
+  }
+  std::fseek(file, 0, SEEK_END);
+  long size = std::ftell(file);
+  std::fseek(file, 0, SEEK_SET);
+  bool ok = size >= 0;
+  if (ok) {
+    content.resize(size);
+    ok = size == 0 || std::fread(&content[0], 1, size, file) == static_cast<size_t>(size);
+  }
+  std::fclose(file);
+  return ok;
+}
+
+} // namespace kitti_utils
@@ -0,0 +1,87 @@
+/*
+ * @Description: Per stage latency and per frame deadline statistics of a player
+ * @References:
+ */
+#pragma once
+
+// C++
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+// ROS
+#include <diagnostic_msgs/DiagnosticStatus.h>
+
+#include "kitti_common/latency_histogram.h"
+
+namespace kitti_utils {
+
+/**
+ * @brief Record the time spent in each stage of a player (file read, decode, publish, sleep...)
+ *        and the processing time of each frame against a deadline, usually the frame period.
+ *        The latencies go to a histogram per stage covering the whole playback, printed at the
+ *        end, and to a window histogram reported and reset by FillStatus(), which the player
+ *        publishes periodically on /diagnostics. Used from the player thread only.
+ *
+ *          int read = profiler.AddStage("cloud read");
+ *          { FrameProfiler::Timer timer(profiler, read); ... }
+ */
+class FrameProfiler {
+public:
+  /// Time a scope into a stage
+  class Timer {
+  public:
+    Timer(FrameProfiler& profiler, int stage)
+        : profiler_(profiler), stage_(stage), start_(std::chrono::steady_clock::now()) {}
+    ~Timer() {
+      profiler_.Record(stage_, std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count());
+    }
+
+  private:
+    FrameProfiler& profiler_;
+    int stage_;
+    std::chrono::steady_clock::time_point start_;
+  };
+
+  /**
+   * @param name name of the diagnostic status, e.g. the node name
+   * @param source played data, reported as the hardware id, e.g. the sequence
+   * @param deadline frames processed in more than deadline (s) are counted as missed, 0 to disable
+   */
+  FrameProfiler(const std::string& name, const std::string& source, double deadline);
+
+  /// Register a stage, returns its index for Record()
+  int AddStage(const std::string& name);
+
+  /// Record the duration (s) of a stage
+  void Record(int stage, double seconds);
+
+  /// Record the processing time (s) of a frame, the sleep until the next one excluded
+  void RecordFrame(unsigned int frame, double seconds);
+
+  /// Fill the statistics since the previous call and start a new window
+  void FillStatus(diagnostic_msgs::DiagnosticStatus& status);
+
+  /// Log the latency percentiles of each stage and the deadline misses of the whole playback
+  void PrintSummary() const;
+
+private:
+  struct Stage {
+    std::string name;
+    LatencyHistogram window;
+    LatencyHistogram total;
+  };
+
+  std::string name_;
+  std::string source_;
+  double deadline_;
+  std::vector<Stage> stages_;
+  LatencyHistogram frames_;
+  LatencyHistogram window_frames_;
+  uint64_t missed_;
+  uint64_t window_missed_;
+  unsigned int worst_frame_;
+  std::chrono::steady_clock::time_point window_start_;
+};
+
+} // namespace kitti_utils
@@ -0,0 +1,77 @@
+/*
+ * @Description: Memory mapped file keeping the decoded images of a sequence, to replay it without PNG decoding
+ * @References:
+ */
+#pragma once
+
+// C++
+#include <cstdint>
+#include <string>
+#include <vector>
+// OpenCV
+#include <opencv2/core/core.hpp>
+
+namespace kitti_utils {
+
+/**
+ * @brief Per-sequence cache of decoded images (BGR8, mono8...), stored uncompressed in a memory
+ *        mapped file. Every camera has a fixed-size slot for every frame and a valid flag, the
+ *        cache is filled while the sequence is played the first time and used on next replays.
+ *
+ *        File layout: header, camera descriptions, valid flags (one byte per frame and camera),
+ *        then the images of each camera, frame after frame, starting on page boundaries.
+ *
+ *        Different (frame, camera) slots can be read and stored from different threads.
+ */
+class ImageCache {
+public:
+  struct CameraFormat {
+    std::string name;  // e.g. "image_02", at most 31 characters
+    int rows;
+    int cols;
+    int type;  // OpenCV type, e.g. CV_8UC3
+  };
+
+  ImageCache();
+  ~ImageCache();
+
+  /**
+   * @brief Map the cache file, it is created (again) if missing or made for other images
+   * @param num_frames number of frames of the sequence
+   * @return false if the file can not be created or mapped
+   */
+  bool Open(const std::string& filename, unsigned int num_frames, const std::vector<CameraFormat>& cameras);
+
+  void Close();
+
+  bool IsOpen() const { return data_ != NULL; }
+
+  /// Image already in the cache
+  bool Contains(unsigned int frame, int camera) const;
+
+  /// Image header on the mapped memory, must not be modified
+  cv::Mat Image(unsigned int frame, int camera) const;
+
+  /**
+   * @brief Copy image into the cache
+   * @return false if the image does not match the camera format
+   */
+  bool Store(unsigned int frame, int camera, const cv::Mat& image);
+
+  /// Number of cached images
+  unsigned int NumCached() const;
+
+private:
+  size_t ImageSize(int camera) const;
+
+  std::string filename_;
+  unsigned int num_frames_;
+  std::vector<CameraFormat> cameras_;
+  std::vector<uint64_t> offsets_;  // first image of every camera in the file
+
+  uint8_t* data_;    // mapped file
+  size_t size_;      // mapped size
+  uint8_t* valid_;   // valid flags, frame * cameras + camera
+};
+
+} // namespace kitti_utils
@@ -0,0 +1,142 @@
+/*
+ * @Description: Worker pool decoding the camera images of the upcoming frames in parallel
+ * @References:
+ */
+#pragma once
+
+// C++
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+// OpenCV
+#include <opencv2/core/core.hpp>
+
+#include "kitti_common/image_cache.h"
+
+namespace kitti_utils {
+
+/**
+ * @brief Decode the images of all cameras of the next frames ahead of the player.
+ *        Every camera of every frame is a separate job, so the PNG decoding of a frame is
+ *        spread over all workers. Decoded images live in a ring of frame slots whose
+ *        cv::Mat buffers are reused, after the first frames no memory is allocated.
+ *
+ *        Frames must be requested in increasing order, as the players do:
+ *          pool.Start(first, end);
+ *          for (frame...) { pool.WaitFrame(frame); use pool.Image(frame, cam); pool.ReleaseFrame(frame); }
+ */
+class ImageDecodePool {
+public:
+  /**
+   * @param num_threads number of decoding threads
+   * @param depth number of frames decoded ahead of the player (frame slots)
+   */
+  ImageDecodePool(unsigned int num_threads, unsigned int depth);
+  ~ImageDecodePool();
+
+  /**
+   * @brief Register a camera before Start()
+   * @param name camera name used in the statistics, e.g. "image_02"
+   * @param filename_format boost::format string with the frame number, e.g. "/data/image_02/data/%010d.png"
+   * @param imread_flags flags given to cv::imdecode, e.g. CV_LOAD_IMAGE_UNCHANGED
+   * @return camera index used in Image()
+   */
+  int AddCamera(const std::string& name, const std::string& filename_format, int imread_flags);
+
+  unsigned int NumCameras() const { return cameras_.size(); }
+
+  /**
+   * @brief Keep the decoded images in a memory mapped cache file, call before Start().
+   *        Images already in the cache are not decoded, the others are stored once decoded.
+   */
+  void EnableCache(const std::string& cache_filename);
+
+  /// Start decoding the frames [first_frame, end_frame)
+  void Start(unsigned int first_frame, unsigned int end_frame);
+
+  /**
+   * @brief Block until all cameras of frame are decoded
+   * @return false if one image could not be read or the pool is stopped
+   */
+  bool WaitFrame(unsigned int frame);
+
+  /// Decoded image, valid until ReleaseFrame(frame)
+  const cv::Mat& Image(unsigned int frame, int camera) const;
+
+  /// Filename of the image, for error messages
+  std::string Filename(unsigned int frame, int camera) const;
+
+  /// Give the slot of frame back to the workers, they start decoding frame + depth. The frame may be
+  /// released without WaitFrame() when its images are not used.
+  void ReleaseFrame(unsigned int frame);
+
+  /**
+   * @brief Decode ahead of the player (default) or not. When disabled the workers skip the frames
+   *        instead of decoding them, a skipped frame is decoded by WaitFrame() if it is needed anyway.
+   */
+  void SetPrefetch(bool prefetch);
+
+  /// Stop the workers, pending and future WaitFrame() return false
+  void Stop();
+
+  /// Log the decoding time per camera
+  void PrintStats() const;
+
+private:
+  struct Camera {
+    std::string name;
+    std::string filename_format;
+    int imread_flags;
+    // Statistics, protected by mutex_
+    uint64_t decoded;
+    uint64_t failed;
+    uint64_t skipped;
+    double decode_time_sum;  // s
+    double decode_time_max;  // s
+    uint64_t cache_hits;
+    double cache_time_sum;   // s
+  };
+
+  struct Slot {
+    unsigned int frame;
+    unsigned int pending;  // jobs not yet finished
+    bool failed;
+    std::vector<cv::Mat> images;  // one per camera, reused
+    std::vector<uint8_t> from_cache;  // image points into the cache memory, per camera
+    std::vector<uint8_t> skipped;  // not decoded while prefetch was disabled, per camera
+  };
+
+  struct Job {
+    unsigned int slot;
+    int camera;
+    bool needed;  // requested by WaitFrame(), decoded even without prefetch
+  };
+
+  /// Assign frame to its slot and queue its jobs, called with the lock held
+  void ScheduleFrame(unsigned int frame);
+  void WorkerLoop();
+  /// Map the cache file, the image formats are taken from the images of first_frame
+  bool OpenCache(unsigned int first_frame, unsigned int end_frame);
+
+  unsigned int num_threads_;
+  unsigned int depth_;
+  std::vector<Camera> cameras_;
+  std::vector<Slot> slots_;
+  unsigned int end_frame_;
+  std::string cache_filename_;
+  ImageCache cache_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable jobs_cond_;  // workers wait for jobs
+  std::condition_variable done_cond_;  // player waits for decoded frames
+  std::deque<Job> jobs_;
+  bool stopped_;
+  bool prefetch_;
+  std::vector<std::thread> workers_;
+};
+
+} // namespace kitti_utils
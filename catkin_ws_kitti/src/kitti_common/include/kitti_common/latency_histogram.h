@@ -0,0 +1,52 @@
+/*
+ * @Description: Latency histogram with a bounded relative error, in the spirit of HdrHistogram
+ * @References: http://hdrhistogram.org/
+ */
+#pragma once
+
+// C++
+#include <cstdint>
+#include <vector>
+
+namespace kitti_utils {
+
+/**
+ * @brief Histogram of durations recorded in nanoseconds. Every power of two range is split in
+ *        64 linear buckets, so percentiles are within 1.6% of the recorded values from 1 us to
+ *        hours, with a fixed memory of 20 KB and O(1) recording. Not thread safe.
+ */
+class LatencyHistogram {
+public:
+  LatencyHistogram();
+
+  /// Record a duration (s), negative durations are recorded as 0
+  void Record(double seconds);
+
+  /// Add the recorded values of other
+  void Merge(const LatencyHistogram& other);
+
+  void Reset();
+
+  uint64_t Count() const { return count_; }
+
+  /// Statistics (s), 0 without recorded value
+  double Min() const;
+  double Max() const;
+  double Mean() const;
+
+  /// Value (s) below or equal to which percentile % of the recorded values are, e.g. 99.0
+  double Percentile(double percentile) const;
+
+private:
+  static int BucketIndex(uint64_t value);
+  /// Highest value of a bucket
+  static uint64_t BucketValue(int index);
+
+  std::vector<uint64_t> counts_;
+  uint64_t count_;
+  uint64_t min_;  // ns
+  uint64_t max_;  // ns
+  double sum_;    // ns
+};
+
+} // namespace kitti_utils
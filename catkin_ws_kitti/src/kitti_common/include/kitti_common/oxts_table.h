@@ -0,0 +1,135 @@
+/*
+ * @Description: All the OXTS records of a sequence, parsed once into a table of doubles
+ * @References: KITTI raw data devkit, dataformat.txt of the oxts folder
+ *              http://www.uwgb.edu/dutchs/UsefulData/ConvertUTMNoOZ.HTM
+ */
+#pragma once
+
+// C++
+#include <string>
+#include <vector>
+// Eigen
+#include <Eigen/Core>
+// ROS
+#include <tf/LinearMath/Quaternion.h>
+
+namespace kitti_utils {
+
+/// Cartesian coordinates struct, refs# 522
+struct Xy {
+  double x;
+  double y;
+};
+
+/** Conversion between geographic (WGS 84, deg) and UTM coordinates (m)
+    Adapted from:  http://www.uwgb.edu/dutchs/UsefulData/ConvertUTMNoOZ.HTM
+    Refs# 522
+**/
+Xy LatLon2Xy(double lat, double lngd);
+
+/**
+ * @brief LatLon2Xy for a whole sequence at once, evaluated with Eigen array expressions
+ *        so that the series expansions are vectorized over all the points
+ * @param lat, lngd input coordinates (deg)
+ * @param x, y output UTM coordinates (m), same size as the input
+ */
+void LatLon2Xy(const Eigen::Ref<const Eigen::ArrayXd>& lat, const Eigen::Ref<const Eigen::ArrayXd>& lngd,
+               Eigen::Ref<Eigen::ArrayXd> x, Eigen::Ref<Eigen::ArrayXd> y);
+
+/**
+ * @brief OXTS (GPS/IMU) records of a sequence, 30 doubles per frame, loaded once before playing
+ *        so that GPS, IMU and pose messages are filled without any file access.
+ *        Values are stored column by column (one array per field), with the UTM position and
+ *        the orientation quaternion of every frame computed at load time.
+ */
+class OxtsTable {
+public:
+  /// Columns of an OXTS record, in file order
+  enum Field {
+    kLat = 0,      // latitude of the oxts-unit (deg)
+    kLon,          // longitude of the oxts-unit (deg)
+    kAlt,          // altitude of the oxts-unit (m)
+    kRoll,         // roll angle (rad),  0 = level, positive = left side up (-pi..pi)
+    kPitch,        // pitch angle (rad), 0 = level, positive = front down (-pi/2..pi/2)
+    kYaw,          // heading (rad),     0 = east,  positive = counter clockwise (-pi..pi)
+    kVn,           // velocity towards north (m/s)
+    kVe,           // velocity towards east (m/s)
+    kVf,           // forward velocity, i.e. parallel to earth-surface (m/s)
+    kVl,           // leftward velocity, i.e. parallel to earth-surface (m/s)
+    kVu,           // upward velocity, i.e. perpendicular to earth-surface (m/s)
+    kAx,           // acceleration in x, i.e. in direction of vehicle front (m/s^2)
+    kAy,           // acceleration in y, i.e. in direction of vehicle left (m/s^2)
+    kAz,           // acceleration in z, i.e. in direction of vehicle top (m/s^2)
+    kAf,           // forward acceleration (m/s^2)
+    kAl,           // leftward acceleration (m/s^2)
+    kAu,           // upward acceleration (m/s^2)
+    kWx,           // angular rate around x (rad/s)
+    kWy,           // angular rate around y (rad/s)
+    kWz,           // angular rate around z (rad/s)
+    kWf,           // angular rate around forward axis (rad/s)
+    kWl,           // angular rate around leftward axis (rad/s)
+    kWu,           // angular rate around upward axis (rad/s)
+    kPosAccuracy,  // position accuracy (north/east in m)
+    kVelAccuracy,  // velocity accuracy (north/east in m/s)
+    kNavStat,      // navigation status
+    kNumSats,      // number of satellites tracked by primary GPS receiver
+    kPosMode,      // position mode of primary GPS receiver
+    kVelMode,      // velocity mode of primary GPS receiver
+    kOriMode,      // orientation mode of primary GPS receiver
+    kNumFields
+  };
+
+  OxtsTable() {}
+
+  /**
+   * @brief Load the raw dataset records, one file per frame: <dir>/%010d.txt
+   * @param num_frames number of files to load, from frame 0
+   * @return false if a file is missing or not a complete record
+   */
+  bool LoadRawDirectory(const std::string& dir, unsigned int num_frames);
+
+  /**
+   * @brief Load a tracking dataset file, one record per line
+   * @return false if the file can not be read or a line is not a complete record
+   */
+  bool LoadFile(const std::string& filename);
+
+  unsigned int size() const { return columns_[kLat].size(); }
+  bool empty() const { return columns_[kLat].empty(); }
+
+  double Get(unsigned int frame, Field field) const { return columns_[field][frame]; }
+
+  /// All the values of a field, frame after frame
+  const std::vector<double>& Column(Field field) const { return columns_[field]; }
+
+  /// UTM position of the oxts-unit (m)
+  double UtmX(unsigned int frame) const { return utm_x_[frame]; }
+  double UtmY(unsigned int frame) const { return utm_y_[frame]; }
+
+  /// Orientation from roll, pitch and yaw
+  tf::Quaternion Orientation(unsigned int frame) const {
+    return tf::Quaternion(qx_[frame], qy_[frame], qz_[frame], qw_[frame]);
+  }
+
+private:
+  void Clear(unsigned int capacity);
+
+  /**
+   * @brief Parse one record from [begin, end) and append it to the table
+   * @return pointer after the parsed record, NULL if less than kNumFields numbers
+   */
+  const char* ParseRecord(const char* begin, const char* end);
+
+  /// Fill the UTM and quaternion arrays once all records are parsed
+  void ComputeDerived();
+
+  std::vector<double> columns_[kNumFields];
+  std::vector<double> utm_x_;
+  std::vector<double> utm_y_;
+  std::vector<double> qx_;
+  std::vector<double> qy_;
+  std::vector<double> qz_;
+  std::vector<double> qw_;
+};
+
+} // namespace kitti_utils
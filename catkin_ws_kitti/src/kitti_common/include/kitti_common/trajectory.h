@@ -0,0 +1,71 @@
+/*
+ * @Description: Ego poses of a whole sequence in a local metric frame, computed once from the OXTS records
+ * @References:
+ */
+#pragma once
+
+// C++
+#include <vector>
+// Eigen
+#include <Eigen/Geometry>
+#include <Eigen/StdVector>
+// ROS
+#include <ros/time.h>
+
+#include "kitti_common/oxts_table.h"
+
+namespace kitti_utils {
+
+/**
+ * @brief Pose of the oxts-unit for every frame, relative to the position of an origin frame:
+ *        x east and y north in UTM (m), z altitude (m), absolute orientation from roll, pitch and yaw.
+ *        Built once when the sequence is loaded, the players only look poses up.
+ *        With the frame timestamps set, poses can be interpolated at any time, e.g. the
+ *        timestamp of a velodyne scan which is not the one of the oxts record.
+ */
+class Trajectory {
+public:
+  typedef std::vector<Eigen::Isometry3d, Eigen::aligned_allocator<Eigen::Isometry3d> > PoseVector;
+
+  Trajectory() : origin_(Eigen::Vector3d::Zero()) {}
+
+  /**
+   * @brief Compute the poses of all the frames of oxts
+   * @param origin_frame frame whose position becomes the origin of the local frame
+   * @return false if oxts has no record for origin_frame
+   */
+  bool Build(const OxtsTable& oxts, unsigned int origin_frame);
+
+  /**
+   * @brief Set the timestamp of every frame, needed by Interpolate(). Timestamps after the last
+   *        pose are ignored, like the extra lines of a KITTI timestamps.txt
+   * @return false if there are fewer timestamps than poses
+   */
+  bool SetStamps(const std::vector<ros::Time>& stamps);
+
+  unsigned int size() const { return poses_.size(); }
+  bool empty() const { return poses_.empty(); }
+  bool HasStamps() const { return !stamps_.empty(); }
+
+  const Eigen::Isometry3d& Pose(unsigned int frame) const { return poses_[frame]; }
+  const PoseVector& Poses() const { return poses_; }
+
+  /// UTM position and altitude of the origin (m)
+  const Eigen::Vector3d& Origin() const { return origin_; }
+
+  /**
+   * @brief Pose at stamp, linear interpolation of the position and slerp of the orientation
+   *        between the two surrounding frames. Clamped to the first and last pose outside
+   *        the sequence. Needs the timestamps, see SetStamps().
+   */
+  Eigen::Isometry3d Interpolate(const ros::Time& stamp) const;
+  /// Pose at t (s), for the times a ros::Time cannot hold, e.g. before the first frame stamped 0
+  Eigen::Isometry3d Interpolate(double t) const;
+
+private:
+  PoseVector poses_;
+  std::vector<double> stamps_;  // s, one per pose
+  Eigen::Vector3d origin_;
+};
+
+} // namespace kitti_utils
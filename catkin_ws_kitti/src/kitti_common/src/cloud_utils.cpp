@@ -0,0 +1,101 @@
+/*
+ * @Description: Velodyne cloud transformation and projection into the camera image, shared by the players and the benchmark
+ * @References:
+ */
+
+#include "kitti_common/cloud_utils.h"
+
+#include <cmath>
+#include <iostream>
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <pcl/common/transforms.h>
+
+namespace kitti_utils {
+
+namespace {
+template <class PointT>
+bool ProjectPoint2Image(const PointT& pointIn, const Eigen::MatrixXf& projectmatrix, cv::Point2f& point_project) {
+  //check project matrix size
+  if (!(projectmatrix.rows() == 3 && projectmatrix.cols() == 4)) {
+    std::cout << "[WARN] project matrix size need be 3x4!" << std::endl;
+    return false;
+  }
+
+  //apply the projection operation
+  Eigen::Vector4f point_3d(pointIn.x, pointIn.y, pointIn.z, 1.0);  //define homogenious coordniate
+  Eigen::Vector3f point_temp = projectmatrix * point_3d;
+  //get image coordinates
+  float x = static_cast<float>(point_temp[0] / point_temp[2]);
+  float y = static_cast<float>(point_temp[1] / point_temp[2]);
+  point_project = cv::Point2f(x, y);
+  return true;
+}
+}
+
+Eigen::Affine3f GetKittiCloudTransform(bool do_z_shift, float z_shift_value) {
+  Eigen::Affine3f transform_matrix = Eigen::Affine3f::Identity();
+  // Define translation
+  if (do_z_shift)
+    transform_matrix.translation() << 0.0, 0.0, z_shift_value;
+  else
+    transform_matrix.translation() << 0.0, 0.0, 0.0;
+  // The same rotation matrix as before; theta radians around Z axis
+  transform_matrix.rotate(Eigen::AngleAxisf(M_PI / 2, Eigen::Vector3f::UnitZ()));
+  return transform_matrix;
+}
+
+pcl::PointCloud<pcl::PointXYZI>::Ptr TransformKittiCloud(pcl::PointCloud<pcl::PointXYZI>::Ptr kitti_cloud, bool do_z_shift, float z_shift_value) {
+  // Executing the transformation
+  pcl::PointCloud<pcl::PointXYZI>::Ptr transformed_cloud(new pcl::PointCloud<pcl::PointXYZI>());
+  pcl::transformPointCloud(*kitti_cloud, *transformed_cloud, GetKittiCloudTransform(do_z_shift, z_shift_value));
+  return transformed_cloud;
+}
+
+void TransformKittiCloud(const pcl::PointCloud<pcl::PointXYZI>& kitti_cloud, pcl::PointCloud<pcl::PointXYZI>& transformed_cloud, bool do_z_shift, float z_shift_value) {
+  // Same kernel as ReadVeloPoints, the padding after z is multiplied by the zero column of A
+  const Eigen::Affine3f transform = GetKittiCloudTransform(do_z_shift, z_shift_value);
+  Eigen::Matrix4f A = Eigen::Matrix4f::Zero();
+  A.topLeftCorner<3, 3>() = transform.linear();
+  Eigen::Vector4f b;
+  b << transform.translation(), 1.0f;
+
+  const size_t num_points = kitti_cloud.points.size();
+  transformed_cloud.header = kitti_cloud.header;
+  transformed_cloud.points.resize(num_points);
+  for (size_t i = 0; i < num_points; ++i) {
+    const pcl::PointXYZI& in = kitti_cloud.points[i];
+    pcl::PointXYZI& out = transformed_cloud.points[i];
+    out.getVector4fMap() = A * Eigen::Map<const Eigen::Vector4f>(&in.x) + b;
+    out.intensity = in.intensity;
+  }
+  transformed_cloud.width = kitti_cloud.width;
+  transformed_cloud.height = kitti_cloud.height;
+  transformed_cloud.is_dense = kitti_cloud.is_dense;
+}
+
+cv::Mat ProjectCloud2Image(const pcl::PointCloud<pcl::PointXYZI>::ConstPtr cloudIn, const cv::Mat& imageIn, const Eigen::MatrixXf& projectmatrix) {
+  cv::Mat hsv_image, res_image;
+  cv::cvtColor(imageIn, hsv_image, CV_BGR2HSV);
+  int scale = 120, min_dis = 1, max_dis = 70;
+  auto toColor = [&](const pcl::PointXYZI& point) -> int {
+    //1)calculate point distance
+    float distance = std::sqrt(point.x * point.x + point.y * point.y + point.z * point.z);
+    //2)calculate color value, normalize values to (0 - scale) & close distance value has low value.
+    int res = ((distance - min_dis) / (max_dis - min_dis)) * scale;
+    return res;
+  };
+  // plot color points using distance encode HSV color
+  for (size_t i = 0; i < cloudIn->size(); ++i) {
+    if (cloudIn->points[i].y < 0)
+      continue;
+    int color = toColor(cloudIn->points[i]);
+    cv::Point2f image_point;
+    ProjectPoint2Image(cloudIn->points[i], projectmatrix, image_point);
+    cv::circle(hsv_image, image_point, 2, cv::Scalar(color, 255, 255), -1);
+  }
+  cv::cvtColor(hsv_image, res_image, CV_HSV2BGR);
+  return res_image;
+}
+
+} // namespace kitti_utils
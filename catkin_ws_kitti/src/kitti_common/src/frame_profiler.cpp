@@ -0,0 +1,121 @@
+/*
+ * @Description: Per stage latency and per frame deadline statistics of a player
+ * @References:
+ */
+
+#include "kitti_common/frame_profiler.h"
+
+#include <iomanip>
+#include <sstream>
+
+#include <diagnostic_msgs/KeyValue.h>
+#include <ros/console.h>
+
+namespace kitti_utils {
+
+namespace {
+/// Latency percentiles of a histogram in ms, "p50 / p99 / max ms (count)"
+std::string FormatLatency(const LatencyHistogram& histogram) {
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(2)
+      << histogram.Percentile(50.0) * 1e3 << " / " << histogram.Percentile(99.0) * 1e3 << " / "
+      << histogram.Max() * 1e3 << " ms (" << histogram.Count() << ")";
+  return out.str();
+}
+}
+
+FrameProfiler::FrameProfiler(const std::string& name, const std::string& source, double deadline)
+    : name_(name),
+      source_(source),
+      deadline_(deadline),
+      missed_(0),
+      window_missed_(0),
+      worst_frame_(0),
+      window_start_(std::chrono::steady_clock::now()) {
+}
+
+int FrameProfiler::AddStage(const std::string& name) {
+  stages_.push_back(Stage());
+  stages_.back().name = name;
+  return stages_.size() - 1;
+}
+
+void FrameProfiler::Record(int stage, double seconds) {
+  stages_[stage].window.Record(seconds);
+  stages_[stage].total.Record(seconds);
+}
+
+void FrameProfiler::RecordFrame(unsigned int frame, double seconds) {
+  if (frames_.Count() == 0 || seconds > frames_.Max()) {
+    worst_frame_ = frame;
+  }
+  frames_.Record(seconds);
+  window_frames_.Record(seconds);
+  if (deadline_ > 0.0 && seconds > deadline_) {
+    ++missed_;
+    ++window_missed_;
+  }
+}
+
+void FrameProfiler::FillStatus(diagnostic_msgs::DiagnosticStatus& status) {
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  const double elapsed = std::chrono::duration<double>(now - window_start_).count();
+  const double rate = elapsed > 0.0 ? window_frames_.Count() / elapsed : 0.0;
+
+  status.name = name_;
+  status.hardware_id = source_;
+  status.level = window_missed_ > 0 ? diagnostic_msgs::DiagnosticStatus::WARN
+                                    : diagnostic_msgs::DiagnosticStatus::OK;
+  std::ostringstream message;
+  message << window_frames_.Count() << " frames at " << std::fixed << std::setprecision(1) << rate
+          << " Hz, " << window_missed_ << " missed the deadline";
+  status.message = message.str();
+
+  // p50 / p99 / max of the frames and of each stage run in the window
+  status.values.clear();
+  diagnostic_msgs::KeyValue value;
+  value.key = "frame";
+  value.value = FormatLatency(window_frames_);
+  status.values.push_back(value);
+  for (const Stage& stage : stages_) {
+    if (stage.window.Count() == 0) {
+      continue;
+    }
+    value.key = stage.name;
+    value.value = FormatLatency(stage.window);
+    status.values.push_back(value);
+  }
+
+  for (Stage& stage : stages_) {
+    stage.window.Reset();
+  }
+  window_frames_.Reset();
+  window_missed_ = 0;
+  window_start_ = now;
+}
+
+void FrameProfiler::PrintSummary() const {
+  ROS_INFO_STREAM("Stage latencies of " << source_ << ", count / mean / p50 / p90 / p99 / max (ms):");
+  for (const Stage& stage : stages_) {
+    const LatencyHistogram& h = stage.total;
+    // Stages not enabled by the options are never recorded
+    if (h.Count() == 0) {
+      continue;
+    }
+    ROS_INFO_STREAM("  " << stage.name << ": " << h.Count() << " / " << h.Mean() * 1e3 << " / "
+                    << h.Percentile(50.0) * 1e3 << " / " << h.Percentile(90.0) * 1e3 << " / "
+                    << h.Percentile(99.0) * 1e3 << " / " << h.Max() * 1e3);
+  }
+  if (frames_.Count() > 0) {
+    ROS_INFO_STREAM("  frame: " << frames_.Count() << " / " << frames_.Mean() * 1e3 << " / "
+                    << frames_.Percentile(50.0) * 1e3 << " / " << frames_.Percentile(90.0) * 1e3 << " / "
+                    << frames_.Percentile(99.0) * 1e3 << " / " << frames_.Max() * 1e3
+                    << ", worst frame " << worst_frame_);
+  }
+  if (deadline_ > 0.0) {
+    ROS_INFO_STREAM("  " << missed_ << " of " << frames_.Count() << " frames missed the deadline of "
+                    << deadline_ * 1e3 << " ms");
+  }
+}
+
+} // namespace kitti_utils
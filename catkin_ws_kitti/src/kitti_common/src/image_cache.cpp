@@ -0,0 +1,185 @@
+/*
+ * @Description: Memory mapped file keeping the decoded images of a sequence, to replay it without PNG decoding
+ * @References:
+ */
+
+#include "kitti_common/image_cache.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include <ros/console.h>
+
+namespace kitti_utils {
+
+namespace {
+const char kMagic[8] = {'K', 'I', 'T', 'T', 'I', 'I', 'M', 'G'};
+const uint32_t kVersion = 1;
+const uint64_t kPageSize = 4096;
+
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_frames;
+  uint32_t num_cameras;
+  uint32_t reserved;
+};
+
+struct FileCamera {
+  char name[32];
+  int32_t rows;
+  int32_t cols;
+  int32_t type;
+  uint32_t reserved;
+  uint64_t offset;
+};
+
+uint64_t AlignToPage(uint64_t offset) {
+  return (offset + kPageSize - 1) / kPageSize * kPageSize;
+}
+}
+
+ImageCache::ImageCache()
+    : num_frames_(0),
+      data_(NULL),
+      size_(0),
+      valid_(NULL) {
+}
+
+ImageCache::~ImageCache() {
+  Close();
+}
+
+size_t ImageCache::ImageSize(int camera) const {
+  const CameraFormat& format = cameras_[camera];
+  return static_cast<size_t>(format.rows) * format.cols * CV_ELEM_SIZE(format.type);
+}
+
+bool ImageCache::Open(const std::string& filename, unsigned int num_frames, const std::vector<CameraFormat>& cameras) {
+  Close();
+  filename_ = filename;
+  num_frames_ = num_frames;
+  cameras_ = cameras;
+
+  // Layout of the file
+  uint64_t valid_offset = sizeof(FileHeader) + cameras_.size() * sizeof(FileCamera);
+  uint64_t offset = AlignToPage(valid_offset + static_cast<uint64_t>(num_frames_) * cameras_.size());
+  offsets_.resize(cameras_.size());
+  for (size_t i = 0; i < cameras_.size(); ++i) {
+    offsets_[i] = offset;
+    offset = AlignToPage(offset + ImageSize(i) * num_frames_);
+  }
+  size_t file_size = offset;
+
+  FileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.num_frames = num_frames_;
+  header.num_cameras = cameras_.size();
+  std::vector<FileCamera> file_cameras(cameras_.size());
+  for (size_t i = 0; i < cameras_.size(); ++i) {
+    memset(&file_cameras[i], 0, sizeof(FileCamera));
+    strncpy(file_cameras[i].name, cameras_[i].name.c_str(), sizeof(file_cameras[i].name) - 1);
+    file_cameras[i].rows = cameras_[i].rows;
+    file_cameras[i].cols = cameras_[i].cols;
+    file_cameras[i].type = cameras_[i].type;
+    file_cameras[i].offset = offsets_[i];
+  }
+
+  int fd = open(filename_.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    ROS_ERROR_STREAM("Fail to open image cache " << filename_);
+    return false;
+  }
+
+  // An existing file is reused only if it was made for the same images
+  struct stat st;
+  bool reuse = fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) == file_size;
+  if (reuse) {
+    FileHeader old_header;
+    std::vector<FileCamera> old_cameras(cameras_.size());
+    reuse = pread(fd, &old_header, sizeof(old_header), 0) == sizeof(old_header) &&
+            memcmp(&old_header, &header, sizeof(header)) == 0 &&
+            pread(fd, old_cameras.data(), old_cameras.size() * sizeof(FileCamera), sizeof(FileHeader)) ==
+                static_cast<ssize_t>(old_cameras.size() * sizeof(FileCamera)) &&
+            memcmp(old_cameras.data(), file_cameras.data(), file_cameras.size() * sizeof(FileCamera)) == 0;
+  }
+  if (!reuse) {
+    ROS_INFO_STREAM("Creating image cache " << filename_ << ", " << file_size / (1024 * 1024) << " MB");
+    // Truncate to zero first so that all the valid flags read 0, images are stored as they are decoded
+    bool ok = ftruncate(fd, 0) == 0 && ftruncate(fd, file_size) == 0 &&
+              pwrite(fd, &header, sizeof(header), 0) == sizeof(header) &&
+              pwrite(fd, file_cameras.data(), file_cameras.size() * sizeof(FileCamera), sizeof(FileHeader)) ==
+                  static_cast<ssize_t>(file_cameras.size() * sizeof(FileCamera));
+    if (!ok) {
+      ROS_ERROR_STREAM("Fail to create image cache " << filename_);
+      close(fd);
+      return false;
+    }
+  }
+
+  void* data = mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  // The mapping stays valid after closing the file descriptor
+  close(fd);
+  if (data == MAP_FAILED) {
+    ROS_ERROR_STREAM("Fail to map image cache " << filename_);
+    return false;
+  }
+  data_ = static_cast<uint8_t*>(data);
+  size_ = file_size;
+  valid_ = data_ + valid_offset;
+  if (reuse) {
+    ROS_INFO_STREAM("Using image cache " << filename_ << ", " << NumCached() << " images cached");
+  }
+  return true;
+}
+
+void ImageCache::Close() {
+  if (data_ == NULL) {
+    return;
+  }
+  msync(data_, size_, MS_SYNC);
+  munmap(data_, size_);
+  data_ = NULL;
+  valid_ = NULL;
+  size_ = 0;
+}
+
+bool ImageCache::Contains(unsigned int frame, int camera) const {
+  return frame < num_frames_ && valid_[frame * cameras_.size() + camera] != 0;
+}
+
+cv::Mat ImageCache::Image(unsigned int frame, int camera) const {
+  const CameraFormat& format = cameras_[camera];
+  uint8_t* image = data_ + offsets_[camera] + ImageSize(camera) * frame;
+  return cv::Mat(format.rows, format.cols, format.type, image);
+}
+
+bool ImageCache::Store(unsigned int frame, int camera, const cv::Mat& image) {
+  const CameraFormat& format = cameras_[camera];
+  if (frame >= num_frames_ || image.rows != format.rows || image.cols != format.cols || image.type() != format.type) {
+    return false;
+  }
+  cv::Mat cached = Image(frame, camera);
+  image.copyTo(cached);
+  // Set the flag after the copy, an image is never marked valid while partially written,
+  // even if the player is killed (the mapped pages are written back by the kernel)
+  __sync_synchronize();
+  valid_[frame * cameras_.size() + camera] = 1;
+  return true;
+}
+
+unsigned int ImageCache::NumCached() const {
+  unsigned int count = 0;
+  for (size_t i = 0; i < num_frames_ * cameras_.size(); ++i) {
+    count += valid_[i] != 0;
+  }
+  return count;
+}
+
+} // namespace kitti_utils
@@ -0,0 +1,274 @@
+/*
+ * @Description: Worker pool decoding the camera images of the upcoming frames in parallel
+ * @References:
+ */
+
+#include "kitti_common/image_decode_pool.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <boost/format.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <ros/console.h>
+
+#include "kitti_common/file_utils.h"
+
+namespace kitti_utils {
+
+ImageDecodePool::ImageDecodePool(unsigned int num_threads, unsigned int depth)
+    : num_threads_(num_threads > 0 ? num_threads : 1),
+      depth_(depth > 0 ? depth : 1),
+      end_frame_(0),
+      stopped_(false),
+      prefetch_(true) {
+}
+
+ImageDecodePool::~ImageDecodePool() {
+  Stop();
+}
+
+int ImageDecodePool::AddCamera(const std::string& name, const std::string& filename_format, int imread_flags) {
+  Camera camera;
+  camera.name = name;
+  camera.filename_format = filename_format;
+  camera.imread_flags = imread_flags;
+  camera.decoded = 0;
+  camera.failed = 0;
+  camera.skipped = 0;
+  camera.decode_time_sum = 0.0;
+  camera.decode_time_max = 0.0;
+  camera.cache_hits = 0;
+  camera.cache_time_sum = 0.0;
+  cameras_.push_back(camera);
+  return cameras_.size() - 1;
+}
+
+void ImageDecodePool::EnableCache(const std::string& cache_filename) {
+  cache_filename_ = cache_filename;
+}
+
+bool ImageDecodePool::OpenCache(unsigned int first_frame, unsigned int end_frame) {
+  std::vector<ImageCache::CameraFormat> formats;
+  std::vector<uchar> buffer;
+  for (unsigned int i = 0; i < cameras_.size(); ++i) {
+    std::string filename = Filename(first_frame, i);
+    cv::Mat image;
+    if (ReadFile(filename, buffer) && !buffer.empty()) {
+      image = cv::imdecode(buffer, cameras_[i].imread_flags);
+    }
+    if (image.data == NULL) {
+      ROS_WARN_STREAM("Fail to decode " << filename << ", image cache disabled");
+      return false;
+    }
+    ImageCache::CameraFormat format;
+    format.name = cameras_[i].name;
+    format.rows = image.rows;
+    format.cols = image.cols;
+    format.type = image.type();
+    formats.push_back(format);
+  }
+  return cache_.Open(cache_filename_, end_frame, formats);
+}
+
+void ImageDecodePool::Start(unsigned int first_frame, unsigned int end_frame) {
+  if (!cache_filename_.empty() && first_frame < end_frame) {
+    OpenCache(first_frame, end_frame);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  end_frame_ = end_frame;
+  slots_.resize(depth_);
+  for (Slot& slot : slots_) {
+    slot.pending = 0;
+    slot.failed = false;
+    slot.images.resize(cameras_.size());
+    slot.from_cache.assign(cameras_.size(), 0);
+    slot.skipped.assign(cameras_.size(), 0);
+  }
+  for (unsigned int frame = first_frame; frame < first_frame + depth_; ++frame) {
+    ScheduleFrame(frame);
+  }
+  for (unsigned int i = 0; i < num_threads_; ++i) {
+    workers_.push_back(std::thread(&ImageDecodePool::WorkerLoop, this));
+  }
+}
+
+void ImageDecodePool::ScheduleFrame(unsigned int frame) {
+  Slot& slot = slots_[frame % depth_];
+  slot.frame = frame;
+  slot.failed = false;
+  slot.skipped.assign(cameras_.size(), 0);
+  if (frame >= end_frame_) {
+    slot.pending = 0;
+    return;
+  }
+  slot.pending = cameras_.size();
+  for (unsigned int camera = 0; camera < cameras_.size(); ++camera) {
+    Job job;
+    job.slot = frame % depth_;
+    job.camera = camera;
+    job.needed = false;
+    jobs_.push_back(job);
+  }
+  jobs_cond_.notify_all();
+}
+
+void ImageDecodePool::WorkerLoop() {
+  // File content, reused for all the jobs of this worker
+  std::vector<uchar> buffer;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    jobs_cond_.wait(lock, [this] { return stopped_ || !jobs_.empty(); });
+    if (stopped_) {
+      return;
+    }
+    Job job = jobs_.front();
+    jobs_.pop_front();
+    Slot& slot = slots_[job.slot];
+    Camera& camera = cameras_[job.camera];
+    if (!prefetch_ && !job.needed) {
+      // Nobody needs the images now, WaitFrame() queues the job again if this changes
+      slot.skipped[job.camera] = 1;
+      ++camera.skipped;
+      if (--slot.pending == 0) {
+        done_cond_.notify_all();
+      }
+      continue;
+    }
+    unsigned int frame = slot.frame;
+    std::string filename = boost::str(boost::format(camera.filename_format) % frame);
+    cv::Mat& image = slot.images[job.camera];
+    uint8_t& from_cache = slot.from_cache[job.camera];
+    lock.unlock();
+
+    // The slot is not touched by the player until all its jobs are done
+    auto start = std::chrono::steady_clock::now();
+    bool ok = false;
+    bool cached = cache_.IsOpen() && cache_.Contains(frame, job.camera);
+    if (cached) {
+      // Only the header, the player copies the mapped memory into the message
+      image = cache_.Image(frame, job.camera);
+      from_cache = 1;
+      ok = true;
+    } else if (ReadFile(filename, buffer) && !buffer.empty()) {
+      // Decode into the slot image, its memory is reused if size and type do not change.
+      // A slot image pointing into the cache must not be overwritten, it gets its own buffer again.
+      if (from_cache) {
+        image.release();
+        from_cache = 0;
+      }
+      cv::imdecode(buffer, camera.imread_flags, &image);
+      ok = image.data != NULL;
+      if (ok && cache_.IsOpen()) {
+        cache_.Store(frame, job.camera, image);
+      }
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    lock.lock();
+    if (ok && cached) {
+      ++camera.cache_hits;
+      camera.cache_time_sum += elapsed;
+    } else if (ok) {
+      ++camera.decoded;
+      camera.decode_time_sum += elapsed;
+      camera.decode_time_max = std::max(camera.decode_time_max, elapsed);
+    } else {
+      ROS_ERROR_STREAM("Fail to decode " << filename);
+      ++camera.failed;
+      slot.failed = true;
+    }
+    if (--slot.pending == 0) {
+      done_cond_.notify_all();
+    }
+  }
+}
+
+bool ImageDecodePool::WaitFrame(unsigned int frame) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  Slot& slot = slots_[frame % depth_];
+  if (slot.frame != frame) {
+    ROS_ERROR_STREAM("Frame " << frame << " not scheduled for decoding, frames must be played in order");
+    return false;
+  }
+  // Jobs still queued may be skipped while waiting, decode them then before the jobs of the frames ahead
+  while (true) {
+    done_cond_.wait(lock, [this, &slot] { return stopped_ || slot.pending == 0; });
+    bool requeued = false;
+    for (unsigned int camera = 0; camera < cameras_.size() && !stopped_; ++camera) {
+      if (slot.skipped[camera]) {
+        slot.skipped[camera] = 0;
+        --cameras_[camera].skipped;
+        ++slot.pending;
+        Job job;
+        job.slot = frame % depth_;
+        job.camera = camera;
+        job.needed = true;
+        jobs_.push_front(job);
+        requeued = true;
+      }
+    }
+    if (!requeued) {
+      break;
+    }
+    jobs_cond_.notify_all();
+  }
+  return !stopped_ && !slot.failed;
+}
+
+const cv::Mat& ImageDecodePool::Image(unsigned int frame, int camera) const {
+  return slots_[frame % depth_].images[camera];
+}
+
+std::string ImageDecodePool::Filename(unsigned int frame, int camera) const {
+  return boost::str(boost::format(cameras_[camera].filename_format) % frame);
+}
+
+void ImageDecodePool::ReleaseFrame(unsigned int frame) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  Slot& slot = slots_[frame % depth_];
+  if (slot.frame == frame) {
+    // A frame released without WaitFrame() may still have jobs, skipped at once without prefetch
+    done_cond_.wait(lock, [this, &slot] { return stopped_ || slot.pending == 0; });
+    ScheduleFrame(frame + depth_);
+  }
+}
+
+void ImageDecodePool::SetPrefetch(bool prefetch) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  prefetch_ = prefetch;
+}
+
+void ImageDecodePool::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+  }
+  jobs_cond_.notify_all();
+  done_cond_.notify_all();
+  for (std::thread& worker : workers_) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+  workers_.clear();
+}
+
+void ImageDecodePool::PrintStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ROS_INFO_STREAM("Image decoding with " << num_threads_ << " threads, " << depth_ << " frames ahead");
+  for (const Camera& camera : cameras_) {
+    double mean = camera.decoded > 0 ? camera.decode_time_sum / camera.decoded : 0.0;
+    ROS_INFO_STREAM("  " << camera.name << ": " << camera.decoded << " images, decode mean "
+                    << mean * 1e3 << " ms, max " << camera.decode_time_max * 1e3 << " ms"
+                    << (camera.failed > 0 ? ", failed " : "") << (camera.failed > 0 ? std::to_string(camera.failed) : "")
+                    << (camera.skipped > 0 ? ", skipped " : "") << (camera.skipped > 0 ? std::to_string(camera.skipped) : ""));
+    if (camera.cache_hits > 0) {
+      ROS_INFO_STREAM("  " << camera.name << ": " << camera.cache_hits << " images from cache, mean "
+                      << camera.cache_time_sum / camera.cache_hits * 1e3 << " ms");
+    }
+  }
+}
+
+} // namespace kitti_utils
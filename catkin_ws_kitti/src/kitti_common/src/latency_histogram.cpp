@@ -0,0 +1,113 @@
+/*
+ * @Description: Latency histogram with a bounded relative error, in the spirit of HdrHistogram
+ * @References: http://hdrhistogram.org/
+ */
+
+#include "kitti_common/latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace kitti_utils {
+
+namespace {
+/// Linear buckets per power of two, 2^kSubBucketBits
+const int kSubBucketBits = 6;
+const uint64_t kSubBuckets = 1u << kSubBucketBits;
+/// Larger values are recorded as the max, 2^44 ns is about 4.9 hours
+const int kMaxValueBits = 44;
+const uint64_t kMaxValue = (uint64_t(1) << kMaxValueBits) - 1;
+const int kNumBuckets = (kMaxValueBits - kSubBucketBits) * kSubBuckets + 2 * kSubBuckets;
+
+int HighestBit(uint64_t value) {
+  int bit = 0;
+  while (value >>= 1) {
+    ++bit;
+  }
+  return bit;
+}
+}
+
+LatencyHistogram::LatencyHistogram()
+    : counts_(kNumBuckets, 0),
+      count_(0),
+      min_(std::numeric_limits<uint64_t>::max()),
+      max_(0),
+      sum_(0.0) {
+}
+
+int LatencyHistogram::BucketIndex(uint64_t value) {
+  // Values below 2 * kSubBuckets have their own bucket, above the bucket width doubles
+  // with every power of two: index = shift * kSubBuckets + (value >> shift)
+  const int shift = std::max(0, HighestBit(value) - kSubBucketBits);
+  return shift * kSubBuckets + (value >> shift);
+}
+
+uint64_t LatencyHistogram::BucketValue(int index) {
+  if (index < static_cast<int>(2 * kSubBuckets)) {
+    return index;
+  }
+  const int shift = index / kSubBuckets - 1;
+  const uint64_t sub_bucket = index - shift * kSubBuckets;
+  return ((sub_bucket + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(double seconds) {
+  uint64_t value = seconds > 0.0 ? static_cast<uint64_t>(std::min(seconds * 1e9, static_cast<double>(kMaxValue))) : 0;
+  ++counts_[BucketIndex(value)];
+  ++count_;
+  min_ = std::min(min_, value);
+  max_ = std::max(max_, value);
+  sum_ += value;
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    counts_[i] += other.counts_[i];
+  }
+  count_ += other.count_;
+  min_ = std::min(min_, other.min_);
+  max_ = std::max(max_, other.max_);
+  sum_ += other.sum_;
+}
+
+void LatencyHistogram::Reset() {
+  std::fill(counts_.begin(), counts_.end(), 0);
+  count_ = 0;
+  min_ = std::numeric_limits<uint64_t>::max();
+  max_ = 0;
+  sum_ = 0.0;
+}
+
+double LatencyHistogram::Min() const {
+  return count_ > 0 ? min_ * 1e-9 : 0.0;
+}
+
+double LatencyHistogram::Max() const {
+  return max_ * 1e-9;
+}
+
+double LatencyHistogram::Mean() const {
+  return count_ > 0 ? sum_ / count_ * 1e-9 : 0.0;
+}
+
+double LatencyHistogram::Percentile(double percentile) const {
+  if (count_ == 0) {
+    return 0.0;
+  }
+  // Rank of the value, at least the first one
+  const double fraction = std::max(0.0, std::min(percentile, 100.0)) / 100.0;
+  const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(fraction * count_)));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    seen += counts_[i];
+    if (seen >= rank) {
+      // The bucket bound, never above the largest recorded value
+      return std::min(BucketValue(i), max_) * 1e-9;
+    }
+  }
+  return max_ * 1e-9;
+}
+
+} // namespace kitti_utils
@@ -0,0 +1,188 @@
+/*
+ * @Description: All the OXTS records of a sequence, parsed once into a table of doubles
+ * @References: KITTI raw data devkit, dataformat.txt of the oxts folder
+ *              http://www.uwgb.edu/dutchs/UsefulData/ConvertUTMNoOZ.HTM
+ */
+
+#include "kitti_common/oxts_table.h"
+
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <ros/console.h>
+
+#include "kitti_common/file_utils.h"
+
+namespace kitti_utils {
+
+Xy LatLon2Xy(double lat, double lngd) {
+  Eigen::ArrayXd lat_array = Eigen::ArrayXd::Constant(1, lat);
+  Eigen::ArrayXd lngd_array = Eigen::ArrayXd::Constant(1, lngd);
+  Eigen::ArrayXd x(1), y(1);
+  LatLon2Xy(lat_array, lngd_array, x, y);
+
+  Xy coords;
+  coords.x = x[0];
+  coords.y = y[0];
+  return coords;
+}
+
+void LatLon2Xy(const Eigen::Ref<const Eigen::ArrayXd>& lat, const Eigen::Ref<const Eigen::ArrayXd>& lngd,
+               Eigen::Ref<Eigen::ArrayXd> x, Eigen::Ref<Eigen::ArrayXd> y) {
+  // WGS 84 datum
+  const double eqRad = 6378137.0;
+  const double flat = 298.2572236;
+
+  // constants used in calculations:
+  const double a = eqRad;                                // equatorial radius in meters
+  const double f = 1.0 / flat;                           // polar flattening
+  const double b = a * (1.0 - f);                        // polar radius
+  const double e = sqrt(1.0 - (pow(b, 2) / pow(a, 2)));  // eccentricity
+  const double k0 = 0.9996;
+  const double drad = M_PI / 180.0;
+  const double esq = (1.0 - (b / a) * (b / a));
+  const double e0sq = e * e / (1.0 - e * e);
+
+  // coefficients of the arc length series (USGS style)
+  const double m1 = 1.0 - esq * (1.0 / 4.0 + esq * (3.0 / 64.0 + 5.0 * esq / 256.0));
+  const double m2 = esq * (3.0 / 8.0 + esq * (3.0 / 32.0 + 45.0 * esq / 1024.0));
+  const double m3 = esq * esq * (15.0 / 256.0 + esq * 45.0 / 1024.0);
+  const double m4 = esq * esq * esq * (35.0 / 3072.0);
+
+  // Intermediate terms are evaluated once for all the points
+  Eigen::ArrayXd phi = lat * drad;                          // convert latitude to radians
+  Eigen::ArrayXd utmz = 1.0 + ((lngd + 180.0) / 6.0).floor();  // longitude to utm zone
+  Eigen::ArrayXd zcm = 3.0 + 6.0 * (utmz - 1.0) - 180.0;    // central meridian of a zone
+  Eigen::ArrayXd sin_phi = phi.sin();
+  Eigen::ArrayXd cos_phi = phi.cos();
+  Eigen::ArrayXd tan_phi = phi.tan();
+  Eigen::ArrayXd N = a / (1.0 - (e * sin_phi).square()).sqrt();
+  Eigen::ArrayXd T = tan_phi.square();
+  Eigen::ArrayXd C = e0sq * cos_phi.square();
+  Eigen::ArrayXd A = (lngd - zcm) * drad * cos_phi;
+  Eigen::ArrayXd A2 = A.square();
+
+  // Arc length along standard meridian, M0 = 0
+  Eigen::ArrayXd M = a * (m1 * phi - m2 * (2.0 * phi).sin() + m3 * (4.0 * phi).sin() - m4 * (6.0 * phi).sin());
+
+  // easting relative to CM, plus the standard easting
+  x = k0 * N * A * (1.0 + A2 * ((1.0 - T + C) / 6.0 + A2 * (5.0 - 18.0 * T + T * T + 72.0 * C - 58.0 * e0sq) / 120.0));
+  x += 500000.0;
+
+  // northing from the equator, false northing if south of the equator
+  y = k0 * (M + N * tan_phi * (A2 * (1.0 / 2.0 + A2 * ((5.0 - T + 9.0 * C + 4.0 * C * C) / 24.0 + A2 * (61.0 - 58.0 * T + T * T + 600.0 * C - 330.0 * e0sq) / 720.0))));
+  y = (y < 0.0).select(y + 10000000.0, y);
+}
+
+void OxtsTable::Clear(unsigned int capacity) {
+  for (int i = 0; i < kNumFields; ++i) {
+    columns_[i].clear();
+    columns_[i].reserve(capacity);
+  }
+}
+
+const char* OxtsTable::ParseRecord(const char* begin, const char* end) {
+  double record[kNumFields];
+  const char* p = begin;
+  for (int i = 0; i < kNumFields; ++i) {
+    char* next;
+    record[i] = strtod(p, &next);
+    if (next == p || next > end) {
+      return NULL;
+    }
+    p = next;
+  }
+  for (int i = 0; i < kNumFields; ++i) {
+    columns_[i].push_back(record[i]);
+  }
+  return p;
+}
+
+void OxtsTable::ComputeDerived() {
+  const unsigned int num_frames = size();
+  utm_x_.resize(num_frames);
+  utm_y_.resize(num_frames);
+  qx_.resize(num_frames);
+  qy_.resize(num_frames);
+  qz_.resize(num_frames);
+  qw_.resize(num_frames);
+
+  // UTM coordinates of all the frames in one batch
+  LatLon2Xy(Eigen::Map<const Eigen::ArrayXd>(columns_[kLat].data(), num_frames),
+            Eigen::Map<const Eigen::ArrayXd>(columns_[kLon].data(), num_frames),
+            Eigen::Map<Eigen::ArrayXd>(utm_x_.data(), num_frames),
+            Eigen::Map<Eigen::ArrayXd>(utm_y_.data(), num_frames));
+
+  for (unsigned int i = 0; i < num_frames; ++i) {
+    tf::Quaternion q;
+    q.setRPY(columns_[kRoll][i], columns_[kPitch][i], columns_[kYaw][i]);
+    qx_[i] = q.getX();
+    qy_[i] = q.getY();
+    qz_[i] = q.getZ();
+    qw_[i] = q.getW();
+  }
+}
+
+bool OxtsTable::LoadRawDirectory(const std::string& dir, unsigned int num_frames) {
+  Clear(num_frames);
+
+  std::string prefix = dir;
+  if (!prefix.empty() && prefix[prefix.size() - 1] != '/') {
+    prefix += '/';
+  }
+
+  std::string content;
+  char name[32];
+  for (unsigned int frame = 0; frame < num_frames; ++frame) {
+    snprintf(name, sizeof(name), "%010u.txt", frame);
+    std::string filename = prefix + name;
+    if (!ReadFile(filename, content)) {
+      ROS_ERROR_STREAM("Fail to open " << filename);
+      return false;
+    }
+    if (!ParseRecord(content.c_str(), content.c_str() + content.size())) {
+      ROS_ERROR_STREAM("Fail to parse the OXTS record in " << filename);
+      return false;
+    }
+  }
+  ComputeDerived();
+  return true;
+}
+
+bool OxtsTable::LoadFile(const std::string& filename) {
+  std::string content;
+  if (!ReadFile(filename, content)) {
+    ROS_ERROR_STREAM("Fail to open " << filename);
+    return false;
+  }
+
+  // Tracking sequences have a few hundred lines
+  Clear(1024);
+  const char* p = content.c_str();
+  const char* end = p + content.size();
+  unsigned int line = 0;
+  while (p < end) {
+    const char* line_end = static_cast<const char*>(memchr(p, '\n', end - p));
+    if (line_end == NULL) {
+      line_end = end;
+    }
+    ++line;
+    // Skip empty lines, e.g. at the end of the file
+    const char* q = p;
+    while (q < line_end && isspace(static_cast<unsigned char>(*q))) {
+      ++q;
+    }
+    if (q < line_end && !ParseRecord(q, line_end)) {
+      ROS_ERROR_STREAM("Fail to parse the OXTS record at line " << line << " of " << filename);
+      return false;
+    }
+    p = line_end + 1;
+  }
+  ComputeDerived();
+  return true;
+}
+
+} // namespace kitti_utils
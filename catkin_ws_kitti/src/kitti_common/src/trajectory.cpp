@@ -0,0 +1,77 @@
+/*
+ * @Description: Ego poses of a whole sequence in a local metric frame, computed once from the OXTS records
+ * @References:
+ */
+
+#include "kitti_common/trajectory.h"
+
+#include <algorithm>
+
+#include <ros/console.h>
+
+namespace kitti_utils {
+
+bool Trajectory::Build(const OxtsTable& oxts, unsigned int origin_frame) {
+  poses_.clear();
+  stamps_.clear();
+  if (origin_frame >= oxts.size()) {
+    ROS_ERROR_STREAM("No OXTS record for the trajectory origin frame " << origin_frame);
+    return false;
+  }
+  origin_ = Eigen::Vector3d(oxts.UtmX(origin_frame), oxts.UtmY(origin_frame),
+                            oxts.Get(origin_frame, OxtsTable::kAlt));
+
+  poses_.resize(oxts.size());
+  for (unsigned int i = 0; i < oxts.size(); ++i) {
+    tf::Quaternion q = oxts.Orientation(i);
+    Eigen::Isometry3d& pose = poses_[i];
+    pose.setIdentity();
+    pose.linear() = Eigen::Quaterniond(q.getW(), q.getX(), q.getY(), q.getZ()).toRotationMatrix();
+    pose.translation() = Eigen::Vector3d(oxts.UtmX(i), oxts.UtmY(i), oxts.Get(i, OxtsTable::kAlt)) - origin_;
+  }
+  return true;
+}
+
+bool Trajectory::SetStamps(const std::vector<ros::Time>& stamps) {
+  if (stamps.size() < poses_.size()) {
+    ROS_ERROR_STREAM("Trajectory has " << poses_.size() << " poses for " << stamps.size() << " timestamps");
+    return false;
+  }
+  stamps_.resize(poses_.size());
+  for (size_t i = 0; i < stamps_.size(); ++i) {
+    stamps_[i] = stamps[i].toSec();
+  }
+  return true;
+}
+
+Eigen::Isometry3d Trajectory::Interpolate(const ros::Time& stamp) const {
+  return Interpolate(stamp.toSec());
+}
+
+Eigen::Isometry3d Trajectory::Interpolate(double t) const {
+  if (stamps_.empty()) {
+    return Eigen::Isometry3d::Identity();
+  }
+  // First frame after t
+  std::vector<double>::const_iterator next = std::upper_bound(stamps_.begin(), stamps_.end(), t);
+  if (next == stamps_.begin()) {
+    return poses_.front();
+  }
+  if (next == stamps_.end()) {
+    return poses_.back();
+  }
+  const size_t i = next - stamps_.begin();
+  const Eigen::Isometry3d& before = poses_[i - 1];
+  const Eigen::Isometry3d& after = poses_[i];
+  const double dt = stamps_[i] - stamps_[i - 1];
+  const double ratio = dt > 0.0 ? (t - stamps_[i - 1]) / dt : 0.0;
+
+  Eigen::Quaterniond q_before(before.linear());
+  Eigen::Quaterniond q_after(after.linear());
+  Eigen::Isometry3d pose = Eigen::Isometry3d::Identity();
+  pose.linear() = q_before.slerp(ratio, q_after).toRotationMatrix();
+  pose.translation() = before.translation() + ratio * (after.translation() - before.translation());
+  return pose;
+}
+
+} // namespace kitti_utils
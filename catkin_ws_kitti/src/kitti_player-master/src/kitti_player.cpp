@@ -34,6 +34,7 @@
 #include <boost/tokenizer.hpp>
 #include <boost/format.hpp>
 #include <cv_bridge/cv_bridge.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
 #include <image_transport/image_transport.h>
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
@@ -54,6 +55,11 @@
 #include <tf/transform_listener.h>
 #include <time.h>
 
+#include <kitti_common/frame_profiler.h>
+#include <kitti_common/image_decode_pool.h>
+#include <kitti_common/oxts_table.h>
+#include <kitti_common/trajectory.h>
+
 using namespace std;
 using namespace pcl;
 using namespace ros;
@@ -79,6 +85,8 @@ struct kitti_player_options
     bool    synchMode;        // start with synchMode on (wait for message to send next frame)
     unsigned int startFrame;  // start the replay at frame ...
     string gpsReferenceFrame; // publish GPS points into RVIZ as RVIZ Markers
+    unsigned int decodeThreads; // number of threads decoding the images of the next frames
+    string  imageCache;       // directory of the decoded image cache files, empty to disable
 };
 
 
@@ -242,40 +250,35 @@ int getCalibration(string dir_root, string camera_name, double* K, std::vector<d
     return true;
 }
 
-int getGPS(string filename, sensor_msgs::NavSatFix *ros_msgGpsFix, std_msgs::Header *header)
+/**
+ * @brief getGPS
+ * @param oxts OXTS records of the drive
+ * @param frame frame to publish
+ * @param ros_msgGpsFix message to fill
+ * @param header Header to use to publish the message
+ * @return 1 if the frame is in the table, 0 otherwise
+ */
+int getGPS(const kitti_utils::OxtsTable &oxts, unsigned int frame, sensor_msgs::NavSatFix *ros_msgGpsFix, std_msgs::Header *header)
 {
-    ifstream file_oxts(filename.c_str());
-    if (!file_oxts.is_open())
+    if (frame >= oxts.size())
     {
-        ROS_ERROR_STREAM("Fail to open " << filename);
+        ROS_ERROR_STREAM("No OXTS record for frame " << frame);
         return 0;
     }
-
-    ROS_DEBUG_STREAM("Reading GPS data from oxts file: " << filename );
-
-    typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
-    boost::char_separator<char> sep {" "};
-
-    string line = "";
-
-    getline(file_oxts, line);
-    tokenizer tok(line, sep);
-    vector<string> s(tok.begin(), tok.end());
-
     ros_msgGpsFix->header.frame_id = ros::this_node::getName();
     ros_msgGpsFix->header.stamp = header->stamp;
 
-    ros_msgGpsFix->latitude  = boost::lexical_cast<double>(s[0]);
-    ros_msgGpsFix->longitude = boost::lexical_cast<double>(s[1]);
-    ros_msgGpsFix->altitude  = boost::lexical_cast<double>(s[2]);
+    ros_msgGpsFix->latitude  = oxts.Get(frame, kitti_utils::OxtsTable::kLat);
+    ros_msgGpsFix->longitude = oxts.Get(frame, kitti_utils::OxtsTable::kLon);
+    ros_msgGpsFix->altitude  = oxts.Get(frame, kitti_utils::OxtsTable::kAlt);
 
     ros_msgGpsFix->position_covariance_type = sensor_msgs::NavSatFix::COVARIANCE_TYPE_APPROXIMATED;
     for (int i = 0; i < 9; i++)
         ros_msgGpsFix->position_covariance[i] = 0.0f;
 
-    ros_msgGpsFix->position_covariance[0] = boost::lexical_cast<double>(s[23]);
-    ros_msgGpsFix->position_covariance[4] = boost::lexical_cast<double>(s[23]);
-    ros_msgGpsFix->position_covariance[8] = boost::lexical_cast<double>(s[23]);
+    ros_msgGpsFix->position_covariance[0] = oxts.Get(frame, kitti_utils::OxtsTable::kPosAccuracy);
+    ros_msgGpsFix->position_covariance[4] = oxts.Get(frame, kitti_utils::OxtsTable::kPosAccuracy);
+    ros_msgGpsFix->position_covariance[8] = oxts.Get(frame, kitti_utils::OxtsTable::kPosAccuracy);
 
     ros_msgGpsFix->status.service = sensor_msgs::NavSatStatus::SERVICE_GPS;
     ros_msgGpsFix->status.status  = sensor_msgs::NavSatStatus::STATUS_GBAS_FIX;
@@ -283,50 +286,42 @@ int getGPS(string filename, sensor_msgs::NavSatFix *ros_msgGpsFix, std_msgs::Hea
     return 1;
 }
 
-int getIMU(string filename, sensor_msgs::Imu *ros_msgImu, std_msgs::Header *header)
+/**
+ * @brief getIMU
+ * @param oxts OXTS records of the drive
+ * @param frame frame to publish
+ * @param ros_msgImu message to fill
+ * @param header Header to use to publish the message
+ * @return 1 if the frame is in the table, 0 otherwise
+ */
+int getIMU(const kitti_utils::OxtsTable &oxts, unsigned int frame, sensor_msgs::Imu *ros_msgImu, std_msgs::Header *header)
 {
-    ifstream file_oxts(filename.c_str());
-    if (!file_oxts.is_open())
+    if (frame >= oxts.size())
     {
-        ROS_ERROR_STREAM("Fail to open " << filename);
+        ROS_ERROR_STREAM("No OXTS record for frame " << frame);
         return 0;
     }
-
-    ROS_DEBUG_STREAM("Reading IMU data from oxts file: " << filename );
-
-    typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
-    boost::char_separator<char> sep {" "};
-
-    string line = "";
-
-    getline(file_oxts, line);
-    tokenizer tok(line, sep);
-    vector<string> s(tok.begin(), tok.end());
-
     ros_msgImu->header.frame_id = ros::this_node::getName();
     ros_msgImu->header.stamp = header->stamp;
 
     //    - ax:      acceleration in x, i.e. in direction of vehicle front (m/s^2)
     //    - ay:      acceleration in y, i.e. in direction of vehicle left (m/s^2)
     //    - az:      acceleration in z, i.e. in direction of vehicle top (m/s^2)
-    ros_msgImu->linear_acceleration.x = boost::lexical_cast<double>(s[11]);
-    ros_msgImu->linear_acceleration.y = boost::lexical_cast<double>(s[12]);
-    ros_msgImu->linear_acceleration.z = boost::lexical_cast<double>(s[13]);
+    ros_msgImu->linear_acceleration.x = oxts.Get(frame, kitti_utils::OxtsTable::kAx);
+    ros_msgImu->linear_acceleration.y = oxts.Get(frame, kitti_utils::OxtsTable::kAy);
+    ros_msgImu->linear_acceleration.z = oxts.Get(frame, kitti_utils::OxtsTable::kAz);
 
     //    - vf:      forward velocity, i.e. parallel to earth-surface (m/s)
     //    - vl:      leftward velocity, i.e. parallel to earth-surface (m/s)
     //    - vu:      upward velocity, i.e. perpendicular to earth-surface (m/s)
-    ros_msgImu->angular_velocity.x = boost::lexical_cast<double>(s[8]);
-    ros_msgImu->angular_velocity.y = boost::lexical_cast<double>(s[9]);
-    ros_msgImu->angular_velocity.z = boost::lexical_cast<double>(s[10]);
+    ros_msgImu->angular_velocity.x = oxts.Get(frame, kitti_utils::OxtsTable::kVf);
+    ros_msgImu->angular_velocity.y = oxts.Get(frame, kitti_utils::OxtsTable::kVl);
+    ros_msgImu->angular_velocity.z = oxts.Get(frame, kitti_utils::OxtsTable::kVu);
 
     //    - roll:    roll angle (rad),  0 = level, positive = left side up (-pi..pi)
     //    - pitch:   pitch angle (rad), 0 = level, positive = front down (-pi/2..pi/2)
     //    - yaw:     heading (rad),     0 = east,  positive = counter clockwise (-pi..pi)
-    tf::Quaternion q = tf::createQuaternionFromRPY(   boost::lexical_cast<double>(s[3]),
-                                                      boost::lexical_cast<double>(s[4]),
-                                                      boost::lexical_cast<double>(s[5])
-                                                  );
+    tf::Quaternion q = oxts.Orientation(frame);
     ros_msgImu->orientation.x = q.getX();
     ros_msgImu->orientation.y = q.getY();
     ros_msgImu->orientation.z = q.getZ();
@@ -335,70 +330,6 @@ int getIMU(string filename, sensor_msgs::Imu *ros_msgImu, std_msgs::Header *head
     return 1;
 }
 
-/// Cartesian coordinates struct, refs# 522
-struct Xy
-{
-    double x;
-    double y;
-};
-
-/** Conversion between geographic and UTM coordinates
-    Adapted from:  http://www.uwgb.edu/dutchs/UsefulData/ConvertUTMNoOZ.HTM
-    Refs# 522
-**/
-Xy latlon2xy_helper(double lat, double lngd)
-{
-    // WGS 84 datum
-    double eqRad = 6378137.0;
-    double flat = 298.2572236;
-
-    // constants used in calculations:
-    double a = eqRad;           // equatorial radius in meters
-    double f = 1.0 / flat;        // polar flattening
-    double b = a * (1.0 - f);     // polar radius
-    double e = sqrt(1.0 - (pow(b, 2) / pow(a, 2))); // eccentricity
-    double k0 = 0.9996;
-    double drad = M_PI / 180.0;
-
-    double phi = lat * drad;   // convert latitude to radians
-    double utmz = 1.0 + floor((lngd + 180.0) / 6.0); // longitude to utm zone
-    double zcm = 3.0 + 6.0 * (utmz - 1.0) - 180.0;     // central meridian of a zone
-    double esq = (1.0 - (b / a) * (b / a));
-    double e0sq = e * e / (1.0 - e * e);
-    double M = 0.0;
-    double M0 = 0.0;
-    double N = a / sqrt(1.0 - pow(e * sin(phi), 2));
-    double T = pow(tan(phi), 2);
-    double C = e0sq * pow(cos(phi), 2);
-    double A = (lngd - zcm) * drad * cos(phi);
-
-    // calculate M (USGS style)
-    M = phi * (1.0 - esq * (1.0 / 4.0 + esq * (3.0 / 64.0 + 5.0 * esq / 256.0)));
-    M = M - sin(2.0 * phi) * (esq * (3.0 / 8.0 + esq * (3.0 / 32.0 + 45.0 * esq / 1024.0)));
-    M = M + sin(4.0 * phi) * (esq * esq * (15.0 / 256.0 + esq * 45.0 / 1024.0));
-    M = M - sin(6.0 * phi) * (esq * esq * esq * (35.0 / 3072.0));
-    M = M * a; // Arc length along standard meridian
-
-    // now we are ready to calculate the UTM values...
-    // first the easting (relative to CM)
-    double x = k0 * N * A * (1.0 + A * A * ((1.0 - T + C) / 6.0 + A * A * (5.0 - 18.0 * T + T * T + 72.0 * C - 58.0 * e0sq) / 120.0));
-    x = x + 500000.0; // standard easting
-
-    // now the northing (from the equator)
-    double y = k0 * (M - M0 + N * tan(phi) * (A * A * (1.0 / 2.0 + A * A * ((5.0 - T + 9.0 * C + 4.0 * C * C) / 24.0 + A * A * (61.0 - 58.0 * T + T * T + 600.0 * C - 330.0 * e0sq) / 720.0))));
-    if (y < 0)
-    {
-        y = 10000000.0 + y; // add in false northing if south of the equator
-    }
-    double easting  = x;
-    double northing = y;
-
-    Xy coords;
-    coords.x = easting;
-    coords.y = northing;
-
-    return coords;
-}
 
 
 
@@ -429,11 +360,72 @@ std_msgs::Header parseTime(string timestamp)
     time_t timeSinceEpoch = mktime(&t);
 
     header.stamp.sec  = timeSinceEpoch;
-    header.stamp.nsec = boost::lexical_cast<int>(timestamp.substr(20, 8));
+    // nanoseconds: all the digits after the dot, at most 9
+    string fraction = timestamp.substr(20, 9);
+    header.stamp.nsec = boost::lexical_cast<int>(fraction);
+    for (size_t i = fraction.size(); i < 9; i++)
+        header.stamp.nsec *= 10;
 
     return header;
 }
 
+/**
+ * @brief loadTimestamps
+ * @param filename timestamps.txt of a sensor
+ * @param entries number of frames that will be played
+ * @param stamps one stamp per frame, read line by line
+ * @return false if the file can not be read, a line can not be parsed, or there are less stamps than frames
+ *
+ * All the files are parsed once before playing, frames then only index the arrays.
+ * Stamps going back in time are reported but accepted.
+ */
+bool loadTimestamps(const string &filename, unsigned int entries, vector<ros::Time> &stamps)
+{
+    ifstream timestamps(filename.c_str());
+    if (!timestamps.is_open())
+    {
+        ROS_ERROR_STREAM("Fail to open " << filename);
+        return false;
+    }
+
+    stamps.clear();
+    stamps.reserve(entries);
+    string line;
+    unsigned int line_number = 0;
+    unsigned int backwards = 0;
+    while (getline(timestamps, line))
+    {
+        line_number++;
+        boost::algorithm::trim(line);
+        if (line.empty())
+            continue;
+        try
+        {
+            if (line.size() < 21 || line[4] != '-' || line[10] != ' ' || line[19] != '.')
+                throw boost::bad_lexical_cast();
+            stamps.push_back(parseTime(line).stamp);
+        }
+        catch (const boost::bad_lexical_cast &)
+        {
+            ROS_ERROR_STREAM("Bad timestamp in " << filename << " at line " << line_number << ": " << line);
+            return false;
+        }
+        if (stamps.size() > 1 && stamps.back() < stamps[stamps.size() - 2])
+            backwards++;
+    }
+
+    if (stamps.size() < entries)
+    {
+        ROS_ERROR_STREAM(filename << " has " << stamps.size() << " timestamps for " << entries << " frames");
+        return false;
+    }
+    if (stamps.size() > entries)
+        ROS_WARN_STREAM(filename << " has " << stamps.size() << " timestamps for " << entries << " frames");
+    if (backwards > 0)
+        ROS_WARN_STREAM(filename << " has " << backwards << " timestamps going back in time");
+    return true;
+}
+
 
 /**
  * @brief main Kitti_player, a player for KITTI raw datasets
@@ -456,6 +448,9 @@ std_msgs::Header parseTime(string timestamp)
  *   -s [ --stereoDisp ] [=arg(=1)] (=0) use pre-calculated disparities
  *   -D [ --viewDisp   ] [=arg(=1)] (=0) view loaded disparity images
  *   -F [ --frame      ] [=arg(=0)] (=0) start playing at frame ...
+ *   -t [ --sendTransform ] [=arg(=1)] (=0) publish the pose TF world -> base_link
+ *   -j [ --decodeThreads ] arg (=4)     number of image decoding threads
+ *   -c [ --cache      ] arg             directory of the decoded image cache
  *
  * Datasets can be downloaded from: http://www.cvlibs.net/datasets/kitti/raw_data.php
  */
@@ -480,8 +475,11 @@ int main(int argc, char **argv)
     ("stereoDisp,s",  po::value<bool>         (&options.stereoDisp)       ->default_value(0) ->implicit_value(1)   ,  "use pre-calculated disparities")
     ("viewDisp  ,D ", po::value<bool>         (&options.viewDisparities)  ->default_value(0) ->implicit_value(1)   ,  "view loaded disparity images")
     ("frame     ,F",  po::value<unsigned int> (&options.startFrame)       ->default_value(0) ->implicit_value(0)   ,  "start playing at frame...")
+    ("sendTransform,t", po::value<bool>       (&options.sendTransform)    ->default_value(0) ->implicit_value(1)   ,  "publish the pose TF world -> base_link from the GPS/IMU data")
     ("gpsPoints ,p",  po::value<string>       (&options.gpsReferenceFrame)->default_value("")                      ,  "publish GPS/RTK markers to RVIZ, having reference frame as <reference_frame> [example: -p map]")
     ("synchMode ,S",  po::value<bool>         (&options.synchMode)        ->default_value(0) ->implicit_value(1)   ,  "Enable Synch mode (wait for signal to load next frame [std_msgs/Bool data: true]")
+    ("decodeThreads,j", po::value<unsigned int> (&options.decodeThreads)  ->default_value(4)                       ,  "number of threads decoding the images of the next frames")
+    ("cache     ,c",  po::value<string>       (&options.imageCache)       ->default_value("")                      ,  "directory of the decoded image cache, built on first play of a sequence and reused afterwards")
     ;
 
     try // parse options
@@ -563,12 +561,10 @@ int main(int argc, char **argv)
     string dir_Disparities    ;
     string full_filename_Disparities;
     string dir_oxts             ;
-    string full_filename_oxts;
     string dir_timestamp_oxts;
     string dir_velodyne_points  ;
     string full_filename_velodyne;
     string dir_timestamp_velodyne; //average of start&end (time of scan)
-    string str_support;
     cv::Mat cv_image00;
     cv::Mat cv_image01;
     cv::Mat cv_image02;
@@ -937,12 +933,108 @@ int main(int argc, char **argv)
         ros_cameraInfoMsg_camera01.width  = ros_cameraInfoMsg_camera00.width  = cv_image00.cols;// -1;
     }
 
+    // KITTI timestamps, parsed once for all frames
+    vector<ros::Time> timestamps_image00;
+    vector<ros::Time> timestamps_image01;
+    vector<ros::Time> timestamps_image02;
+    vector<ros::Time> timestamps_image03;
+    vector<ros::Time> timestamps_velodyne;
+    vector<ros::Time> timestamps_oxts;
+    if (options.timestamps)
+    {
+        ROS_INFO_STREAM("Loading timestamps...");
+        if (
+            ((options.grayscale || options.all_data) && (!loadTimestamps(dir_timestamp_image00  + "timestamps.txt", total_entries, timestamps_image00) ||
+                                                         !loadTimestamps(dir_timestamp_image01  + "timestamps.txt", total_entries, timestamps_image01)))
+            ||
+            ((options.color || options.all_data)     && (!loadTimestamps(dir_timestamp_image02  + "timestamps.txt", total_entries, timestamps_image02) ||
+                                                         !loadTimestamps(dir_timestamp_image03  + "timestamps.txt", total_entries, timestamps_image03)))
+            ||
+            ((options.velodyne || options.all_data)  && (!loadTimestamps(dir_timestamp_velodyne + "timestamps.txt", total_entries, timestamps_velodyne)))
+            ||
+            ((options.gps || options.imu || options.all_data || options.sendTransform) && (!loadTimestamps(dir_timestamp_oxts + "timestamps.txt", total_entries, timestamps_oxts)))
+        )
+        {
+            node.shutdown();
+            return -1;
+        }
+        ROS_INFO_STREAM("Loading timestamps... OK");
+    }
+
+    // OXTS records of all the frames, parsed once
+    kitti_utils::OxtsTable oxts;
+    if (options.gps || options.imu || options.all_data || options.sendTransform)
+    {
+        ROS_INFO_STREAM("Loading OXTS data...");
+        if (!oxts.LoadRawDirectory(dir_oxts, total_entries))
+        {
+            node.shutdown();
+            return -1;
+        }
+        ROS_INFO_STREAM("Loading OXTS data... OK");
+    }
+
+    // Poses of all the frames, the world frame starts at the first played frame.
+    // With the KITTI timestamps the pose is interpolated at the velodyne scan time.
+    kitti_utils::Trajectory trajectory;
+    if (options.sendTransform)
+    {
+        if (!trajectory.Build(oxts, entries_played) ||
+            (options.timestamps && !trajectory.SetStamps(timestamps_oxts)))
+        {
+            node.shutdown();
+            return -1;
+        }
+    }
+    tf::TransformBroadcaster tf_broadcaster;
+
+    // The images of the next frames are decoded in parallel while the current one is published,
+    // all cameras of a frame are decoded by different threads
+    kitti_utils::ImageDecodePool decode_pool(options.decodeThreads, 4);
+    int camera00 = -1, camera01 = -1, camera02 = -1, camera03 = -1, camera04 = -1;
+    if (options.grayscale || options.all_data)
+    {
+        camera00 = decode_pool.AddCamera("image_00", dir_image00 + "%010d.png", CV_LOAD_IMAGE_UNCHANGED);
+        camera01 = decode_pool.AddCamera("image_01", dir_image01 + "%010d.png", CV_LOAD_IMAGE_UNCHANGED);
+    }
+    if (options.color || options.all_data)
+    {
+        camera02 = decode_pool.AddCamera("image_02", dir_image02 + "%010d.png", CV_LOAD_IMAGE_UNCHANGED);
+        camera03 = decode_pool.AddCamera("image_03", dir_image03 + "%010d.png", CV_LOAD_IMAGE_UNCHANGED);
+    }
+    if (options.stereoDisp)
+        camera04 = decode_pool.AddCamera("disparities", dir_image04 + "%010d.png", CV_LOAD_IMAGE_GRAYSCALE);
+    // e.g. 2011_09_26_drive_0001_sync
+    string drive_name = dir_root.substr(0, dir_root.find_last_not_of('/') + 1);
+    drive_name = drive_name.substr(drive_name.find_last_of('/') + 1);
+    if (decode_pool.NumCameras() > 0 && !options.imageCache.empty())
+    {
+        // one cache file per drive, e.g. <cache>/2011_09_26_drive_0001_sync.imgcache
+        decode_pool.EnableCache(options.imageCache + "/" + drive_name + ".imgcache");
+    }
+    if (decode_pool.NumCameras() > 0)
+        decode_pool.Start(entries_played, total_entries);
+
     //display progress bar
     boost::progress_display progress(total_entries) ;
     double cv_min, cv_max = 0.0f;
     ros::Publisher publisher_GT_RTK;
     publisher_GT_RTK = node.advertise<visualization_msgs::MarkerArray> ("/kitti_player/GT_RTK", 1);
 
+    // Per stage latency histograms, published every second on /diagnostics and printed at the end.
+    // A frame misses its deadline when its processing takes longer than the replay period.
+    kitti_utils::FrameProfiler profiler("kitti_player", drive_name, options.frequency > 0 ? 1.0 / options.frequency : 0.0);
+    const int time_image_wait     = profiler.AddStage("image wait");
+    const int time_disparity      = profiler.AddStage("disparity publish");
+    const int time_color_publish  = profiler.AddStage("color publish");
+    const int time_gray_publish   = profiler.AddStage("gray publish");
+    const int time_cloud_read     = profiler.AddStage("cloud read");
+    const int time_oxts           = profiler.AddStage("oxts");
+    const int time_pose_tf        = profiler.AddStage("pose tf");
+    const int time_sleep          = profiler.AddStage("sleep");
+    ros::Publisher diagnostics_pub = node.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 1);
+    ros::WallTime next_diagnostics = ros::WallTime::now() + ros::WallDuration(1.0);
+
     // This is the main KITTI_PLAYER Loop
     do
     {
@@ -964,14 +1056,27 @@ int main(int argc, char **argv)
 
         // single timestamp for all published stuff
         Time current_timestamp = ros::Time::now();
+        ros::WallTime frame_start = ros::WallTime::now();
+
+        if (decode_pool.NumCameras() > 0)
+        {
+            // time the player waits for the decode workers, 0 when the frame was prefetched
+            kitti_utils::FrameProfiler::Timer timer(profiler, time_image_wait);
+            if (!decode_pool.WaitFrame(entries_played))
+            {
+                ROS_ERROR_STREAM("Error reading images of frame " << entries_played);
+                node.shutdown();
+                return -1;
+            }
+        }
 
         if (options.stereoDisp)
         {
+            kitti_utils::FrameProfiler::Timer timer(profiler, time_disparity);
             // Allocate new disparity image message
             stereo_msgs::DisparityImagePtr disp_msg = boost::make_shared<stereo_msgs::DisparityImage>();
 
-            full_filename_image04 = dir_image04 + boost::str(boost::format("%010d") % entries_played ) + ".png";
-            cv_image04 = cv::imread(full_filename_image04, CV_LOAD_IMAGE_GRAYSCALE);
+            cv_image04 = decode_pool.Image(entries_played, camera04);
 
             cv::minMaxLoc(cv_image04, &cv_min, &cv_max);
 
@@ -1015,12 +1120,13 @@ int main(int argc, char **argv)
         //publish 02 03 color camera image
         if (options.color || options.all_data)
         {
+            kitti_utils::FrameProfiler::Timer timer(profiler, time_color_publish);
             full_filename_image02 = dir_image02 + boost::str(boost::format("%010d") % entries_played ) + ".png";
             full_filename_image03 = dir_image03 + boost::str(boost::format("%010d") % entries_played ) + ".png";
             ROS_DEBUG_STREAM ( full_filename_image02 << endl << full_filename_image03 << endl << endl);
 
-            cv_image02 = cv::imread(full_filename_image02, CV_LOAD_IMAGE_UNCHANGED);
-            cv_image03 = cv::imread(full_filename_image03, CV_LOAD_IMAGE_UNCHANGED);
+            cv_image02 = decode_pool.Image(entries_played, camera02);
+            cv_image03 = decode_pool.Image(entries_played, camera03);
 
             if ( (cv_image02.data == NULL) || (cv_image03.data == NULL) )
             {
@@ -1048,18 +1154,7 @@ int main(int argc, char **argv)
             }
             else
             {
-
-                str_support = dir_timestamp_image02 + "timestamps.txt";
-                ifstream timestamps(str_support.c_str());
-                if (!timestamps.is_open())
-                {
-                    ROS_ERROR_STREAM("Fail to open " << str_support);
-                    node.shutdown();
-                    return -1;
-                }
-                timestamps.seekg(30 * entries_played);
-                getline(timestamps, str_support);
-                cv_bridge_img.header.stamp = parseTime(str_support).stamp;
+                cv_bridge_img.header.stamp = timestamps_image02[entries_played];
                 ros_msg02.header.stamp = ros_cameraInfoMsg_camera02.header.stamp = cv_bridge_img.header.stamp;
             }
             cv_bridge_img.image = cv_image02;
@@ -1073,17 +1168,7 @@ int main(int argc, char **argv)
             }
             else
             {
-                str_support = dir_timestamp_image03 + "timestamps.txt";
-                ifstream timestamps(str_support.c_str());
-                if (!timestamps.is_open())
-                {
-                    ROS_ERROR_STREAM("Fail to open " << str_support);
-                    node.shutdown();
-                    return -1;
-                }
-                timestamps.seekg(30 * entries_played);
-                getline(timestamps, str_support);
-                cv_bridge_img.header.stamp = parseTime(str_support).stamp;
+                cv_bridge_img.header.stamp = timestamps_image03[entries_played];
                 ros_msg03.header.stamp = ros_cameraInfoMsg_camera03.header.stamp = cv_bridge_img.header.stamp;
             }
 
@@ -1097,12 +1182,13 @@ int main(int argc, char **argv)
         //publish 00 01 gray image
         if (options.grayscale || options.all_data)
         {
+            kitti_utils::FrameProfiler::Timer timer(profiler, time_gray_publish);
             full_filename_image00 = dir_image00 + boost::str(boost::format("%010d") % entries_played ) + ".png";
             full_filename_image01 = dir_image01 + boost::str(boost::format("%010d") % entries_played ) + ".png";
             ROS_DEBUG_STREAM ( full_filename_image00 << endl << full_filename_image01 << endl << endl);
 
-            cv_image00 = cv::imread(full_filename_image00, CV_LOAD_IMAGE_UNCHANGED);
-            cv_image01 = cv::imread(full_filename_image01, CV_LOAD_IMAGE_UNCHANGED);
+            cv_image00 = decode_pool.Image(entries_played, camera00);
+            cv_image01 = decode_pool.Image(entries_played, camera01);
 
             if ( (cv_image00.data == NULL) || (cv_image01.data == NULL) )
             {
@@ -1130,18 +1216,7 @@ int main(int argc, char **argv)
             }
             else
             {
-
-                str_support = dir_timestamp_image02 + "timestamps.txt";
-                ifstream timestamps(str_support.c_str());
-                if (!timestamps.is_open())
-                {
-                    ROS_ERROR_STREAM("Fail to open " << str_support);
-                    node.shutdown();
-                    return -1;
-                }
-                timestamps.seekg(30 * entries_played);
-                getline(timestamps, str_support);
-                cv_bridge_img.header.stamp = parseTime(str_support).stamp;
+                cv_bridge_img.header.stamp = timestamps_image00[entries_played];
                 ros_msg00.header.stamp = ros_cameraInfoMsg_camera00.header.stamp = cv_bridge_img.header.stamp;
             }
             cv_bridge_img.image = cv_image00;
@@ -1154,18 +1229,7 @@ int main(int argc, char **argv)
             }
             else
             {
-
-                str_support = dir_timestamp_image02 + "timestamps.txt";
-                ifstream timestamps(str_support.c_str());
-                if (!timestamps.is_open())
-                {
-                    ROS_ERROR_STREAM("Fail to open " << str_support);
-                    node.shutdown();
-                    return -1;
-                }
-                timestamps.seekg(30 * entries_played);
-                getline(timestamps, str_support);
-                cv_bridge_img.header.stamp = parseTime(str_support).stamp;
+                cv_bridge_img.header.stamp = timestamps_image01[entries_played];
                 ros_msg01.header.stamp = ros_cameraInfoMsg_camera01.header.stamp = cv_bridge_img.header.stamp;
             }
             cv_bridge_img.image = cv_image01;
@@ -1178,6 +1242,7 @@ int main(int argc, char **argv)
         //publish velodyne lidar point cloud
         if (options.velodyne || options.all_data)
         {
+            kitti_utils::FrameProfiler::Timer timer(profiler, time_cloud_read);
             header_support.stamp = current_timestamp;
             full_filename_velodyne = dir_velodyne_points + boost::str(boost::format("%010d") % entries_played ) + ".bin";
 
@@ -1185,43 +1250,22 @@ int main(int argc, char **argv)
                 publish_velodyne(map_pub, full_filename_velodyne, &header_support);
             else
             {
-                str_support = dir_timestamp_velodyne + "timestamps.txt";
-                ifstream timestamps(str_support.c_str());
-                if (!timestamps.is_open())
-                {
-                    ROS_ERROR_STREAM("Fail to open " << str_support);
-                    node.shutdown();
-                    return -1;
-                }
-                timestamps.seekg(30 * entries_played);
-                getline(timestamps, str_support);
-                header_support.stamp = parseTime(str_support).stamp;
+                header_support.stamp = timestamps_velodyne[entries_played];
                 publish_velodyne(map_pub, full_filename_velodyne, &header_support);
             }
         }
         //publish GPS data
+        ros::WallTime oxts_start = ros::WallTime::now();
         if (options.gps || options.all_data)
         {
             header_support.stamp = current_timestamp; //ros::Time::now();
             if (options.timestamps)
             {
-                str_support = dir_timestamp_oxts + "timestamps.txt";
-                ifstream timestamps(str_support.c_str());
-                if (!timestamps.is_open())
-                {
-                    ROS_ERROR_STREAM("Fail to open " << str_support);
-                    node.shutdown();
-                    return -1;
-                }
-                timestamps.seekg(30 * entries_played);
-                getline(timestamps, str_support);
-                header_support.stamp = parseTime(str_support).stamp;
+                header_support.stamp = timestamps_oxts[entries_played];
             }
 
-            full_filename_oxts = dir_oxts + boost::str(boost::format("%010d") % entries_played ) + ".txt";
-            if (!getGPS(full_filename_oxts, &ros_msgGpsFix, &header_support))
+            if (!getGPS(oxts, entries_played, &ros_msgGpsFix, &header_support))
             {
-                ROS_ERROR_STREAM("Fail to open " << full_filename_oxts);
                 node.shutdown();
                 return -1;
             }
@@ -1232,16 +1276,15 @@ int main(int argc, char **argv)
                 // initial-gps-fix is taken. Fixing this issue forcing filename to
                 // 0000000001.txt
                 // The FULL dataset should be always downloaded.
-                full_filename_oxts = dir_oxts + "0000000001.txt";
-                if (!getGPS(full_filename_oxts, &ros_msgGpsFix, &header_support))
+                sensor_msgs::NavSatFix first_gps_fix;
+                if (!getGPS(oxts, 1, &first_gps_fix, &header_support))
                 {
-                    ROS_ERROR_STREAM("Fail to open " << full_filename_oxts);
                     node.shutdown();
                     return -1;
                 }
-                ROS_DEBUG_STREAM("Setting initial GPS fix at " << endl << ros_msgGpsFix);
+                ROS_DEBUG_STREAM("Setting initial GPS fix at " << endl << first_gps_fix);
                 firstGpsData = false;
-                ros_msgGpsFixInitial = ros_msgGpsFix;
+                ros_msgGpsFixInitial = first_gps_fix;
                 ros_msgGpsFixInitial.header.frame_id = "/local_map";
                 ros_msgGpsFixInitial.altitude = 0.0f;
             }
@@ -1253,8 +1296,6 @@ int main(int argc, char **argv)
             if (options.gpsReferenceFrame.length() > 1)
             {
 
-                Xy xyFromLatLon;
-                xyFromLatLon = latlon2xy_helper(ros_msgGpsFix.latitude, ros_msgGpsFix.longitude);
 
                 static visualization_msgs::MarkerArray marker_array_GT_RTK;
                 visualization_msgs::Marker RTK_MARKER;
@@ -1274,8 +1315,8 @@ int main(int argc, char **argv)
                 RTK_MARKER.color.r = 0;
                 RTK_MARKER.color.g = 0.0;
                 RTK_MARKER.color.b = 1.0;
-                RTK_MARKER.pose.position.x = xyFromLatLon.x;
-                RTK_MARKER.pose.position.y = xyFromLatLon.y;
+                RTK_MARKER.pose.position.x = oxts.UtmX(entries_played);
+                RTK_MARKER.pose.position.y = oxts.UtmY(entries_played);
                 RTK_MARKER.pose.position.z = 0;
 
                 ROS_DEBUG_STREAM(RTK_MARKER.pose.position.x << "\t" << RTK_MARKER.pose.position.y);
@@ -1293,36 +1334,74 @@ int main(int argc, char **argv)
             header_support.stamp = current_timestamp; //ros::Time::now();
             if (options.timestamps)
             {
-                str_support = dir_timestamp_oxts + "timestamps.txt";
-                ifstream timestamps(str_support.c_str());
-                if (!timestamps.is_open())
-                {
-                    ROS_ERROR_STREAM("Fail to open " << str_support);
-                    node.shutdown();
-                    return -1;
-                }
-                timestamps.seekg(30 * entries_played);
-                getline(timestamps, str_support);
-                header_support.stamp = parseTime(str_support).stamp;
+                header_support.stamp = timestamps_oxts[entries_played];
             }
 
 
-            full_filename_oxts = dir_oxts + boost::str(boost::format("%010d") % entries_played ) + ".txt";
-            if (!getIMU(full_filename_oxts, &ros_msgImu, &header_support))
+            if (!getIMU(oxts, entries_played, &ros_msgImu, &header_support))
             {
-                ROS_ERROR_STREAM("Fail to open " << full_filename_oxts);
                 node.shutdown();
                 return -1;
             }
             imu_pub.publish(ros_msgImu);
 
         }
+        if (options.gps || options.imu || options.all_data)
+            profiler.Record(time_oxts, (ros::WallTime::now() - oxts_start).toSec());
+
+        if (options.sendTransform)
+        {
+            kitti_utils::FrameProfiler::Timer timer(profiler, time_pose_tf);
+            geometry_msgs::TransformStamped pose_transform;
+            Eigen::Isometry3d pose = trajectory.Pose(entries_played);
+            pose_transform.header.stamp = current_timestamp;
+            if (options.timestamps)
+            {
+                if (!timestamps_velodyne.empty())
+                {
+                    pose_transform.header.stamp = timestamps_velodyne[entries_played];
+                    pose = trajectory.Interpolate(timestamps_velodyne[entries_played]);
+                }
+                else
+                    pose_transform.header.stamp = timestamps_oxts[entries_played];
+            }
+            pose_transform.header.frame_id = "world";
+            pose_transform.child_frame_id = "base_link";
+            pose_transform.transform.translation.x = pose.translation().x();
+            pose_transform.transform.translation.y = pose.translation().y();
+            pose_transform.transform.translation.z = pose.translation().z();
+            Eigen::Quaterniond q(pose.linear());
+            pose_transform.transform.rotation.x = q.x();
+            pose_transform.transform.rotation.y = q.y();
+            pose_transform.transform.rotation.z = q.z();
+            pose_transform.transform.rotation.w = q.w();
+            tf_broadcaster.sendTransform(pose_transform);
+        }
+
+        // images were copied into the messages, the slot can be filled with a next frame
+        if (decode_pool.NumCameras() > 0)
+            decode_pool.ReleaseFrame(entries_played);
+
+        ros::WallTime frame_end = ros::WallTime::now();
+        profiler.RecordFrame(entries_played, (frame_end - frame_start).toSec());
+        if (frame_end >= next_diagnostics)
+        {
+            diagnostic_msgs::DiagnosticArrayPtr diagnostics = boost::make_shared<diagnostic_msgs::DiagnosticArray>();
+            diagnostics->header.stamp = current_timestamp;
+            diagnostics->status.resize(1);
+            profiler.FillStatus(diagnostics->status[0]);
+            diagnostics_pub.publish(diagnostics);
+            next_diagnostics = frame_end + ros::WallDuration(1.0);
+        }
 
         ++progress;
         entries_played++;
 
         if (!options.synchMode)
+        {
+            kitti_utils::FrameProfiler::Timer timer(profiler, time_sleep);
             loop_rate.sleep();
+        }
     }
     while (entries_played <= total_entries - 1 && ros::ok());
 
@@ -1340,6 +1419,9 @@ int main(int argc, char **argv)
     }
 
 
+    profiler.PrintSummary();
+    decode_pool.PrintStats();
+
     ROS_INFO_STREAM("Done!");
     node.shutdown();
 
@@ -58,6 +58,8 @@
 #include <time.h>
 #include <Eigen/Dense>
 
+#include <kitti_common/cloud_utils.h>
+
 using namespace std;
 using namespace pcl;
 using namespace ros;
@@ -70,68 +72,9 @@ static Eigen::Matrix4f transform_needed;
 static Eigen::Matrix4f R_rect_00;
 static Eigen::MatrixXf project_matrix(3,4);
 
-template <class PointT>
-bool ProjectPoint2Image(const PointT& pointIn, const Eigen::MatrixXf& projectmatrix, cv::Point2f& point_project)
-{
-  //check project matrix size
-  if(!(projectmatrix.rows()==3&&projectmatrix.cols()==4)) {
-    std::cout<<"[WARN] project matrix size need be 3x4!"<<std::endl;
-    return false;
-  }
-
-  //apply the projection operation
-  Eigen::Vector4f point_3d(pointIn.x, pointIn.y, pointIn.z, 1.0);//define homogenious coordniate
-  Eigen::Vector3f point_temp = projectmatrix*point_3d;
-  //get image coordinates
-  float x = static_cast<float>(point_temp[0]/point_temp[2]);
-  float y = static_cast<float>(point_temp[1]/point_temp[2]);
-  point_project = cv::Point2f(x,y);
-  return true;
-}
-
-cv::Mat ProjectCloud2Image(const pcl::PointCloud<pcl::PointXYZI>::ConstPtr cloudIn, const cv::Mat& imageIn, const Eigen::MatrixXf& projectmatrix)
-{
-  cv::Mat hsv_image, res_image;
-  cv::cvtColor(imageIn, hsv_image, CV_BGR2HSV);
-  int scale = 120, min_dis = 1, max_dis = 70;
-  auto toColor = [&](const pcl::PointXYZI& point)->int{
-    //1)calculate point distance
-    float distance = std::sqrt(point.x*point.x + point.y*point.y + point.z*point.z);
-    //2)calculate color value, normalize values to (0 - scale) & close distance value has low value.
-    int res = ((distance - min_dis) / (max_dis - min_dis))*scale;
-    return res;
-  };
-  // plot color points using distance encode HSV color
-  for(int i = 0;i<cloudIn->size();++i){
-    if(cloudIn->points[i].y < 0)
-      continue;
-    int color = toColor(cloudIn->points[i]);
-    cv::Point2f image_point;
-    ProjectPoint2Image(cloudIn->points[i],projectmatrix, image_point);
-    cv::circle(hsv_image, image_point, 2, cv::Scalar(color, 255, 255), -1);
-  }
-  cv::cvtColor(hsv_image, res_image,CV_HSV2BGR);
-  return res_image;
-}
-
-pcl::PointCloud<pcl::PointXYZI>::Ptr TransformKittiCloud(pcl::PointCloud<pcl::PointXYZI>::Ptr kitti_cloud, bool do_z_shift = false, float z_shift_value = 1.73)
-{
-  //do transformation
-  Eigen::Affine3f transform_matrix = Eigen::Affine3f::Identity();
-  // Define translation
-  if(do_z_shift)
-    transform_matrix.translation() << 0.0, 0.0, 1.73;
-  else
-    transform_matrix.translation() << 0.0, 0.0, 0.0;
-  // The same rotation matrix as before; theta radians around Z axis
-  transform_matrix.rotate (Eigen::AngleAxisf (M_PI/2, Eigen::Vector3f::UnitZ()));
-
-  // Executing the transformation
-  pcl::PointCloud<pcl::PointXYZI>::Ptr transformed_cloud (new pcl::PointCloud<pcl::PointXYZI>());
-  // You can either apply transform_1 or transform_2; they are the same
-  pcl::transformPointCloud (*kitti_cloud, *transformed_cloud, transform_matrix);
-  return transformed_cloud;
-}
+// Cloud rotation and image projection of the kitti_tracking_player utilities
+using kitti_utils::ProjectCloud2Image;
+using kitti_utils::TransformKittiCloud;
 
 struct kitti_player_options
 {
@@ -664,6 +607,7 @@ int main(int argc, char **argv)
     cv::Mat cv_image03;
     cv::Mat cv_image04;
     cv::Mat cv_disparities;
+    pcl::PointCloud<pcl::PointXYZI>::Ptr rotated_points(new pcl::PointCloud<pcl::PointXYZI>); // reused by the projection
     std_msgs::Header header_support;
 
     image_transport::ImageTransport it(node);
@@ -1417,8 +1361,10 @@ int main(int argc, char **argv)
         Eigen::MatrixXf transform_matrix(3,4);
         transform_matrix = project_matrix*R_rect_00*RT_velo_to_cam*transform_needed;
 
-        points_pub = TransformKittiCloud(points_pub, true, 1.73);
-        cv::Mat img_fusion_result = ProjectCloud2Image(points_pub, cv_image02, transform_matrix);
+        // the loaded scan is rotated in one pass into a reused cloud, instead of a new rotated cloud every frame
+        if (points_pub)
+            TransformKittiCloud(*points_pub, *rotated_points, true, 1.73);
+        cv::Mat img_fusion_result = ProjectCloud2Image(rotated_points, cv_image02, transform_matrix);
         std::cout<<"transform_matrix"<<
             transform_matrix<<endl;
         cv::namedWindow("img_fusion_result", CV_WINDOW_NORMAL);
@@ -32,6 +32,8 @@ limitations under the License.
 
 #include <eigen3/Eigen/Core>
 
+#include "tracklet_labeller.h"
+
 KittiDataset::KittiDataset(int dataset) :
     _dataset(dataset),
     _number_of_frames(0)
@@ -94,6 +96,27 @@ KittiPointCloud::Ptr KittiDataset::getTrackletPointCloud(KittiPointCloud::Ptr& p
     return trackletPointCloud;
 }
 
+std::vector<KittiPointCloud::Ptr> KittiDataset::getTrackletPointClouds(KittiPointCloud::Ptr& pointCloud, int frameId, std::vector<int>& trackletIds)
+{
+    if (!_labeller)
+    {
+        _labeller.reset(new kitti_utils::TrackletLabeller());
+    }
+    _labeller->SetTracklets(_tracklets, frameId);
+    _labeller->Label(*pointCloud);
+
+    std::vector<KittiPointCloud::Ptr> trackletPointClouds;
+    trackletIds.clear();
+    for (size_t i = 0; i < _labeller->NumBoxes(); ++i)
+    {
+        KittiPointCloud::Ptr trackletPointCloud(new KittiPointCloud());
+        pcl::copyPointCloud(*pointCloud, _labeller->Indices(i), *trackletPointCloud);
+        trackletPointClouds.push_back(trackletPointCloud);
+        trackletIds.push_back(_labeller->Box(i).instance);
+    }
+    return trackletPointClouds;
+}
+
 Tracklets& KittiDataset::getTracklets()
 {
     return _tracklets;
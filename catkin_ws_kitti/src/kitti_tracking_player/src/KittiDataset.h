@@ -20,6 +20,7 @@ limitations under the License.
 #define KITTIDATASET_H
 
 #include <string>
+#include <vector>
 
 #include <boost/filesystem.hpp>
 #include <boost/shared_ptr.hpp>
@@ -35,6 +36,10 @@ typedef pcl::PointXYZI KittiPoint;
 typedef pcl::PointCloud<KittiPoint> KittiPointCloud;
 typedef Tracklets::tTracklet KittiTracklet;
 
+namespace kitti_utils {
+class TrackletLabeller;
+}
+
 /**
  * @brief Class used to 
  */
@@ -46,6 +51,9 @@ public:
     int getNumberOfFrames();
     KittiPointCloud::Ptr getPointCloud(int frameId);
     KittiPointCloud::Ptr getTrackletPointCloud(KittiPointCloud::Ptr& pointCloud, const KittiTracklet& tracklet, int frameId);
+    /** Points of all the tracklets active at frameId in one pass over the cloud, trackletIds gets the id of each cloud.
+        The labeller buffers are kept between calls. */
+    std::vector<KittiPointCloud::Ptr> getTrackletPointClouds(KittiPointCloud::Ptr& pointCloud, int frameId, std::vector<int>& trackletIds);
     Tracklets& getTracklets();
 
     static int getLabel(const char* labelString);
@@ -61,6 +69,9 @@ private:
 
     Tracklets _tracklets;
     void initTracklets();
+
+    /** Labeller of getTrackletPointClouds, created on the first call */
+    boost::shared_ptr<kitti_utils::TrackletLabeller> _labeller;
 };
 
 #endif // KITTIDATASET_H
@@ -0,0 +1,25 @@
+/*
+ * @Description: Math functions on Eigen arrays for the vectorized per point passes over the scans
+ * @References: Abramowitz and Stegun, Handbook of Mathematical Functions, 4.4.49
+ */
+#pragma once
+
+// Eigen
+#include <Eigen/Core>
+
+namespace kitti_utils {
+
+/// atan2 within 1.2e-5 rad (Abramowitz and Stegun 4.4.49) as an array expression, so that it is vectorized
+/// like the rest of the pass instead of one std::atan2 call per point
+inline Eigen::ArrayXf FastAtan2(const Eigen::ArrayXf& y, const Eigen::ArrayXf& x) {
+  const float pi = 3.14159265f;
+  const Eigen::ArrayXf ax = x.abs(), ay = y.abs();
+  const Eigen::ArrayXf a = ax.min(ay) / (ax.max(ay) + 1e-30f);
+  const Eigen::ArrayXf s = a.square();
+  Eigen::ArrayXf r = a * (0.9998660f + s * (-0.3302995f + s * (0.1801410f + s * (-0.0851330f + s * 0.0208351f))));
+  r = (ay > ax).select(0.5f * pi - r, r);
+  r = (x < 0.0f).select(pi - r, r);
+  return (y < 0.0f).select(-r, r);
+}
+
+} // namespace kitti_utils
@@ -0,0 +1,107 @@
+/*
+ * @Description: Project the 3D boxes of a frame into the image of camera 2
+ * @References:
+ */
+
+#include "box_projector.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+namespace kitti_utils {
+
+namespace {
+/// Corner pairs of the box edges: bottom face, top face, vertical edges
+const int kEdges[12][2] = {{0, 1}, {1, 2}, {2, 3}, {3, 0},
+                           {4, 5}, {5, 6}, {6, 7}, {7, 4},
+                           {0, 4}, {1, 5}, {2, 6}, {3, 7}};
+/// Points closer to the camera plane are cut (m)
+const float kNearDepth = 0.1f;
+}
+
+BoxProjector::BoxProjector()
+    : has_calibration_(false),
+      velo_to_image_(Eigen::Matrix<float, 3, 4>::Zero()) {
+}
+
+void BoxProjector::SetCalibration(const Calibration& calib) {
+  has_calibration_ = calib.P2().rows() == 3 && calib.P2().cols() == 4 &&
+                     calib.R_Rect_0().rows() == 3 && calib.R_Rect_0().cols() == 3 &&
+                     calib.Velo2Cam().rows() == 3 && calib.Velo2Cam().cols() == 4;
+  if (has_calibration_) {
+    velo_to_image_ = calib.GetVelo2ImageMatrix();
+  }
+}
+
+void BoxProjector::Project(const Eigen::Matrix3Xf& corners, const cv::Size& image_size) {
+  const int num_boxes = corners.cols() / 8;
+  boxes_.resize(num_boxes);
+  if (!has_calibration_) {
+    for (ProjectedBox& box : boxes_) {
+      box.visible = false;
+      box.num_edges = 0;
+    }
+    return;
+  }
+
+  // Homogeneous image coordinates of all the corners, the third row is the depth
+  image_points_.noalias() = velo_to_image_.leftCols<3>() * corners;
+  image_points_.colwise() += velo_to_image_.col(3);
+
+  const cv::Rect image_rect(0, 0, image_size.width, image_size.height);
+  for (int b = 0; b < num_boxes; ++b) {
+    ProjectedBox& box = boxes_[b];
+    box.num_edges = 0;
+    float min_u = INFINITY, min_v = INFINITY, max_u = -INFINITY, max_v = -INFINITY;
+    for (int e = 0; e < 12; ++e) {
+      Eigen::Vector3f p0 = image_points_.col(8 * b + kEdges[e][0]);
+      Eigen::Vector3f p1 = image_points_.col(8 * b + kEdges[e][1]);
+      if (p0.z() < kNearDepth && p1.z() < kNearDepth) {
+        continue;
+      }
+      // Cut at the near plane, the projection is linear in homogeneous coordinates
+      if (p0.z() < kNearDepth) {
+        p0 = p0 + (p1 - p0) * ((kNearDepth - p0.z()) / (p1.z() - p0.z()));
+      } else if (p1.z() < kNearDepth) {
+        p1 = p1 + (p0 - p1) * ((kNearDepth - p1.z()) / (p0.z() - p1.z()));
+      }
+      cv::Point2f* edge = box.edges[box.num_edges++];
+      edge[0] = cv::Point2f(p0.x() / p0.z(), p0.y() / p0.z());
+      edge[1] = cv::Point2f(p1.x() / p1.z(), p1.y() / p1.z());
+      for (int i = 0; i < 2; ++i) {
+        min_u = std::min(min_u, edge[i].x);
+        min_v = std::min(min_v, edge[i].y);
+        max_u = std::max(max_u, edge[i].x);
+        max_v = std::max(max_v, edge[i].y);
+      }
+    }
+    box.visible = false;
+    if (box.num_edges > 0) {
+      // Clamp before the conversion to int, far outside points can overflow
+      const float width = image_size.width, height = image_size.height;
+      cv::Point top_left(std::floor(std::max(0.0f, std::min(min_u, width))),
+                         std::floor(std::max(0.0f, std::min(min_v, height))));
+      cv::Point bottom_right(std::ceil(std::max(0.0f, std::min(max_u, width))),
+                             std::ceil(std::max(0.0f, std::min(max_v, height))));
+      box.bbox = cv::Rect(top_left, bottom_right) & image_rect;
+      box.visible = box.bbox.area() > 0;
+    }
+  }
+}
+
+void BoxProjector::Draw(const ProjectedBox& box, const cv::Scalar& color, cv::Mat& image) {
+  if (!box.visible) {
+    return;
+  }
+  // cv::line clips to the image, points are clamped only to stay in the int range
+  auto to_pixel = [](const cv::Point2f& p) {
+    return cv::Point(std::max(-1e6f, std::min(p.x, 1e6f)), std::max(-1e6f, std::min(p.y, 1e6f)));
+  };
+  for (int e = 0; e < box.num_edges; ++e) {
+    cv::line(image, to_pixel(box.edges[e][0]), to_pixel(box.edges[e][1]), color, 2);
+  }
+}
+
+} // namespace kitti_utils
@@ -0,0 +1,58 @@
+/*
+ * @Description: Project the 3D boxes of a frame into the image of camera 2
+ * @References:
+ */
+#pragma once
+
+// C++
+#include <vector>
+// Eigen
+#include <Eigen/Core>
+// OpenCV
+#include <opencv2/core/core.hpp>
+
+#include "kitti_utils.h"
+
+namespace kitti_utils {
+
+/// One 3D box in the image
+struct ProjectedBox {
+  bool visible;            // part of the box is in front of the camera and in the image
+  cv::Rect bbox;           // bounding rectangle of the visible part, clipped to the image
+  int num_edges;           // visible edges, parts behind the camera removed
+  cv::Point2f edges[12][2];
+};
+
+/**
+ * @brief Project box corners from the velodyne frame to the image of camera 2 (P2 * R_rect * Tr_velo_cam).
+ *        All the corners of a frame are projected with one matrix product, edges crossing the near
+ *        plane are cut in homogeneous coordinates before the division so boxes partly behind the
+ *        camera are still drawn correctly.
+ */
+class BoxProjector {
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  BoxProjector();
+
+  void SetCalibration(const Calibration& calib);
+
+  /**
+   * @brief Project the boxes, results in Boxes()
+   * @param corners 8 columns per box, in the order of ObjectStateBuilder::Corners()
+   */
+  void Project(const Eigen::Matrix3Xf& corners, const cv::Size& image_size);
+
+  const std::vector<ProjectedBox>& Boxes() const { return boxes_; }
+
+  /// Draw the visible edges of a box
+  static void Draw(const ProjectedBox& box, const cv::Scalar& color, cv::Mat& image);
+
+private:
+  bool has_calibration_;
+  Eigen::Matrix<float, 3, 4> velo_to_image_;
+  Eigen::Matrix3Xf image_points_;  // homogeneous, 8 columns per box
+  std::vector<ProjectedBox> boxes_;
+};
+
+} // namespace kitti_utils
@@ -0,0 +1,88 @@
+/*
+ * @Description: Motion compensation of the velodyne scans with the ego trajectory
+ * @References: KITTI raw data devkit, the velodyne scan is synchronized with the cameras when facing forward
+ */
+
+#include "cloud_deskewer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "array_math.h"
+#include "kitti_utils.h"
+
+namespace kitti_utils {
+
+namespace {
+/// Points corrected per block of the vectorized pass, the block arrays stay in L1
+const int kBlockSize = 256;
+}
+
+CloudDeskewer::CloudDeskewer(unsigned int num_bins, double scan_period)
+    : num_bins_(num_bins > 0 ? num_bins : 1),
+      scan_period_(scan_period),
+      imu_to_velo_(Eigen::Isometry3d::Identity()),
+      velo_to_imu_(Eigen::Isometry3d::Identity()),
+      bin_transforms_(num_bins_) {
+}
+
+void CloudDeskewer::SetImuToVelo(const Eigen::Isometry3d& imu_to_velo) {
+  imu_to_velo_ = imu_to_velo;
+  velo_to_imu_ = imu_to_velo.inverse();
+}
+
+bool CloudDeskewer::Deskew(const Trajectory& trajectory, const ros::Time& scan_time,
+                           const sensor_msgs::PointCloud2& in, sensor_msgs::PointCloud2& out) {
+  if (!trajectory.HasStamps()) {
+    return false;
+  }
+
+  // Velodyne frame at a bin time -> velodyne frame at scan_time
+  // Bin times in seconds, the first bins of a scan stamped 0 are before 0, out of the ros::Time range
+  const double scan_seconds = scan_time.toSec();
+  const Eigen::Isometry3d reference_inverse = trajectory.Interpolate(scan_seconds).inverse();
+  const double bin_width = 2.0 * M_PI / num_bins_;
+  for (unsigned int bin = 0; bin < num_bins_; ++bin) {
+    double azimuth = -M_PI + (bin + 0.5) * bin_width;
+    const double bin_time = scan_seconds - azimuth / (2.0 * M_PI) * scan_period_;
+    Eigen::Isometry3d correction = imu_to_velo_ * reference_inverse * trajectory.Interpolate(bin_time) * velo_to_imu_;
+    bin_transforms_[bin] = correction.matrix().topRows<3>().cast<float>();
+  }
+
+  out.header = in.header;
+  out.height = in.height;
+  out.width = in.width;
+  out.fields = in.fields;
+  out.is_bigendian = in.is_bigendian;
+  out.point_step = in.point_step;
+  out.row_step = in.row_step;
+  out.is_dense = in.is_dense;
+  out.data.resize(in.data.size());
+
+  // Bins of a block of points with Eigen array expressions, then one 3x4 product per point
+  const float* src = reinterpret_cast<const float*>(GetVeloPoints(in));
+  float* dst = reinterpret_cast<float*>(out.data.data());
+  const size_t num_points = GetVeloPointsSize(in);
+  const float bins_per_radian = num_bins_ / (2.0f * static_cast<float>(M_PI));
+  const int max_bin = num_bins_ - 1;
+  Eigen::ArrayXf x(kBlockSize), y(kBlockSize);
+  for (size_t start = 0; start < num_points; start += kBlockSize) {
+    const int count = static_cast<int>(std::min<size_t>(kBlockSize, num_points - start));
+    Eigen::Map<const Eigen::Array<float, 4, Eigen::Dynamic> > points(src + 4 * start, 4, count);
+    Eigen::Map<Eigen::Array<float, 4, Eigen::Dynamic> > corrected(dst + 4 * start, 4, count);
+    x.resize(count);
+    y.resize(count);
+    x = points.row(0).transpose();
+    y = points.row(1).transpose();
+    bins_.resize(count);
+    bins_ = ((FastAtan2(y, x) + static_cast<float>(M_PI)) * bins_per_radian).cast<int>().max(0).min(max_bin);
+    for (int i = 0; i < count; ++i) {
+      const Matrix34f& m = bin_transforms_[bins_[i]];
+      corrected.col(i).head<3>() = m.leftCols<3>() * points.col(i).head<3>().matrix() + m.col(3);
+      corrected(3, i) = points(3, i);
+    }
+  }
+  return true;
+}
+
+} // namespace kitti_utils
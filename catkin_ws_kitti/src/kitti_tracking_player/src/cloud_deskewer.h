@@ -0,0 +1,65 @@
+/*
+ * @Description: Motion compensation of the velodyne scans with the ego trajectory
+ * @References: KITTI raw data devkit, the velodyne scan is synchronized with the cameras when facing forward
+ */
+#pragma once
+
+// C++
+#include <vector>
+// Eigen
+#include <Eigen/Geometry>
+#include <Eigen/StdVector>
+// ROS
+#include <ros/time.h>
+#include <sensor_msgs/PointCloud2.h>
+
+#include <kitti_common/trajectory.h>
+
+namespace kitti_utils {
+
+/**
+ * @brief Remove the ego motion distortion of velodyne scans.
+ *        The HDL-64E turns clockwise and the KITTI scans are triggered when it faces forward,
+ *        so a point at azimuth a was measured at scan_time - a / (2 pi) * scan_period.
+ *        Every point is moved into the sensor frame at scan_time. The correction is computed
+ *        for a fixed number of azimuth bins per scan (interpolated pose, one 3x4 matrix per bin),
+ *        the per point work is one atan2, vectorized over blocks of points, and one matrix product.
+ */
+class CloudDeskewer {
+public:
+  /**
+   * @param num_bins number of azimuth bins, i.e. of poses interpolated per scan
+   * @param scan_period duration of a scan (s), 0.1 for the 10 Hz KITTI recordings
+   */
+  explicit CloudDeskewer(unsigned int num_bins = 180, double scan_period = 0.1);
+
+  /// Extrinsics from the oxts-unit to the velodyne (Tr_imu_velo), identity by default
+  void SetImuToVelo(const Eigen::Isometry3d& imu_to_velo);
+
+  /**
+   * @brief Motion compensate a cloud in the VeloPoint layout (ReadVeloPoints)
+   * @param trajectory ego poses of the sequence, with timestamps
+   * @param scan_time time of the scan in the trajectory time, when the sensor faces forward
+   * @param in raw scan
+   * @param out corrected scan, same fields and point order as in, its buffer is reused
+   * @return false if the trajectory has no timestamps
+   */
+  bool Deskew(const Trajectory& trajectory, const ros::Time& scan_time,
+              const sensor_msgs::PointCloud2& in, sensor_msgs::PointCloud2& out);
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+private:
+  typedef Eigen::Matrix<float, 3, 4> Matrix34f;
+
+  unsigned int num_bins_;
+  double scan_period_;
+  Eigen::Isometry3d imu_to_velo_;
+  Eigen::Isometry3d velo_to_imu_;
+  // Correction of every azimuth bin, reused between scans
+  std::vector<Matrix34f, Eigen::aligned_allocator<Matrix34f> > bin_transforms_;
+  // Bin of every point of a block of the vectorized pass
+  Eigen::ArrayXi bins_;
+};
+
+} // namespace kitti_utils
@@ -0,0 +1,52 @@
+/*
+ * @Description: Layout of the frame records written in the shards by kitti_exporter
+ * @References: KITTI tracking devkit, readme.txt of the label_02 folder
+ */
+#pragma once
+
+// C++
+#include <cstdint>
+
+namespace kitti_utils {
+
+/**
+ * A frame record is, in little endian and without padding:
+ *   FrameRecordHeader
+ *   num_points   x 4 float32   velodyne points x, y, z, intensity (the .bin file content)
+ *   num_objects  x FrameRecordObject
+ *   image_bytes  x uint8       image_02 PNG file content, not decoded
+ * The record of sequence s and frame f has the key %04d/%06d (s, f) in the shard index.
+ */
+const char kFrameRecordMagic[4] = {'K', 'T', 'F', 'R'};
+const uint32_t kFrameRecordVersion = 2;
+
+struct FrameRecordHeader {
+  char magic[4];             // kFrameRecordMagic
+  uint32_t version;          // kFrameRecordVersion
+  uint32_t sequence;
+  uint32_t frame;
+  uint32_t num_points;
+  uint32_t num_objects;
+  uint32_t image_bytes;
+  uint32_t reserved;
+  float P2[12];              // 3x4 row major, projection of the rectified camera 2
+  float R_rect[9];           // 3x3 row major, rectifying rotation
+  float Tr_velo_cam[12];     // 3x4 row major, velodyne to camera
+};
+
+/// One object of label_02, all the objects are kept (version 1 had the display filter of the player)
+struct FrameRecordObject {
+  int32_t track_id;
+  int32_t label;             // KittiDataset::getLabel() of the type, -1 for DontCare
+  int32_t occluded;
+  float alpha;
+  float bbox[4];             // left, top, right, bottom in image_02 (pixels)
+  float height, width, length;  // box dimensions (m)
+  float x, y, z;             // bottom center in camera coordinates (m)
+  float ry;                  // rotation around the camera y axis (rad)
+};
+
+static_assert(sizeof(FrameRecordHeader) == 32 + 33 * sizeof(float), "FrameRecordHeader must not be padded");
+static_assert(sizeof(FrameRecordObject) == 15 * 4, "FrameRecordObject must not be padded");
+
+} // namespace kitti_utils
@@ -0,0 +1,373 @@
+/*
+ * @Description: Micro-benchmarks of the dataset readers and of the geometry kernels on a KITTI tracking sequence
+ * @References:
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <Eigen/Geometry>
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <boost/program_options.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <ros/console.h>
+#include <sensor_msgs/PointCloud2.h>
+
+#include <kitti_common/cloud_utils.h>
+#include <kitti_common/oxts_table.h>
+
+#include "KittiConfig.h"
+#include "KittiDataset.h"
+#include "kitti_track_label.h"
+#include "kitti_utils.h"
+#include "range_image.h"
+
+namespace po = boost::program_options;
+using std::string;
+using std::vector;
+
+namespace {
+
+struct BenchmarkOptions {
+  string path;          // tracking dataset split, e.g. .../tracking/training
+  string sequence;      // sequence to read, e.g. 0000
+  unsigned int frames;  // number of velodyne scans used by the cloud benchmarks
+  unsigned int repeat;  // repetitions of every benchmark, the fastest one is reported
+  int dataset;          // KittiConfig dataset number for KittiDataset::getPointCloud
+};
+
+/// Result of the fastest repetition of a benchmark
+struct Result {
+  string name;
+  double seconds;
+  uint64_t items;  // points, labels or coordinates processed
+  uint64_t bytes;  // input bytes processed
+  const char* unit;
+};
+
+/// Default image size of the KITTI color camera, used when no image can be read
+const int kImageWidth = 1242;
+const int kImageHeight = 375;
+/// Tracklet boxes placed around the vehicle by the crop benchmark
+const int kNumBoxes = 16;
+/// Coordinates converted by the LatLon2Xy benchmarks when the sequence has no oxts file
+const int kNumCoordinates = 100000;
+
+/// Run f repeat times, the fastest run (s)
+template <typename F>
+double BestOf(unsigned int repeat, F f) {
+  double best = INFINITY;
+  for (unsigned int r = 0; r < std::max(1u, repeat); ++r) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  }
+  return best;
+}
+
+void PrintHeader() {
+  std::printf("%-40s %12s %14s %10s\n", "benchmark", "time (ms)", "ns/item", "MB/s");
+}
+
+void Print(const Result& result) {
+  const double ns_per_item = result.items > 0 ? result.seconds * 1e9 / result.items : 0.0;
+  const double mb_per_s = result.seconds > 0.0 ? result.bytes / result.seconds / (1 << 20) : 0.0;
+  std::printf("%-40s %12.3f %9.2f ns/%-5s %10.1f\n", result.name.c_str(), result.seconds * 1e3, ns_per_item,
+              result.unit, mb_per_s);
+}
+
+uint64_t FileSize(const string& path) {
+  boost::system::error_code error;
+  uint64_t size = boost::filesystem::file_size(path, error);
+  return error ? 0 : size;
+}
+
+/// Car sized tracklets on rings around the vehicle, present in all the frames
+vector<KittiTracklet> MakeTracklets(unsigned int num_frames) {
+  vector<KittiTracklet> tracklets;
+  for (int i = 0; i < kNumBoxes; ++i) {
+    const double angle = 2.0 * M_PI * i / kNumBoxes;
+    const double radius = 8.0 + 2.0 * (i % 4);
+    Tracklets::tPose pose;
+    pose.tx = radius * std::cos(angle);
+    pose.ty = radius * std::sin(angle);
+    pose.tz = -1.73;
+    pose.rx = 0.0;
+    pose.ry = 0.0;
+    pose.rz = angle;
+    tracklets.push_back(KittiTracklet("Car", 1.6f, 1.8f, 4.5f, 0, vector<Tracklets::tPose>(num_frames, pose), 1));
+  }
+  return tracklets;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  BenchmarkOptions options;
+
+  po::options_description desc("kitti_benchmark, time the dataset readers and the geometry kernels on a KITTI tracking sequence\n\nAllowed options", 200);
+  desc.add_options()
+  ("help,h", "help message")
+  ("directory ,d", po::value<string>(&options.path)->required(), "*required* - path to the kitti tracking split, e.g. .../tracking/training")
+  ("sequence  ,s", po::value<string>(&options.sequence)->default_value("0000"), "sequence to read")
+  ("frames    ,n", po::value<unsigned int>(&options.frames)->default_value(20), "number of velodyne scans of the cloud benchmarks")
+  ("repeat    ,r", po::value<unsigned int>(&options.repeat)->default_value(5), "repetitions of every benchmark, the fastest is reported")
+  ("dataset   ,D", po::value<int>(&options.dataset)->default_value(KittiConfig::getDatasetNumber(5)), "KittiConfig dataset of KittiDataset::getPointCloud, skipped if not found");
+
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    if (vm.count("help")) {
+      std::cout << desc << std::endl;
+      return 0;
+    }
+    po::notify(vm);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl << desc << std::endl;
+    return -1;
+  }
+
+  const string root = options.path.substr(0, options.path.find_last_not_of('/') + 1) + "/";
+  vector<string> velo_files;
+  uint64_t velo_bytes = 0;
+  for (unsigned int frame = 0; frame < options.frames; ++frame) {
+    string file = root + "velodyne/" + options.sequence + "/" + boost::str(boost::format("%06d") % frame) + ".bin";
+    if (!boost::filesystem::exists(file))
+      break;
+    velo_files.push_back(file);
+    velo_bytes += FileSize(file);
+  }
+  if (velo_files.empty()) {
+    ROS_ERROR_STREAM("No velodyne scan in " << root << "velodyne/" << options.sequence);
+    return -1;
+  }
+  const uint64_t num_points = velo_bytes / sizeof(kitti_utils::VeloPoint);
+  ROS_INFO_STREAM("Sequence " << options.sequence << ": " << velo_files.size() << " scans, " << num_points << " points");
+
+  // Clouds kept in memory for the geometry kernels
+  vector<KittiPointCloud::Ptr> clouds;
+  for (const string& file : velo_files) {
+    KittiPointCloud::Ptr cloud(new KittiPointCloud);
+    kitti_utils::ReadVeloPoints(file, *cloud);
+    clouds.push_back(cloud);
+  }
+  uint64_t num_cloud_points = 0;
+  for (const KittiPointCloud::Ptr& cloud : clouds)
+    num_cloud_points += cloud->size();
+  const uint64_t cloud_bytes = num_cloud_points * sizeof(kitti_utils::VeloPoint);
+
+  vector<Result> results;
+  const unsigned int repeat = options.repeat;
+
+  // Dataset I/O, the files are in the page cache after the first repetition
+  {
+    sensor_msgs::PointCloud2 message;
+    double seconds = BestOf(repeat, [&] {
+      for (const string& file : velo_files)
+        kitti_utils::ReadVeloPoints(file, message);
+    });
+    results.push_back(Result{"ReadVeloPoints PointCloud2", seconds, num_points, velo_bytes, "point"});
+  }
+  {
+    KittiPointCloud cloud;
+    double seconds = BestOf(repeat, [&] {
+      for (const string& file : velo_files) {
+        cloud.clear();
+        kitti_utils::ReadVeloPoints(file, cloud);
+      }
+    });
+    results.push_back(Result{"ReadVeloPoints pcl", seconds, num_points, velo_bytes, "point"});
+  }
+
+  KittiDataset dataset(options.dataset);
+  if (boost::filesystem::exists(KittiConfig::getPointCloudPath(options.dataset, 0))) {
+    uint64_t points = 0, bytes = 0;
+    for (unsigned int frame = 0; frame < velo_files.size(); ++frame)
+      bytes += FileSize(KittiConfig::getPointCloudPath(options.dataset, frame).string());
+    double seconds = BestOf(repeat, [&] {
+      points = 0;
+      for (unsigned int frame = 0; frame < velo_files.size(); ++frame)
+        points += dataset.getPointCloud(frame)->size();
+    });
+    results.push_back(Result{"KittiDataset::getPointCloud", seconds, points, bytes, "point"});
+  } else {
+    ROS_WARN_STREAM("KittiDataset::getPointCloud skipped, no scan at " << KittiConfig::getPointCloudPath(options.dataset, 0).string());
+  }
+
+  const string label_file = root + "label_02/" + options.sequence + ".txt";
+  if (boost::filesystem::exists(label_file)) {
+    // One label per line
+    std::ifstream file(label_file);
+    uint64_t num_labels = std::count(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>(), '\n');
+    double seconds = BestOf(repeat, [&] {
+      KittiTrackLabel labels(label_file, cv::Size(kImageWidth, kImageHeight));
+    });
+    results.push_back(Result{"KittiTrackLabel", seconds, num_labels, FileSize(label_file), "label"});
+  } else {
+    ROS_WARN_STREAM("KittiTrackLabel skipped, no label file " << label_file);
+  }
+
+  // Geometry kernels on the clouds in memory
+  {
+    vector<KittiTracklet> tracklets = MakeTracklets(clouds.size());
+    uint64_t inside = 0;
+    double seconds = BestOf(repeat, [&] {
+      inside = 0;
+      for (unsigned int frame = 0; frame < clouds.size(); ++frame) {
+        for (const KittiTracklet& tracklet : tracklets)
+          inside += dataset.getTrackletPointCloud(clouds[frame], tracklet, frame)->size();
+      }
+    });
+    // Every box crops the whole cloud
+    results.push_back(Result{"getTrackletPointCloud (" + std::to_string(kNumBoxes) + " boxes)", seconds,
+                             num_cloud_points * kNumBoxes, cloud_bytes * kNumBoxes, "point"});
+
+    // The same boxes labelled in one pass over the cloud by the TrackletLabeller of the dataset
+    dataset.getTracklets() = Tracklets();
+    for (const KittiTracklet& tracklet : tracklets)
+      dataset.getTracklets().addTracklet(tracklet);
+    vector<int> tracklet_ids;
+    uint64_t inside_batched = 0;
+    seconds = BestOf(repeat, [&] {
+      inside_batched = 0;
+      for (unsigned int frame = 0; frame < clouds.size(); ++frame) {
+        for (const KittiPointCloud::Ptr& cloud : dataset.getTrackletPointClouds(clouds[frame], frame, tracklet_ids))
+          inside_batched += cloud->size();
+      }
+    });
+    results.push_back(Result{"getTrackletPointClouds (" + std::to_string(kNumBoxes) + " boxes)", seconds,
+                             num_cloud_points, cloud_bytes, "point"});
+    if (inside_batched != inside)
+      ROS_WARN_STREAM("getTrackletPointClouds found " << inside_batched << " points in the boxes, getTrackletPointCloud " << inside);
+  }
+
+  const string calib_file = root + "calib/" + options.sequence + ".txt";
+  if (boost::filesystem::exists(calib_file)) {
+    kitti_utils::Calibration calib(calib_file);
+    vector<Eigen::MatrixXf> velo_points(clouds.size());
+    for (size_t i = 0; i < clouds.size(); ++i)
+      velo_points[i] = clouds[i]->getMatrixXfMap(3, 8, 0);
+    {
+      double seconds = BestOf(repeat, [&] {
+        for (const Eigen::MatrixXf& points : velo_points) {
+          Eigen::MatrixXf image_points = calib.ProjectRect2Image(calib.ProjectVelo2Rect(points));
+          (void)image_points;
+        }
+      });
+      results.push_back(Result{"Calibration ProjectVelo2Rect+Image", seconds, num_cloud_points, cloud_bytes, "point"});
+    }
+    {
+      Eigen::Matrix<float, 3, 4> velo_to_image = calib.GetVelo2ImageMatrix();
+      Eigen::Matrix3Xf image_points;
+      double seconds = BestOf(repeat, [&] {
+        for (const Eigen::MatrixXf& points : velo_points) {
+          image_points.noalias() = velo_to_image.leftCols<3>() * points;
+          image_points.colwise() += velo_to_image.col(3);
+        }
+      });
+      results.push_back(Result{"Calibration GetVelo2ImageMatrix product", seconds, num_cloud_points, cloud_bytes, "point"});
+    }
+
+    // Same projection as my_kitti_player, on the clouds rotated by TransformKittiCloud
+    cv::Mat image = cv::imread(root + "image_02/" + options.sequence + "/000000.png", CV_LOAD_IMAGE_COLOR);
+    if (image.empty())
+      image = cv::Mat::zeros(kImageHeight, kImageWidth, CV_8UC3);
+    Eigen::Affine3f rotation = Eigen::Translation3f(0.0f, 0.0f, 1.73f) * Eigen::AngleAxisf(M_PI / 2, Eigen::Vector3f::UnitZ());
+    Eigen::MatrixXf project_matrix = calib.GetVelo2ImageMatrix() * rotation.inverse().matrix();
+    vector<KittiPointCloud::Ptr> rotated(clouds.size());
+    for (size_t i = 0; i < clouds.size(); ++i)
+      rotated[i] = kitti_utils::TransformKittiCloud(clouds[i], true, 1.73);
+    double seconds = BestOf(repeat, [&] {
+      for (const KittiPointCloud::Ptr& cloud : rotated)
+        kitti_utils::ProjectCloud2Image(cloud, image, project_matrix);
+    });
+    results.push_back(Result{"ProjectCloud2Image", seconds, num_cloud_points, cloud_bytes, "point"});
+  } else {
+    ROS_WARN_STREAM("Calibration and ProjectCloud2Image skipped, no calibration file " << calib_file);
+  }
+
+  {
+    double seconds = BestOf(repeat, [&] {
+      for (const KittiPointCloud::Ptr& cloud : clouds)
+        kitti_utils::TransformKittiCloud(cloud, true, 1.73);
+    });
+    results.push_back(Result{"TransformKittiCloud", seconds, num_cloud_points, cloud_bytes, "point"});
+  }
+  {
+    // Into a reused cloud, as my_kitti_player does with the scan it already loaded
+    KittiPointCloud rotated;
+    double seconds = BestOf(repeat, [&] {
+      for (const KittiPointCloud::Ptr& cloud : clouds)
+        kitti_utils::TransformKittiCloud(*cloud, rotated, true, 1.73);
+    });
+    results.push_back(Result{"TransformKittiCloud into a reused cloud", seconds, num_cloud_points, cloud_bytes, "point"});
+  }
+  {
+    // Reading and rotating in one pass, compare with ReadVeloPoints pcl + TransformKittiCloud
+    KittiPointCloud cloud;
+    double seconds = BestOf(repeat, [&] {
+      for (const string& file : velo_files)
+        kitti_utils::TransformKittiCloud(file, cloud, true, 1.73);
+    });
+    results.push_back(Result{"TransformKittiCloud from file", seconds, num_points, velo_bytes, "point"});
+  }
+  {
+    kitti_utils::RangeImageBuilder builder;
+    double seconds = BestOf(repeat, [&] {
+      for (const KittiPointCloud::Ptr& cloud : clouds)
+        builder.Build(*cloud);
+    });
+    results.push_back(Result{"RangeImageBuilder", seconds, num_cloud_points, cloud_bytes, "point"});
+  }
+
+  // UTM conversion of the oxts positions, the scalar form is the latlon2xy_helper of the players
+  {
+    Eigen::ArrayXd lat, lon;
+    kitti_utils::OxtsTable oxts;
+    const string oxts_file = root + "oxts/" + options.sequence + ".txt";
+    if (boost::filesystem::exists(oxts_file) && oxts.LoadFile(oxts_file) && !oxts.empty()) {
+      lat = Eigen::Map<const Eigen::ArrayXd>(oxts.Column(kitti_utils::OxtsTable::kLat).data(), oxts.size());
+      lon = Eigen::Map<const Eigen::ArrayXd>(oxts.Column(kitti_utils::OxtsTable::kLon).data(), oxts.size());
+    } else {
+      // Around Karlsruhe, where the KITTI sequences were recorded
+      lat = 49.0 + Eigen::ArrayXd::LinSpaced(kNumCoordinates, 0.0, 0.05);
+      lon = 8.4 + Eigen::ArrayXd::LinSpaced(kNumCoordinates, 0.0, 0.05);
+    }
+    // Repeat short sequences so that the timer resolution does not matter
+    const int rounds = std::max<int>(1, kNumCoordinates / lat.size());
+    const uint64_t count = static_cast<uint64_t>(rounds) * lat.size();
+    double sum = 0.0;
+    double seconds = BestOf(repeat, [&] {
+      for (int round = 0; round < rounds; ++round) {
+        for (int i = 0; i < lat.size(); ++i)
+          sum += kitti_utils::LatLon2Xy(lat[i], lon[i]).x;
+      }
+    });
+    results.push_back(Result{"LatLon2Xy", seconds, count, count * 2 * sizeof(double), "coord"});
+
+    Eigen::ArrayXd x(lat.size()), y(lat.size());
+    seconds = BestOf(repeat, [&] {
+      for (int round = 0; round < rounds; ++round) {
+        kitti_utils::LatLon2Xy(lat, lon, x, y);
+        sum += x[0];
+      }
+    });
+    results.push_back(Result{"LatLon2Xy array", seconds, count, count * 2 * sizeof(double), "coord"});
+    // Keep the scalar loop from being optimized away
+    if (std::isnan(sum))
+      std::printf("nan\n");
+  }
+
+  PrintHeader();
+  for (const Result& result : results)
+    Print(result);
+  return 0;
+}
@@ -0,0 +1,403 @@
+/*
+ * @Description: Convert KITTI tracking sequences to shard files of frame records, without ROS playback
+ * @References: frame_record.h for the record layout
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/program_options.hpp>
+#include <ros/console.h>
+
+#include "KittiDataset.h"
+#include "frame_record.h"
+#include "kitti_track_label.h"
+#include "kitti_utils.h"
+#include "shard_writer.h"
+
+namespace po = boost::program_options;
+using std::string;
+using std::vector;
+
+namespace {
+
+struct ExporterOptions {
+  string path;               // tracking dataset split, e.g. .../tracking/training
+  string output;             // output directory
+  string prefix;             // shard and index file name prefix
+  vector<string> sequences;  // sequences to export, all if empty
+  vector<uint32_t> sequence_ids;  // numbers of the sequences, parsed before the workers start
+  unsigned int threads;      // number of sequences read in parallel
+  unsigned int shardSize;    // shard size limit (MB)
+};
+
+/// One serialized frame on its way to the writer, the data buffer is reused
+struct Record {
+  string key;
+  vector<uint8_t> data;
+};
+
+/**
+ * @brief Bounded queue between the sequence workers and the writer. A fixed pool of records
+ *        circulates: workers take a free record, fill it and queue it, the writer writes it and
+ *        gives it back. Workers block when the writer is behind, so memory stays bounded.
+ */
+class RecordQueue {
+public:
+  RecordQueue(unsigned int capacity, unsigned int num_producers)
+      : records_(capacity), producers_(num_producers), aborted_(false) {
+    for (Record& record : records_)
+      free_.push_back(&record);
+  }
+
+  /// A record to fill, NULL if the writer failed
+  Record* AcquireFree() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    free_cond_.wait(lock, [this] { return aborted_ || !free_.empty(); });
+    if (aborted_)
+      return NULL;
+    Record* record = free_.front();
+    free_.pop_front();
+    return record;
+  }
+
+  void PushFull(Record* record) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    full_.push_back(record);
+    full_cond_.notify_one();
+  }
+
+  /// Next record to write, NULL once all the producers are done and the queue is empty
+  Record* PopFull() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    full_cond_.wait(lock, [this] { return producers_ == 0 || !full_.empty(); });
+    if (full_.empty())
+      return NULL;
+    Record* record = full_.front();
+    full_.pop_front();
+    return record;
+  }
+
+  void ReleaseFree(Record* record) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_.push_back(record);
+    free_cond_.notify_one();
+  }
+
+  void ProducerDone() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    --producers_;
+    full_cond_.notify_all();
+  }
+
+  void Abort() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    aborted_ = true;
+    free_cond_.notify_all();
+  }
+
+private:
+  vector<Record> records_;
+  std::deque<Record*> free_;
+  std::deque<Record*> full_;
+  unsigned int producers_;
+  bool aborted_;
+  std::mutex mutex_;
+  std::condition_variable free_cond_;
+  std::condition_variable full_cond_;
+};
+
+struct ExportStats {
+  std::atomic<uint64_t> frames;
+  std::atomic<uint64_t> missing_images;
+  std::atomic<unsigned int> failed_sequences;
+};
+
+/**
+ * @brief Append the content of a file to data
+ * @param size number of bytes appended
+ */
+bool AppendFile(const string& filename, vector<uint8_t>& data, uint32_t* size) {
+  *size = 0;
+  FILE* file = fopen(filename.c_str(), "rb");
+  if (!file)
+    return false;
+  fseek(file, 0, SEEK_END);
+  long file_size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  bool ok = file_size >= 0;
+  if (ok) {
+    size_t offset = data.size();
+    data.resize(offset + file_size);
+    ok = fread(data.data() + offset, 1, file_size, file) == static_cast<size_t>(file_size);
+    *size = file_size;
+  }
+  fclose(file);
+  return ok;
+}
+
+/// Image size from the IHDR chunk of a PNG file, without decoding it
+bool ReadPngSize(const string& filename, cv::Size* size) {
+  unsigned char header[24];
+  FILE* file = fopen(filename.c_str(), "rb");
+  if (!file)
+    return false;
+  bool ok = fread(header, 1, sizeof(header), file) == sizeof(header) && memcmp(header + 12, "IHDR", 4) == 0;
+  fclose(file);
+  if (ok) {
+    size->width = (header[16] << 24) | (header[17] << 16) | (header[18] << 8) | header[19];
+    size->height = (header[20] << 24) | (header[21] << 16) | (header[22] << 8) | header[23];
+  }
+  return ok;
+}
+
+/// Row major copy of a calibration matrix, zeros if it is missing
+void CopyMatrix(const Eigen::MatrixXf& matrix, float* values, int rows, int cols) {
+  for (int r = 0; r < rows; ++r)
+    for (int c = 0; c < cols; ++c)
+      values[r * cols + c] = (matrix.rows() == rows && matrix.cols() == cols) ? matrix(r, c) : 0.0f;
+}
+
+/// Sequence number of a sequence folder name, e.g. 0012, false if it is not a plain number
+bool ParseSequence(const string& sequence, uint32_t* id) {
+  if (sequence.empty() || sequence.size() > 9 || !std::all_of(sequence.begin(), sequence.end(), ::isdigit))
+    return false;
+  *id = boost::lexical_cast<uint32_t>(sequence);
+  return true;
+}
+
+/// Record label of a label_02 type, -1 for DontCare regions
+int32_t RecordLabel(const string& type) {
+  if (type == "DontCare")
+    return -1;
+  if (type == "Person_sitting")
+    return KittiDataset::getLabel("Person (sitting)");
+  return KittiDataset::getLabel(type.c_str());
+}
+
+/// Serialize all the frames of a sequence into records for the writer
+bool ExportSequence(const ExporterOptions& options, const string& sequence, uint32_t sequence_id, RecordQueue& queue,
+                    ExportStats& stats) {
+  const string root = options.path + "/";
+  const string dir_velodyne = root + "velodyne/" + sequence + "/";
+  const string dir_image02 = root + "image_02/" + sequence + "/";
+
+  int num_frames = kitti_utils::ListFilesInDirectory(dir_velodyne);
+  if (num_frames <= 0) {
+    ROS_ERROR_STREAM("No velodyne scan in " << dir_velodyne);
+    return false;
+  }
+
+  kitti_utils::FrameRecordHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kitti_utils::kFrameRecordMagic, sizeof(header.magic));
+  header.version = kitti_utils::kFrameRecordVersion;
+  header.sequence = sequence_id;
+  try {
+    kitti_utils::Calibration calib(root + "calib/" + sequence + ".txt");
+    CopyMatrix(calib.P2(), header.P2, 3, 4);
+    CopyMatrix(calib.R_Rect_0(), header.R_rect, 3, 3);
+    CopyMatrix(calib.Velo2Cam(), header.Tr_velo_cam, 3, 4);
+  } catch (const std::exception& e) {
+    ROS_ERROR_STREAM("Sequence " << sequence << ": " << e.what());
+    return false;
+  }
+
+  // The labels clip the 2D boxes to the image, all the objects are kept: the display filter of the player
+  // drops DontCare, Person_sitting and the occluded objects, and merges Van into Car
+  cv::Size image_size(1242, 375);
+  ReadPngSize(dir_image02 + boost::str(boost::format("%06d") % 0) + ".png", &image_size);
+  KittiTrackLabel labels(root + "label_02/" + sequence + ".txt", image_size, false);
+
+  for (int frame = 0; frame < num_frames; ++frame) {
+    Record* record = queue.AcquireFree();
+    if (!record)
+      return false;
+    record->key = boost::str(boost::format("%04d/%06d") % header.sequence % frame);
+    vector<uint8_t>& data = record->data;
+    data.resize(sizeof(header));
+
+    // Points straight from the .bin file
+    uint32_t points_bytes;
+    string filename = dir_velodyne + boost::str(boost::format("%06d") % frame) + ".bin";
+    if (!AppendFile(filename, data, &points_bytes)) {
+      ROS_ERROR_STREAM("Fail to read " << filename);
+      queue.ReleaseFree(record);
+      return false;
+    }
+    header.frame = frame;
+    header.num_points = points_bytes / sizeof(kitti_utils::VeloPoint);
+    data.resize(sizeof(header) + header.num_points * sizeof(kitti_utils::VeloPoint));
+
+    vector<ObjectDetect> objects = labels.getObjectVec(frame);
+    header.num_objects = objects.size();
+    size_t offset = data.size();
+    data.resize(offset + objects.size() * sizeof(kitti_utils::FrameRecordObject));
+    kitti_utils::FrameRecordObject* out = reinterpret_cast<kitti_utils::FrameRecordObject*>(data.data() + offset);
+    for (const ObjectDetect& object : objects) {
+      out->track_id = object.track_id;
+      out->label = RecordLabel(object.type);
+      out->occluded = object.occluded;
+      out->alpha = object.alpha;
+      out->bbox[0] = object.bbox.x;
+      out->bbox[1] = object.bbox.y;
+      out->bbox[2] = object.bbox.x + object.bbox.width;
+      out->bbox[3] = object.bbox.y + object.bbox.height;
+      out->height = object.geometric.height;
+      out->width = object.geometric.width;
+      out->length = object.geometric.length;
+      out->x = object.geometric.x;
+      out->y = object.geometric.y;
+      out->z = object.geometric.z;
+      out->ry = object.geometric.ry;
+      ++out;
+    }
+
+    // Encoded image, decoded by the training input pipeline
+    filename = dir_image02 + boost::str(boost::format("%06d") % frame) + ".png";
+    size_t image_offset = data.size();
+    if (!AppendFile(filename, data, &header.image_bytes)) {
+      data.resize(image_offset);
+      header.image_bytes = 0;
+      ++stats.missing_images;
+    }
+
+    memcpy(data.data(), &header, sizeof(header));
+    queue.PushFull(record);
+    ++stats.frames;
+  }
+  ROS_INFO_STREAM("Sequence " << sequence << ": " << num_frames << " frames");
+  return true;
+}
+
+/// Sequences in the velodyne folder, sorted, folders which are not a sequence number are skipped
+vector<string> ListSequences(const string& path) {
+  vector<string> sequences;
+  boost::filesystem::path dir(path + "/velodyne");
+  if (!boost::filesystem::is_directory(dir))
+    return sequences;
+  for (boost::filesystem::directory_iterator it(dir); it != boost::filesystem::directory_iterator(); ++it) {
+    if (!boost::filesystem::is_directory(it->status()))
+      continue;
+    string name = it->path().filename().string();
+    uint32_t id;
+    if (ParseSequence(name, &id))
+      sequences.push_back(name);
+    else
+      ROS_WARN_STREAM("Skip " << it->path().string() << ", not a sequence");
+  }
+  std::sort(sequences.begin(), sequences.end());
+  return sequences;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ExporterOptions options;
+  string sequences;
+
+  po::options_description desc("kitti_exporter, convert KITTI tracking sequences to shard files of frame records\n\nAllowed options", 200);
+  desc.add_options()
+  ("help,h", "help message")
+  ("directory ,d", po::value<string>(&options.path)->required(), "*required* - path to the kitti tracking split, e.g. .../tracking/training")
+  ("output    ,o", po::value<string>(&options.output)->required(), "*required* - output directory of the shards and of the index")
+  ("sequences ,s", po::value<string>(&sequences)->default_value(""), "comma separated sequences to export, e.g. 0000,0001, all if empty")
+  ("prefix    ,p", po::value<string>(&options.prefix)->default_value("kitti_tracking"), "file name prefix of the shards and of the index")
+  ("threads   ,j", po::value<unsigned int>(&options.threads)->default_value(4), "number of sequences read in parallel")
+  ("shardSize ,S", po::value<unsigned int>(&options.shardSize)->default_value(1024), "shard size limit (MB)");
+
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    if (vm.count("help")) {
+      std::cout << desc << std::endl;
+      return 0;
+    }
+    po::notify(vm);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl << desc << std::endl;
+    return -1;
+  }
+
+  if (sequences.empty()) {
+    options.sequences = ListSequences(options.path);
+  } else {
+    boost::split(options.sequences, sequences, boost::is_any_of(","), boost::token_compress_on);
+  }
+  if (options.sequences.empty()) {
+    ROS_ERROR_STREAM("No sequence to export in " << options.path << "/velodyne");
+    return -1;
+  }
+  // Parsed here, an exception in a worker would terminate the exporter
+  options.sequence_ids.resize(options.sequences.size());
+  for (size_t s = 0; s < options.sequences.size(); ++s) {
+    if (!ParseSequence(options.sequences[s], &options.sequence_ids[s])) {
+      ROS_ERROR_STREAM("Invalid sequence '" << options.sequences[s] << "', expected a number such as 0000");
+      return -1;
+    }
+  }
+  boost::filesystem::create_directories(options.output);
+
+  kitti_utils::ShardWriter writer(options.output, options.prefix, static_cast<uint64_t>(options.shardSize) << 20);
+  if (!writer.Open())
+    return -1;
+
+  const unsigned int num_workers = std::max(1u, std::min<unsigned int>(options.threads, options.sequences.size()));
+  RecordQueue queue(4 * num_workers, num_workers);
+  ExportStats stats;
+  stats.frames = 0;
+  stats.missing_images = 0;
+  stats.failed_sequences = 0;
+  std::atomic<unsigned int> next_sequence(0);
+
+  auto start = std::chrono::steady_clock::now();
+  vector<std::thread> workers;
+  for (unsigned int i = 0; i < num_workers; ++i) {
+    workers.push_back(std::thread([&] {
+      for (unsigned int s = next_sequence++; s < options.sequences.size(); s = next_sequence++) {
+        if (!ExportSequence(options, options.sequences[s], options.sequence_ids[s], queue, stats))
+          ++stats.failed_sequences;
+      }
+      queue.ProducerDone();
+    }));
+  }
+
+  // Records are written by this thread only, in the order they are ready
+  bool ok = true;
+  while (Record* record = queue.PopFull()) {
+    if (ok && !writer.Write(record->key, record->data.data(), record->data.size())) {
+      ok = false;
+      queue.Abort();
+    }
+    queue.ReleaseFree(record);
+  }
+  for (std::thread& worker : workers)
+    worker.join();
+  ok = writer.Close() && ok;
+
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  ROS_INFO_STREAM("Exported " << stats.frames << " frames of " << options.sequences.size() << " sequences in "
+                  << writer.NumShards() << " shards, " << (writer.TotalBytes() >> 20) << " MB in " << elapsed << " s ("
+                  << (elapsed > 0.0 ? (writer.TotalBytes() >> 20) / elapsed : 0.0) << " MB/s)");
+  if (stats.missing_images > 0)
+    ROS_WARN_STREAM(stats.missing_images << " frames without image_02");
+  if (stats.failed_sequences > 0)
+    ROS_ERROR_STREAM(stats.failed_sequences << " sequences failed");
+  return ok && stats.failed_sequences == 0 ? 0 : -1;
+}
@@ -20,7 +20,7 @@
 #include <ros/ros.h>
 using namespace std;
 typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
-KittiTrackLabel::KittiTrackLabel(std::string full_filename_label02, cv::Size img_size):
+KittiTrackLabel::KittiTrackLabel(std::string full_filename_label02, cv::Size img_size, bool filter):
 full_filename_lable02_(full_filename_label02)
 {
   ROS_WARN_STREAM("full file name of label02 is "<<full_filename_label02);
@@ -29,7 +29,7 @@ full_filename_lable02_(full_filename_label02)
   // Read all content
   readFileContent();
 
-  getObjectMap(img_size);
+  getObjectMap(img_size, filter);
 }
 
 KittiTrackLabel::~KittiTrackLabel() {
@@ -62,7 +62,7 @@ void KittiTrackLabel::readFileContent()
   file_all_lines_ = lines;
 }
 
-void KittiTrackLabel::getObjectMap(const cv::Size& img_size)
+void KittiTrackLabel::getObjectMap(const cv::Size& img_size, bool filter)
 {
   std::vector<ObjectDetect> objVec;
   int num = -1;
@@ -89,17 +89,21 @@ void KittiTrackLabel::getObjectMap(const cv::Size& img_size)
     }
 
     ObjectDetect obj;
+    // Read track id, unique in the sequence
+    obj.track_id = boost::lexical_cast<int>(cols[1]);
     // Read type
     obj.type = cols[2];
     // Read occluded
     obj.occluded = boost::lexical_cast<int>(cols[4]);
 
     // Delete DontCare type and largely or unknown occluded objects
-    if(obj.type == "DontCare" || obj.type == "Person_sitting" ||
-        obj.occluded == 2 || obj.occluded == 3)
-      continue;
-    if(obj.type == "Van")
-      obj.type = "Car";
+    if(filter) {
+      if(obj.type == "DontCare" || obj.type == "Person_sitting" ||
+          obj.occluded == 2 || obj.occluded == 3)
+        continue;
+      if(obj.type == "Van")
+        obj.type = "Car";
+    }
 
     // Read alpha
     obj.alpha = boost::lexical_cast<float>(cols[5]);
@@ -27,6 +27,7 @@ struct Geometry
 };
 struct ObjectDetect
 {
+  int track_id;
   std::string type;
   int occluded;
   cv::Rect bbox;
@@ -36,13 +37,17 @@ struct ObjectDetect
 
 class KittiTrackLabel {
 public:
-  KittiTrackLabel(std::string full_filename_label02, cv::Size img_size);
+  /**
+   * @param filter drop DontCare, Person_sitting and the largely occluded objects, and merge Van into Car,
+   *        as displayed by the player
+   */
+  KittiTrackLabel(std::string full_filename_label02, cv::Size img_size, bool filter = true);
   virtual ~KittiTrackLabel();
 
   std::vector<ObjectDetect> getObjectVec(int frame_num);
 private:
   void readFileContent();
-  void getObjectMap(const cv::Size& img_size);
+  void getObjectMap(const cv::Size& img_size, bool filter);
 
   std::string full_filename_lable02_;
   std::vector<std::string> file_all_lines_;
@@ -3,18 +3,18 @@
  * @Email: zhanghm_1995@qq.com
  * @Date: 2020-04-09 21:15:44
  * @LastEditTime: 2020-04-11 16:15:02
- * @Description:
+ * @Description: KITTI tracking dataset player, used by the standalone node and by the nodelet
  * @References: 
  */
 
 #include <cv_bridge/cv_bridge.h>
+#include <darknet_ros_msgs/BoundingBoxes.h>
 #include <darknet_ros_msgs/ImageWithBBoxes.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
 #include <image_transport/image_transport.h>
 #include <pcl/common/transforms.h>
 #include <pcl/point_cloud.h>
 #include <pcl/point_types.h>
-#include <pcl_conversions/pcl_conversions.h>
-#include <pcl_ros/point_cloud.h>
 #include <ros/console.h>
 #include <ros/ros.h>
 #include <sensor_msgs/Imu.h>
@@ -27,6 +27,7 @@
 #include <tf/LinearMath/Transform.h>
 #include <tf/transform_broadcaster.h>
 #include <tf/transform_listener.h>
+#include <tf2_msgs/TFMessage.h>
 #include <time.h>
 #include <visualization_msgs/Marker.h>
 #include <visualization_msgs/MarkerArray.h>
@@ -38,7 +39,6 @@
 #include <boost/locale.hpp>
 #include <boost/program_options.hpp>
 #include <boost/progress.hpp>
-#include <boost/tokenizer.hpp>
 #include <cmath>
 #include <fstream>
 #include <iostream>
@@ -48,6 +48,8 @@
 #include <sstream>
 #include <string>
 
+#include "kitti_tracking_player.h"
+
 #include "KittiDataset.h"
 #include "fusion_type.h"
 #include "iv_dynamicobject_msgs/ObjectArray.h"
@@ -62,159 +64,29 @@ using namespace tf;
 
 namespace po = boost::program_options;
 
-kitti_utils::Calibration calib_params;
-
-template <class PointT>
-bool projectPoint2Image(const PointT& pointIn, const Eigen::MatrixXf& projectmatrix, cv::Point2f& point_project) {
-  //check project matrix size
-  if (!(projectmatrix.rows() == 3 && projectmatrix.cols() == 4)) {
-    std::cout << "[WARN] project matrix size need be 3x4!" << std::endl;
-    return false;
-  }
-
-  //apply the projection operation
-  Eigen::Vector4f point_3d(pointIn.x, pointIn.y, pointIn.z, 1.0);  //define homogenious coordniate
-  Eigen::Vector3f point_temp = projectmatrix * point_3d;
-  //get image coordinates
-  float x = static_cast<float>(point_temp[0] / point_temp[2]);
-  float y = static_cast<float>(point_temp[1] / point_temp[2]);
-  point_project = cv::Point2f(x, y);
-  return true;
-}
-
-cv::Mat ProjectCloud2Image(const pcl::PointCloud<pcl::PointXYZI>::ConstPtr cloudIn, const cv::Mat& imageIn, const Eigen::MatrixXf& projectmatrix) {
-  cv::Mat hsv_image, res_image;
-  cv::cvtColor(imageIn, hsv_image, CV_BGR2HSV);
-
-  int scale = 120, min_dis = 1, max_dis = 70;
-  auto toColor = [&](const pcl::PointXYZI& point) -> int {
-    //1)calculate point distance
-    float distance = std::sqrt(point.x * point.x + point.y * point.y + point.z * point.z);
-    //2)calculate color value, normalize values to (0 - scale) & close distance value has low value.
-    int res = ((distance - min_dis) / (max_dis - min_dis)) * scale;
-    return res;
-  };
-
-  // plot color points using distance encode HSV color
-  for (int i = 0; i < cloudIn->size(); ++i) {
-    if (cloudIn->points[i].x < 0)
-      continue;
-    int color = toColor(cloudIn->points[i]);
-    cv::Point2f image_point;
-    projectPoint2Image(cloudIn->points[i], projectmatrix, image_point);
-    cv::circle(hsv_image, image_point, 2, cv::Scalar(color, 255, 255), -1);
-  }
-
-  cv::cvtColor(hsv_image, res_image, CV_HSV2BGR);
-  return res_image;
-}
-
-pcl::PointCloud<pcl::PointXYZI>::Ptr TransformKittiCloud(pcl::PointCloud<pcl::PointXYZI>::Ptr kitti_cloud, bool do_z_shift = false, float z_shift_value = 1.73) {
-  //do transformation
-  Eigen::Affine3f transform_matrix = Eigen::Affine3f::Identity();
-  // Define translation
-  if (do_z_shift)
-    transform_matrix.translation() << 0.0, 0.0, 1.73;
-  else
-    transform_matrix.translation() << 0.0, 0.0, 0.0;
-  // The same rotation matrix as before; theta radians around Z axis
-  transform_matrix.rotate(Eigen::AngleAxisf(M_PI / 2, Eigen::Vector3f::UnitZ()));
-
-  // Executing the transformation
-  pcl::PointCloud<pcl::PointXYZI>::Ptr transformed_cloud(new pcl::PointCloud<pcl::PointXYZI>());
-
-  // You can either apply transform_1 or transform_2; they are the same
-  pcl::transformPointCloud(*kitti_cloud, *transformed_cloud, transform_matrix);
-  return transformed_cloud;
-}
-
-struct kitti_player_options {
-  string path;
-  float frequency;           // publisher frequency. 1 > Kitti default 10Hz
-  bool all_data;             // publish everything
-  bool velodyne;             // publish velodyne point clouds /as PCL
-  bool gps;                  // publish GPS sensor_msgs/NavSatFix    message
-  bool imu;                  // publish IMU sensor_msgs/Imu Message  message
-  bool grayscale;            // publish
-  bool color;                // publish
-  bool viewer;               // enable CV viewer
-  bool timestamps;           // use KITTI timestamps;
-  bool sendTransform;        // publish velodyne TF IMU 3DOF orientation wrt fixed frame
-  bool stereoDisp;           // use precalculated stereoDisparities
-  bool viewDisparities;      // view use precalculated stereoDisparities
-  bool synchMode;            // start with synchMode on (wait for message to send next frame)
-  unsigned int startFrame;   // start the replay at frame ...
-  string gpsReferenceFrame;  // publish GPS points into RVIZ as RVIZ Markers
-};
-
-bool waitSynch = false;  /// Synch mode variable, refs #600
-
-/**
- * @brief synchCallback
- * @param msg (boolean)
- *
- * if a TRUE message is received, TRUE is interpreted as "publish a new frame".
- * Then waitSynh variable is set to FALSE, and an iteration of the KittiPlayer
- * main loop is executed.
- */
-void synchCallback(const std_msgs::Bool::ConstPtr& msg) {
-  ROS_INFO_STREAM("Synch received");
-  if (msg->data)
-    waitSynch = false;
-}
-
 /**
- * @brief Publish velodyne point cloud
+ * @brief Publish velodyne point cloud, the file is read directly into the PointCloud2 data buffer
  * @param pub The ROS publisher as reference
  * @param infile file with data to publish
  * @param header Header to use to publish the message
- * @return 1 if file is correctly readed, 0 otherwise
+ * @param cloud_buffer Message reused between frames, reallocated only if a subscriber still holds it
+ * @return the published cloud, nullptr if file could not be read
  */
-pcl::PointCloud<pcl::PointXYZI>::Ptr publish_velodyne(ros::Publisher& pub, string infile, std_msgs::Header* header) {
-  KittiPointCloudPtr points(new KittiPointCloud);
-  if (!kitti_utils::ReadVeloPoints(infile, *points)) {
+sensor_msgs::PointCloud2ConstPtr publish_velodyne(ros::Publisher& pub, string infile, std_msgs::Header* header,
+                                                  sensor_msgs::PointCloud2Ptr& cloud_buffer) {
+  // Intra-process subscribers receive the pointer itself, never modify a message they may still use
+  if (!cloud_buffer || !cloud_buffer.unique())
+    cloud_buffer = boost::make_shared<sensor_msgs::PointCloud2>();
+
+  if (!kitti_utils::ReadVeloPoints(infile, *cloud_buffer)) {
     ROS_ERROR_STREAM("Could not read file: " << infile);
     return nullptr;
   } else {
-  //workaround for the PCL headers... http://wiki.ros.org/hydro/Migration#PCL
-    sensor_msgs::PointCloud2 pc2;
-
-    pc2.header.frame_id = "velo_link";  //ros::this_node::getName();
-    pc2.header.stamp = header->stamp;
-    points->header = pcl_conversions::toPCL(pc2.header);
-    pub.publish(points);
-    return points;
-  }
-}
-
-void drawBBoxes(cv::Mat& img, const std::vector<ObjectDetect>& outRcs) {
-  // draw detection results
-  for (const auto& rect : outRcs) {
-    if (rect.type == "Car")
-      cv::rectangle(img, rect.bbox, cv::Scalar(142, 0, 0), 2);
-    else if (rect.type == "Pedestrian")
-      cv::rectangle(img, rect.bbox, cv::Scalar(60, 20, 220), 2);
-    else if (rect.type == "Cyclist")
-      cv::rectangle(img, rect.bbox, cv::Scalar(32, 11, 119), 2);
-    else
-      cv::rectangle(img, rect.bbox, cv::Scalar(255, 255, 255), 2);
-    // Draw occluded text
-    cv::putText(img, to_string(rect.occluded), rect.bbox.tl(), cv::FONT_HERSHEY_PLAIN, 0.8, cv::Scalar(0, 255, 255));
-    cv::putText(img, rect.type, cv::Point(rect.bbox.tl().x + 8, rect.bbox.tl().y - 2), cv::FONT_HERSHEY_PLAIN, 0.8, cv::Scalar(0, 255, 255));
+    cloud_buffer->header.frame_id = "velo_link";  //ros::this_node::getName();
+    cloud_buffer->header.stamp = header->stamp;
+    pub.publish(sensor_msgs::PointCloud2ConstPtr(cloud_buffer));
+    return cloud_buffer;
   }
-  cv::imshow("bboxes", img);
-  cv::waitKey(5);
-}
-
-void showProjection(pcl::PointCloud<pcl::PointXYZI>::Ptr cloud, const cv::Mat& image) {
-  Eigen::MatrixXf transform_matrix = calib_params.GetVelo2ImageMatrix();
-  cout<<"transform_matrix = "<<transform_matrix<<endl;
-
-  //        points_pub = TransformKittiCloud(points_pub, true, 1.73);
-  cv::Mat img_fusion_result = ProjectCloud2Image(cloud, image, transform_matrix);
-  cv::namedWindow("img_fusion_result", CV_WINDOW_NORMAL);
-  cv::imshow("img_fusion_result", img_fusion_result);
-  cv::waitKey(5);
 }
 
 bool publishImageWithBBoxes(ros::Publisher& pub,
@@ -246,45 +118,39 @@ bool publishImageWithBBoxes(ros::Publisher& pub,
   boundingBoxesResults_.header.stamp = header->stamp;
   boundingBoxesResults_.header.frame_id = "detection";
 
-  darknet_ros_msgs::ImageWithBBoxes image_with_bboxes;
+  darknet_ros_msgs::ImageWithBBoxesPtr image_with_bboxes = boost::make_shared<darknet_ros_msgs::ImageWithBBoxes>();
   cv_bridge::CvImage cvImage;
   cvImage.header.stamp = header->stamp;
   cvImage.header.frame_id = "detection_image";
   cvImage.encoding = sensor_msgs::image_encodings::BGR8;
   cvImage.image = raw_image;
   //to darknet_ros_msgs::ImageWithBBoxes message type
-  image_with_bboxes.header = *header;
-  image_with_bboxes.image = *cvImage.toImageMsg();
-  image_with_bboxes.bboxes = boundingBoxesResults_;
+  image_with_bboxes->header = *header;
+  cvImage.toImageMsg(image_with_bboxes->image);
+  image_with_bboxes->bboxes = boundingBoxesResults_;
   pub.publish(image_with_bboxes);
   ROS_DEBUG("Raw image with bounding boxes infomation have been published.");
   return true;
 }
 
-int getGPS(const std::vector<string>& lines, int entries, sensor_msgs::NavSatFix* ros_msgGpsFix, std_msgs::Header* header) {
-  // Get line
-  std::string line = lines.at(entries);
-
-  typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
-  boost::char_separator<char> sep{" "};
-
-  tokenizer tok(line, sep);
-  vector<string> s(tok.begin(), tok.end());
-
+int getGPS(const kitti_utils::OxtsTable& oxts, unsigned int frame, sensor_msgs::NavSatFix* ros_msgGpsFix, std_msgs::Header* header) {
+  if (frame >= oxts.size()) {
+    return 0;
+  }
   ros_msgGpsFix->header.frame_id = ros::this_node::getName();
   ros_msgGpsFix->header.stamp = header->stamp;
 
-  ros_msgGpsFix->latitude = boost::lexical_cast<double>(s[0]);
-  ros_msgGpsFix->longitude = boost::lexical_cast<double>(s[1]);
-  ros_msgGpsFix->altitude = boost::lexical_cast<double>(s[2]);
+  ros_msgGpsFix->latitude = oxts.Get(frame, kitti_utils::OxtsTable::kLat);
+  ros_msgGpsFix->longitude = oxts.Get(frame, kitti_utils::OxtsTable::kLon);
+  ros_msgGpsFix->altitude = oxts.Get(frame, kitti_utils::OxtsTable::kAlt);
 
   ros_msgGpsFix->position_covariance_type = sensor_msgs::NavSatFix::COVARIANCE_TYPE_APPROXIMATED;
   for (int i = 0; i < 9; i++)
     ros_msgGpsFix->position_covariance[i] = 0.0f;
 
-  ros_msgGpsFix->position_covariance[0] = boost::lexical_cast<double>(s[23]);
-  ros_msgGpsFix->position_covariance[4] = boost::lexical_cast<double>(s[23]);
-  ros_msgGpsFix->position_covariance[8] = boost::lexical_cast<double>(s[23]);
+  ros_msgGpsFix->position_covariance[0] = oxts.Get(frame, kitti_utils::OxtsTable::kPosAccuracy);
+  ros_msgGpsFix->position_covariance[4] = oxts.Get(frame, kitti_utils::OxtsTable::kPosAccuracy);
+  ros_msgGpsFix->position_covariance[8] = oxts.Get(frame, kitti_utils::OxtsTable::kPosAccuracy);
 
   ros_msgGpsFix->status.service = sensor_msgs::NavSatStatus::SERVICE_GPS;
   ros_msgGpsFix->status.status = sensor_msgs::NavSatStatus::STATUS_GBAS_FIX;
@@ -292,38 +158,31 @@ int getGPS(const std::vector<string>& lines, int entries, sensor_msgs::NavSatFix
   return 1;
 }
 
-int getIMU(const std::vector<string>& lines, int entries, sensor_msgs::Imu* ros_msgImu, std_msgs::Header* header) {
-  std::string line = lines.at(entries);
-
-  typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
-  boost::char_separator<char> sep{" "};
-
-  tokenizer tok(line, sep);
-  vector<string> s(tok.begin(), tok.end());
-
+int getIMU(const kitti_utils::OxtsTable& oxts, unsigned int frame, sensor_msgs::Imu* ros_msgImu, std_msgs::Header* header) {
+  if (frame >= oxts.size()) {
+    return 0;
+  }
   ros_msgImu->header.frame_id = ros::this_node::getName();
   ros_msgImu->header.stamp = header->stamp;
 
   //    - ax:      acceleration in x, i.e. in direction of vehicle front (m/s^2)
   //    - ay:      acceleration in y, i.e. in direction of vehicle left (m/s^2)
   //    - az:      acceleration in z, i.e. in direction of vehicle top (m/s^2)
-  ros_msgImu->linear_acceleration.x = boost::lexical_cast<double>(s[11]);
-  ros_msgImu->linear_acceleration.y = boost::lexical_cast<double>(s[12]);
-  ros_msgImu->linear_acceleration.z = boost::lexical_cast<double>(s[13]);
+  ros_msgImu->linear_acceleration.x = oxts.Get(frame, kitti_utils::OxtsTable::kAx);
+  ros_msgImu->linear_acceleration.y = oxts.Get(frame, kitti_utils::OxtsTable::kAy);
+  ros_msgImu->linear_acceleration.z = oxts.Get(frame, kitti_utils::OxtsTable::kAz);
 
   //    - vf:      forward velocity, i.e. parallel to earth-surface (m/s)
   //    - vl:      leftward velocity, i.e. parallel to earth-surface (m/s)
   //    - vu:      upward velocity, i.e. perpendicular to earth-surface (m/s)
-  ros_msgImu->angular_velocity.x = boost::lexical_cast<double>(s[8]);
-  ros_msgImu->angular_velocity.y = boost::lexical_cast<double>(s[9]);
-  ros_msgImu->angular_velocity.z = boost::lexical_cast<double>(s[10]);
+  ros_msgImu->angular_velocity.x = oxts.Get(frame, kitti_utils::OxtsTable::kVf);
+  ros_msgImu->angular_velocity.y = oxts.Get(frame, kitti_utils::OxtsTable::kVl);
+  ros_msgImu->angular_velocity.z = oxts.Get(frame, kitti_utils::OxtsTable::kVu);
 
   //    - roll:    roll angle (rad),  0 = level, positive = left side up (-pi..pi)
   //    - pitch:   pitch angle (rad), 0 = level, positive = front down (-pi/2..pi/2)
   //    - yaw:     heading (rad),     0 = east,  positive = counter clockwise (-pi..pi)
-  tf::Quaternion q = tf::createQuaternionFromRPY(boost::lexical_cast<double>(s[3]),
-                                                 boost::lexical_cast<double>(s[4]),
-                                                 boost::lexical_cast<double>(s[5]));
+  tf::Quaternion q = oxts.Orientation(frame);
   ros_msgImu->orientation.x = q.getX();
   ros_msgImu->orientation.y = q.getY();
   ros_msgImu->orientation.z = q.getZ();
@@ -332,78 +191,7 @@ int getIMU(const std::vector<string>& lines, int entries, sensor_msgs::Imu* ros_
   return 1;
 }
 
-/// Cartesian coordinates struct, refs# 522
-struct Xy {
-  double x;
-  double y;
-};
-
-/** Conversion between geographic and UTM coordinates
-    Adapted from:  http://www.uwgb.edu/dutchs/UsefulData/ConvertUTMNoOZ.HTM
-    Refs# 522
-**/
-Xy latlon2xy_helper(double lat, double lngd) {
-  // WGS 84 datum
-  double eqRad = 6378137.0;
-  double flat = 298.2572236;
-
-  // constants used in calculations:
-  double a = eqRad;                                // equatorial radius in meters
-  double f = 1.0 / flat;                           // polar flattening
-  double b = a * (1.0 - f);                        // polar radius
-  double e = sqrt(1.0 - (pow(b, 2) / pow(a, 2)));  // eccentricity
-  double k0 = 0.9996;
-  double drad = M_PI / 180.0;
-
-  double phi = lat * drad;                          // convert latitude to radians
-  double utmz = 1.0 + floor((lngd + 180.0) / 6.0);  // longitude to utm zone
-  double zcm = 3.0 + 6.0 * (utmz - 1.0) - 180.0;    // central meridian of a zone
-  double esq = (1.0 - (b / a) * (b / a));
-  double e0sq = e * e / (1.0 - e * e);
-  double M = 0.0;
-  double M0 = 0.0;
-  double N = a / sqrt(1.0 - pow(e * sin(phi), 2));
-  double T = pow(tan(phi), 2);
-  double C = e0sq * pow(cos(phi), 2);
-  double A = (lngd - zcm) * drad * cos(phi);
-
-  // calculate M (USGS style)
-  M = phi * (1.0 - esq * (1.0 / 4.0 + esq * (3.0 / 64.0 + 5.0 * esq / 256.0)));
-  M = M - sin(2.0 * phi) * (esq * (3.0 / 8.0 + esq * (3.0 / 32.0 + 45.0 * esq / 1024.0)));
-  M = M + sin(4.0 * phi) * (esq * esq * (15.0 / 256.0 + esq * 45.0 / 1024.0));
-  M = M - sin(6.0 * phi) * (esq * esq * esq * (35.0 / 3072.0));
-  M = M * a;  // Arc length along standard meridian
-
-  // now we are ready to calculate the UTM values...
-  // first the easting (relative to CM)
-  double x = k0 * N * A * (1.0 + A * A * ((1.0 - T + C) / 6.0 + A * A * (5.0 - 18.0 * T + T * T + 72.0 * C - 58.0 * e0sq) / 120.0));
-  x = x + 500000.0;  // standard easting
-
-  // now the northing (from the equator)
-  double y = k0 * (M - M0 + N * tan(phi) * (A * A * (1.0 / 2.0 + A * A * ((5.0 - T + 9.0 * C + 4.0 * C * C) / 24.0 + A * A * (61.0 - 58.0 * T + T * T + 600.0 * C - 330.0 * e0sq) / 720.0))));
-  if (y < 0) {
-    y = 10000000.0 + y;  // add in false northing if south of the equator
-  }
-  double easting = x;
-  double northing = y;
-
-  Xy coords;
-  coords.x = easting;
-  coords.y = northing;
-
-  return coords;
-}
-
-bool publishPoseTF(const sensor_msgs::NavSatFix& ros_msgGPSFix,
-                   const sensor_msgs::Imu& ros_msgImu,
-                   std_msgs::Header* header) {
-  static tf::TransformBroadcaster tf_broadcaster;
-
-  static double* origin = nullptr;
-
-  // Get translation
-  Xy tr = latlon2xy_helper(ros_msgGPSFix.latitude, ros_msgGPSFix.longitude);
-
+bool publishPoseTF(ros::Publisher& pub, const Eigen::Isometry3d& pose, std_msgs::Header* header) {
   // Create pose transform
   geometry_msgs::TransformStamped pose_transform;
   pose_transform.header.stamp = header->stamp;
@@ -411,23 +199,21 @@ bool publishPoseTF(const sensor_msgs::NavSatFix& ros_msgGPSFix,
   pose_transform.header.frame_id = "world";
   pose_transform.child_frame_id = "velo_link";
 
-  if (origin == nullptr) {
-    origin = new double[3];
-    origin[0] = tr.x;
-    origin[1] = tr.y;
-    origin[2] = ros_msgGPSFix.altitude;
-  }
-
-  pose_transform.transform.translation.x = tr.x - origin[0];
-  pose_transform.transform.translation.y = tr.y - origin[1];
-  pose_transform.transform.translation.z = ros_msgGPSFix.altitude - origin[2];
+  pose_transform.transform.translation.x = pose.translation().x();
+  pose_transform.transform.translation.y = pose.translation().y();
+  pose_transform.transform.translation.z = pose.translation().z();
 
-  pose_transform.transform.rotation.x = ros_msgImu.orientation.x;
-  pose_transform.transform.rotation.y = ros_msgImu.orientation.y;
-  pose_transform.transform.rotation.z = ros_msgImu.orientation.z;
-  pose_transform.transform.rotation.w = ros_msgImu.orientation.w;
+  Eigen::Quaterniond q(pose.linear());
+  pose_transform.transform.rotation.x = q.x();
+  pose_transform.transform.rotation.y = q.y();
+  pose_transform.transform.rotation.z = q.z();
+  pose_transform.transform.rotation.w = q.w();
 
-  tf_broadcaster.sendTransform(pose_transform);
+  // Same message as tf::TransformBroadcaster sends, on a publisher owned by the player
+  tf2_msgs::TFMessagePtr message = boost::make_shared<tf2_msgs::TFMessage>();
+  message->transforms.push_back(pose_transform);
+  pub.publish(message);
+  return true;
 }
 
 /**
@@ -460,578 +246,826 @@ std_msgs::Header parseTime(string timestamp) {
   return header;
 }
 
-void loadAvailableTracklets(KittiDataset* dataset, int frame_index, std::vector<KittiTracklet>& availableTracklets) {
-  Tracklets& tracklets = dataset->getTracklets();
-  int tracklet_id;
-  int number_of_tracklets = tracklets.numberOfTracklets();
-  for (tracklet_id = 0; tracklet_id < number_of_tracklets; tracklet_id++) {
-    KittiTracklet* tracklet = tracklets.getTracklet(tracklet_id);
-    if (tracklet->first_frame <= frame_index && tracklet->lastFrame() >= frame_index) {
-      availableTracklets.push_back(*tracklet);
-    }
-  }
-}
-
 using namespace visualization_msgs;
 using namespace sensors_fusion;
 
-// Display 3D bouding boxes using RVIZ Marker
-void showBoundingBox(ros::Publisher& pub, const int frame_index,
-                     const std::vector<KittiTracklet>& availableTracklets,
-                     iv_dynamicobject_msgs::ObjectArray& object_array) {
-  double boxHeight = 0.0d;
-  double boxWidth = 0.0d;
-  double boxLength = 0.0d;
-  int pose_number = 0;
+/**
+ * @brief Display the 3D bounding boxes of the objects of a frame in one MarkerArray:
+ *        a DELETEALL clearing the boxes of the previous frame, then per object a box, a heading
+ *        arrow and its type and id as text. Marker ids are the tracklet ids.
+ *        The markers are built in the reused markers buffer and published once.
+ */
+void showBoundingBox(ros::Publisher& pub, const std::vector<kitti_utils::ObjectState>& states, MarkerArrayPtr& markers) {
+  if (!markers || !markers.unique())
+    markers = boost::make_shared<MarkerArray>();
+  std::vector<Marker>& list = markers->markers;
+  size_t num_markers = 1;
+  list.resize(std::max<size_t>(list.size(), 1));
+  list[0] = Marker();
+  list[0].header.frame_id = "velo_link";
+  list[0].action = Marker::DELETEALL;
 
   // Loop very available tracklets
-  for (int i = 0; i < availableTracklets.size(); ++i) {
-    iv_dynamicobject_msgs::Object obj;
-
+  for (const kitti_utils::ObjectState& state : states) {
     // Create the bounding box
-    const KittiTracklet& tracklet = availableTracklets.at(i);
-
-    boxHeight = tracklet.h;
-    boxWidth = tracklet.w;
-    boxLength = tracklet.l;
-    pose_number = frame_index - tracklet.first_frame;
-    const Tracklets::tPose& tpose = tracklet.poses.at(pose_number);
-    Eigen::Vector3f boxTranslation;
-    boxTranslation[0] = (float)tpose.tx;
-    boxTranslation[1] = (float)tpose.ty;
-    boxTranslation[2] = (float)tpose.tz + (float)boxHeight / 2.0f;
-    Eigen::Quaternionf boxRotation = Eigen::Quaternionf(Eigen::AngleAxisf((float)tpose.rz, Eigen::Vector3f::UnitZ()));
-
-    visualization_msgs::Marker viz_obj;
+    const double boxHeight = state.height;
+    const double boxWidth = state.width;
+    const double boxLength = state.length;
+    Eigen::Vector3f boxTranslation = state.velo_position;
+    boxTranslation[2] += (float)boxHeight / 2.0f;
+    Eigen::Quaternionf boxRotation = Eigen::Quaternionf(Eigen::AngleAxisf(state.velo_yaw, Eigen::Vector3f::UnitZ()));
+    int r = 0, g = 255, b = 0;
+    KittiDataset::getColor(state.class_name.c_str(), r, g, b);
+
+    list.resize(std::max(list.size(), num_markers + 3));
+    Marker& box = list[num_markers++];
+    Marker& arrow = list[num_markers++];
+    Marker& text = list[num_markers++];
+    for (Marker* marker : {&box, &arrow, &text}) {
+      marker->header.frame_id = "velo_link";
+      marker->action = Marker::ADD;
+      marker->id = state.id;
+      marker->pose.position.x = boxTranslation[0];
+      marker->pose.position.y = boxTranslation[1];
+      marker->pose.position.z = boxTranslation[2];
+      marker->pose.orientation.w = boxRotation.w();
+      marker->pose.orientation.x = boxRotation.x();
+      marker->pose.orientation.y = boxRotation.y();
+      marker->pose.orientation.z = boxRotation.z();
+      marker->color.r = r / 255.0;
+      marker->color.g = g / 255.0;
+      marker->color.b = b / 255.0;
+      marker->color.a = 1.0;
+      marker->lifetime = ros::Duration();
+      marker->frame_locked = false;
+      marker->text.clear();
+    }
+
     // Fill in bounding box information
-    viz_obj.action = Marker::ADD;
-    viz_obj.ns = "bbox";
-    viz_obj.type = Marker::CUBE;
-    viz_obj.header.frame_id = "velo_link";
-    viz_obj.id = i;
+    box.ns = "bbox";
+    box.type = Marker::CUBE;
+    box.scale.x = boxLength;
+    box.scale.y = boxWidth;
+    box.scale.z = boxHeight;
+    box.color.a = 0.6;
+
+    // Heading, from the box center to the front face
+    arrow.ns = "heading";
+    arrow.type = Marker::ARROW;
+    arrow.scale.x = boxLength / 2.0 + 0.5;
+    arrow.scale.y = 0.2;
+    arrow.scale.z = 0.2;
+
+    // Type and id above the box
+    text.ns = "id";
+    text.type = Marker::TEXT_VIEW_FACING;
+    text.pose.position.z += boxHeight / 2.0 + 0.5;
+    text.pose.orientation.w = 1.0;
+    text.pose.orientation.x = 0.0;
+    text.pose.orientation.y = 0.0;
+    text.pose.orientation.z = 0.0;
+    text.scale.x = 0.0;
+    text.scale.y = 0.0;
+    text.scale.z = 0.8;
+    text.text = state.class_name + " " + std::to_string(state.id);
+  }
+  // Drop the markers left from a previous frame with more tracklets
+  list.resize(num_markers);
+  pub.publish(MarkerArrayConstPtr(markers));
+}
+
+/// The ObjectArray gets the complete state of every object
+void fillObjectArray(const std::vector<kitti_utils::ObjectState>& states, iv_dynamicobject_msgs::ObjectArray& object_array) {
+  for (const kitti_utils::ObjectState& state : states) {
+    int r = 0, g = 255, b = 0;
+    KittiDataset::getColor(state.class_name.c_str(), r, g, b);
 
-    viz_obj.pose.position.x = boxTranslation[0];
-    viz_obj.pose.position.y = boxTranslation[1];
-    viz_obj.pose.position.z = boxTranslation[2];
+    iv_dynamicobject_msgs::Object obj;
+    obj.id = state.id;
+    obj.confidence = 1.0;
+    obj.class_name = state.class_name;
+    obj.height = state.height;
+    obj.width = state.width;
+    obj.length = state.length;
+    obj.r = r;
+    obj.g = g;
+    obj.b = b;
 
-    viz_obj.pose.orientation.w = boxRotation.w();
-    viz_obj.pose.orientation.x = boxRotation.x();
-    viz_obj.pose.orientation.y = boxRotation.y();
-    viz_obj.pose.orientation.z = boxRotation.z();
+    obj.velo_pose.header.frame_id = "velo_link";
+    obj.velo_pose.point.x = state.velo_position[0];
+    obj.velo_pose.point.y = state.velo_position[1];
+    obj.velo_pose.point.z = state.velo_position[2];
+
+    obj.cam_pose.header.frame_id = "camera_color_left";
+    obj.cam_pose.point.x = state.cam_position[0];
+    obj.cam_pose.point.y = state.cam_position[1];
+    obj.cam_pose.point.z = state.cam_position[2];
+
+    // World pose only with the oxts trajectory, otherwise left empty
+    if (state.has_world) {
+      obj.world_pose.header.frame_id = "world";
+      obj.world_pose.point.x = state.world_position[0];
+      obj.world_pose.point.y = state.world_position[1];
+      obj.world_pose.point.z = state.world_position[2];
+      obj.orientation = state.world_yaw;
+    }
 
-    viz_obj.scale.x = boxLength;
-    viz_obj.scale.y = boxWidth;
-    viz_obj.scale.z = boxHeight;
+    obj.heading = state.velo_yaw;
+    obj.velocity = state.speed;
+    object_array.list.push_back(obj);
+  }
+}
 
-    viz_obj.color.a = 0.6;
-    viz_obj.color.g = 1.0;
+namespace kitti_tracking_player {
+
+namespace {
+
+/// Processing stages of a frame, each runs only when its output is needed
+enum Stage {
+  kImageDecode,
+  kCloudLoad,
+  kDeskew,
+  kLabels,
+  kRangeImage,
+  kProjection,
+  kBoxOverlay,
+  kLabelImage,
+  kMarkers,
+  kObjectArray,
+  kPoseTF,
+  kNumStages
+};
+const char* const kStageNames[kNumStages] = {"image decode", "cloud load", "deskew", "labels", "range image",
+                                             "projection", "box overlay", "label image", "markers", "object array",
+                                             "pose tf"};
+
+/// Timed steps of a frame, recorded in the latency histograms of the profiler
+enum Timing {
+  kTimeSleep,
+  kTimeTracklets,
+  kTimeImageWait,
+  kTimeImagePublish,
+  kTimeCloudRead,
+  kTimeDeskew,
+  kTimeLabels,
+  kTimeRangeImage,
+  kTimeMap,
+  kTimeOxts,
+  kTimePoseTF,
+  kTimeVizPost,
+  kNumTimings
+};
+const char* const kTimingNames[kNumTimings] = {"sleep", "tracklets", "image wait", "image publish", "cloud read",
+                                               "deskew", "labels", "range image", "map", "oxts", "pose tf", "viz post"};
+
+/// Time between two velodyne scans (s), the KITTI sequences are recorded at 10 Hz
+const double kVeloScanPeriod = 0.1;
+/// Bound of the accumulated map, its hash table takes 64 MB
+const size_t kMaxMapVoxels = 1000000;
+/// Period of the statistics published on /diagnostics (s)
+const double kDiagnosticsPeriod = 1.0;
+
+/// Extrinsics from the oxts-unit to the velodyne, identity if not in the calibration file
+Eigen::Isometry3d ImuToVelo(const kitti_utils::Calibration& calib) {
+  Eigen::Isometry3d transform = Eigen::Isometry3d::Identity();
+  Eigen::MatrixXf imu_to_velo = calib.Imu2Velo();
+  if (imu_to_velo.size() == 12)
+    transform.matrix().topRows<3>() = imu_to_velo.cast<double>();
+  return transform;
+}
 
-    pub.publish(viz_obj);
+void printDirectoryTree() {
+  cout << "kitti_player needs a directory tree like the following:" << endl;
+  cout << "└── training" << endl;
+  cout << "    ├── image_02              " << endl;
+  cout << "    │   └── 0000              " << endl;
+  cout << "    │   └── 0001              " << endl;
+  cout << "    ├── oxts                  " << endl;
+  cout << "    │   └── 0000.txt          " << endl;
+  cout << "    │   └── 0001.txt          " << endl;
+  cout << "    ├── velodyne              " << endl;
+  cout << "    │   └── 0000              " << endl;
+  cout << "    │   └── 0001              " << endl;
+}
 
-    obj.height = boxHeight;
-    obj.width = boxWidth;
-    obj.length = boxLength;
+kitti_utils::PlaybackMode toPlaybackMode(const std::string& name) {
+  kitti_utils::PlaybackMode mode = kitti_utils::PlaybackMode::kRealtime;
+  kitti_utils::ParsePlaybackMode(name, &mode);
+  return mode;
+}
 
-    obj.velo_pose.header.frame_id = "velo_link";
-    obj.velo_pose.point.x = boxTranslation[0];
-    obj.velo_pose.point.y = boxTranslation[1];
-    obj.velo_pose.point.z = (float)tpose.tz;
+/// Frames processed in more than the frame period miss the deadline, at the sensor rate when not paced
+double frameDeadline(const kitti_player_options& options) {
+  if (toPlaybackMode(options.playbackMode) == kitti_utils::PlaybackMode::kRealtime && options.frequency > 0)
+    return 1.0 / options.frequency;
+  return kVeloScanPeriod;
+}
 
-    obj.heading = (float)tpose.rz;
-    object_array.list.push_back(obj);
-  }
+/// Count elements in the folder, skip . & ..
+unsigned int countEntries(const std::string& dir_name) {
+  int total_entries = kitti_utils::ListFilesInDirectory(dir_name);
+  return total_entries > 0 ? total_entries : 0;
 }
 
-/**
- * @brief main Kitti_player, a player for KITTI raw datasets
- * @param argc
- * @param argv
- * @return 0 and ros::shutdown at the end of the dataset, -1 if errors
- *
- * Allowed options:
- *   -h [ --help ]                       help message
- *   -d [ --directory  ] arg             *required* - path to the kitti dataset Directory
- *   -f [ --frequency  ] arg (=1)        set replay Frequency
- *   -a [ --all        ] [=arg(=1)] (=0) replay All data
- *   -v [ --velodyne   ] [=arg(=1)] (=0) replay Velodyne data
- *   -g [ --gps        ] [=arg(=1)] (=0) replay Gps data
- *   -i [ --imu        ] [=arg(=1)] (=0) replay Imu data
- *   -G [ --grayscale  ] [=arg(=1)] (=0) replay Stereo Grayscale images
- *   -C [ --color      ] [=arg(=1)] (=0) replay Stereo Color images
- *   -V [ --viewer     ] [=arg(=1)] (=0) enable image viewer
- *   -T [ --timestamps ] [=arg(=1)] (=0) use KITTI timestamps
- *   -s [ --stereoDisp ] [=arg(=1)] (=0) use pre-calculated disparities
- *   -D [ --viewDisp   ] [=arg(=1)] (=0) view loaded disparity images
- *   -F [ --frame      ] [=arg(=0)] (=0) start playing at frame ...
- *
- * Datasets can be downloaded from: http://www.cvlibs.net/datasets/kitti/raw_data.php
- */
-int main(int argc, char** argv) {
-  int dataset_index = 5;
-  KittiDataset* dataset;
-  // Init the viewer with the first point cloud and corresponding tracklets
-  dataset = new KittiDataset(KittiConfig::availableDatasets.at(dataset_index));
+}  // namespace
 
-  kitti_player_options options;
-  string sequence_num;  // string for easily concanate
+int ParseOptions(const std::vector<std::string>& args, kitti_player_options& options) {
   po::variables_map vm;
 
   po::options_description desc("Kitti_player, a player for KITTI raw datasets\nDatasets can be downloaded from: http://www.cvlibs.net/datasets/kitti/raw_data.php\n\nAllowed options", 200);
   desc.add_options()
   ("help,h", "help message")
   ("directory ,d", po::value<string>(&options.path)->required(), "*required* - path to the kitti dataset Directory")
-  ("sequence  ,s", po::value<string>(&sequence_num)->required(), "*required* - want to handle which sequnce, e.g. 0000")
+  ("sequence  ,s", po::value<string>(&options.sequence)->required(), "*required* - want to handle which sequnce, e.g. 0000")
   ("frequency ,f", po::value<float>(&options.frequency)->default_value(1.0), "set replay Frequency")
   ("all       ,a", po::value<bool>(&options.all_data)->default_value(0)->implicit_value(1), "replay All data")
   ("velodyne  ,v", po::value<bool>(&options.velodyne)->default_value(0)->implicit_value(1), "replay Velodyne data")
   ("gps       ,g", po::value<bool>(&options.gps)->default_value(0)->implicit_value(1), "replay Gps data")
   ("imu       ,i", po::value<bool>(&options.imu)->default_value(0)->implicit_value(1), "replay Imu data")
   ("color     ,C", po::value<bool>(&options.color)->default_value(0)->implicit_value(1), "replay Stereo Color images")
-  ("viewer    ,V", po::value<bool>(&options.viewer)->default_value(0)->implicit_value(1), "enable image viewer")
+  ("viewer    ,V", po::value<bool>(&options.viewer)->default_value(0)->implicit_value(1), "show the color image and the visualization images in local windows, refreshed by the visualization thread")
   ("frame     ,F", po::value<unsigned int>(&options.startFrame)->default_value(0)->implicit_value(0), "start playing at frame...")
   ("gpsPoints ,p", po::value<string>(&options.gpsReferenceFrame)->default_value(""), "publish GPS/RTK markers to RVIZ, having reference frame as <reference_frame> [example: -p map]")
-  ("synchMode ,S", po::value<bool>(&options.synchMode)->default_value(0)->implicit_value(1), "Enable Synch mode (wait for signal to load next frame [std_msgs/Bool data: true]");
+  ("synchMode ,S", po::value<bool>(&options.synchMode)->default_value(0)->implicit_value(1), "Enable Synch mode (wait for signal to load next frame [std_msgs/Bool data: true]")
+  ("mode      ,M", po::value<string>(&options.playbackMode)->default_value("realtime"), "playback mode: realtime (paced by frequency), max (as fast as possible) or adaptive (bounded by acknowledges on /kitti_player/ack [std_msgs/Header])")
+  ("window    ,W", po::value<unsigned int>(&options.ackWindow)->default_value(2), "adaptive mode: max number of published frames not yet acknowledged")
+  ("decodeThreads,j", po::value<unsigned int>(&options.decodeThreads)->default_value(2), "number of threads decoding the images of the next frames")
+  ("cache     ,c", po::value<string>(&options.imageCache)->default_value(""), "directory of the decoded image cache, built on first play of a sequence and reused afterwards")
+  ("deskew    ,k", po::value<bool>(&options.deskew)->default_value(0)->implicit_value(1), "publish the velodyne clouds motion compensated with the oxts trajectory on velo/pointcloud_deskewed")
+  ("accumulate,A", po::value<bool>(&options.accumulate)->default_value(0)->implicit_value(1), "accumulate the velodyne clouds in the world frame and publish them on velo/map")
+  ("voxelSize", po::value<float>(&options.voxelSize)->default_value(0.2f), "accumulation: edge of the map voxels (m)")
+  ("mapAge", po::value<unsigned int>(&options.mapAge)->default_value(50), "accumulation: number of frames a voxel is kept without being hit")
+  ("mapEvery", po::value<unsigned int>(&options.mapEvery)->default_value(10), "accumulation: publish the map every N frames")
+  ("labels    ,l", po::value<bool>(&options.labels)->default_value(0)->implicit_value(1), "publish the velodyne clouds with int32 fields label and instance (tracklet id) of every point on velo/pointcloud_labelled")
+  ("rangeImage,R", po::value<bool>(&options.rangeImage)->default_value(0)->implicit_value(1), "publish the spherical projection of the velodyne clouds as 64 x 2048 float images on velo/range_image/range, velo/range_image/intensity and velo/range_image/xyz");
+
+  // Options not available in the tracking player
+  options.grayscale = false;
+  options.timestamps = false;
+  options.sendTransform = false;
+  options.stereoDisp = false;
+  options.viewDisparities = false;
 
   try  // parse options
   {
-    po::parsed_options parsed = po::command_line_parser(argc, argv).options(desc).allow_unregistered().run();
+    po::parsed_options parsed = po::command_line_parser(args).options(desc).allow_unregistered().run();
     po::store(parsed, vm);
     po::notify(vm);
 
     vector<string> to_pass_further = po::collect_unrecognized(parsed.options, po::include_positional);
   } catch (...) {
     cerr << desc << endl;
-
-    cout << "kitti_player needs a directory tree like the following:" << endl;
-    cout << "└── training" << endl;
-    cout << "    ├── image_02              " << endl;
-    cout << "    │   └── 0000              " << endl;
-    cout << "    │   └── 0001              " << endl;
-    cout << "    ├── oxts                  " << endl;
-    cout << "    │   └── 0000.txt          " << endl;
-    cout << "    │   └── 0001.txt          " << endl;
-    cout << "    ├── velodyne              " << endl;
-    cout << "    │   └── 0000              " << endl;
-    cout << "    │   └── 0001              " << endl;
+    printDirectoryTree();
 
     ROS_WARN_STREAM("Parse error, shutting down node\n");
     return -1;
   }
 
-  ros::init(argc, argv, "kitti_tracking_player");
-  ros::NodeHandle node("kitti");
-  ros::Rate loop_rate(options.frequency);
-
-  /// This sets the logger level; use this to disable all ROS prints
-  if (ros::console::set_logger_level(ROSCONSOLE_DEFAULT_NAME, ros::console::levels::Info))
-    ros::console::notifyLoggerLevelsChanged();
-  else
-    std::cout << "Error while setting the logger level!" << std::endl;
-
-  /// Define variable sto store the files path
-  DIR* dir;
-  struct dirent* ent;
-  unsigned int total_entries = 0;   //number of elements to be played
-  unsigned int entries_played = 0;  //number of elements played until now
-  unsigned int len = 0;             //counting elements support variable
-  string dir_root;
-  string dir_image02;
-  string full_filename_image02;
-  string dir_label02;  // Image labels
-  string dir_oxts;
-  string dir_calib;
-  string full_filename_calibration;
-  string full_filename_oxts;
-  string dir_timestamp_oxts;
-  string dir_velodyne_points;
-  string full_filename_velodyne;
-  string dir_timestamp_velodyne;  //average of start&end (time of scan)
-  string str_support;
-  cv::Mat cv_image02;
-  cv::Mat cv_image03;
-  cv::Mat cv_image04;
-  std_msgs::Header header_support;
-  KittiTrackLabel* kitti_track_label;
+  if (vm.count("help")) {
+    cout << desc << endl;
+    printDirectoryTree();
+    return 1;
+  }
 
-  sensor_msgs::Image ros_msg02;
-  sensor_msgs::Image ros_msg03;
-  //    sensor_msgs::CameraInfo ros_cameraInfoMsg;
-  sensor_msgs::CameraInfo ros_cameraInfoMsg_camera02;
-  sensor_msgs::CameraInfo ros_cameraInfoMsg_camera03;
-  cv_bridge::CvImage cv_bridge_img;
+  kitti_utils::PlaybackMode playback_mode;
+  if (!kitti_utils::ParsePlaybackMode(options.playbackMode, &playback_mode)) {
+    cerr << desc << endl;
+    ROS_WARN_STREAM("Unknown playback mode " << options.playbackMode << ", shutting down node\n");
+    return -1;
+  }
+  return 0;
+}
 
+KittiTrackingPlayer::KittiTrackingPlayer(const ros::NodeHandle& node, const kitti_player_options& options)
+    : options_(options),
+      node_(node),
+      playback_(toPlaybackMode(options.playbackMode), options.frequency, options.ackWindow, options.synchMode),
+      profiler_("kitti_tracking_player", options.sequence, frameDeadline(options)),
+      stopped_(false),
+      total_entries_(0),
+      velo_to_imu_(Eigen::Isometry3d::Identity()),
+      it_(node_),
+      firstGpsData_(true) {
   /// Define the ROS publishers
-  image_transport::ImageTransport it(node);
-  image_transport::CameraPublisher pub02 = it.advertiseCamera("camera_color_left/image_raw", 1);
-  ros::Publisher velo_cloud_pub = node.advertise<pcl::PointCloud<pcl::PointXYZ> >("velo/pointcloud", 1, true);
-  ros::Publisher gps_pub = node.advertise<sensor_msgs::NavSatFix>("oxts/gps", 1, true);
-  ros::Publisher gps_pub_initial = node.advertise<sensor_msgs::NavSatFix>("oxts/gps_initial", 1, true);
-  ros::Publisher imu_pub = node.advertise<sensor_msgs::Imu>("oxts/imu", 1, true);
-  ros::Publisher raw_image_with_bboxes_pub = node.advertise<darknet_ros_msgs::ImageWithBBoxes>("/darknet_ros/image_with_bboxes", 1);
-  ros::Publisher vis_marker_pub_ = node.advertise<Marker>("/viz/visualization_marker", 1);
-  ros::Publisher object_array_pub = node.advertise<iv_dynamicobject_msgs::ObjectArray>("/detection/object_array", 1);
-
-  sensor_msgs::NavSatFix ros_msgGpsFix;
-  sensor_msgs::NavSatFix ros_msgGpsFixInitial;  // This message contains the first reading of the file
-  bool firstGpsData = true;                     // Flag to store the ros_msgGpsFixInitial message
-  sensor_msgs::Imu ros_msgImu;
-
-  ros::Subscriber sub = node.subscribe("/kitti_player/synch", 1, synchCallback);  // refs #600
+  pub02_ = it_.advertiseCamera("camera_color_left/image_raw", 1);
+  image_boxes_pub_ = it_.advertise("camera_color_left/image_boxes", 1);
+  image_labels_pub_ = it_.advertise("camera_color_left/image_labels", 1);
+  image_projection_pub_ = it_.advertise("camera_color_left/image_projection", 1);
+  range_image_pub_ = it_.advertise("velo/range_image/range", 1);
+  range_intensity_pub_ = it_.advertise("velo/range_image/intensity", 1);
+  range_xyz_pub_ = it_.advertise("velo/range_image/xyz", 1);
+  bounding_boxes_pub_ = node_.advertise<darknet_ros_msgs::BoundingBoxes>("camera_color_left/bounding_boxes", 1);
+  // Not latched, a latched publisher keeps the last cloud and the buffer could never be reused
+  velo_cloud_pub_ = node_.advertise<sensor_msgs::PointCloud2>("velo/pointcloud", 1);
+  velo_cloud_deskewed_pub_ = node_.advertise<sensor_msgs::PointCloud2>("velo/pointcloud_deskewed", 1);
+  velo_map_pub_ = node_.advertise<sensor_msgs::PointCloud2>("velo/map", 1);
+  velo_cloud_labelled_pub_ = node_.advertise<sensor_msgs::PointCloud2>("velo/pointcloud_labelled", 1);
+  gps_pub_ = node_.advertise<sensor_msgs::NavSatFix>("oxts/gps", 1, true);
+  gps_pub_initial_ = node_.advertise<sensor_msgs::NavSatFix>("oxts/gps_initial", 1, true);
+  imu_pub_ = node_.advertise<sensor_msgs::Imu>("oxts/imu", 1, true);
+  raw_image_with_bboxes_pub_ = node_.advertise<darknet_ros_msgs::ImageWithBBoxes>("/darknet_ros/image_with_bboxes", 1);
+  vis_marker_pub_ = node_.advertise<MarkerArray>("/viz/visualization_marker_array", 1);
+  object_array_pub_ = node_.advertise<iv_dynamicobject_msgs::ObjectArray>("/detection/object_array", 1);
+  // Shares the /tf publication with the tf broadcasters of the process, tells whether the pose is listened to
+  tf_pub_ = node_.advertise<tf2_msgs::TFMessage>("/tf", 100);
+  diagnostics_pub_ = node_.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 1);
+
+  // Same order as the Stage enum
+  for (int stage = 0; stage < kNumStages; ++stage)
+    stages_.AddStage(kStageNames[stage]);
+  for (int timing = 0; timing < kNumTimings; ++timing)
+    profiler_.AddStage(kTimingNames[timing]);
+
+  // refs #600, synch and acknowledge callbacks run in another thread and wake up the player
+  synch_sub_ = node_.subscribe("/kitti_player/synch", 1, &kitti_utils::PlaybackController::SynchCallback, &playback_);
+  credits_sub_ = node_.subscribe("/kitti_player/synch_credits", 10, &kitti_utils::PlaybackController::CreditsCallback, &playback_);
+  ack_sub_ = node_.subscribe("/kitti_player/ack", 10, &kitti_utils::PlaybackController::AckCallback, &playback_);
+}
 
-  if (vm.count("help")) {
-    cout << desc << endl;
+KittiTrackingPlayer::~KittiTrackingPlayer() {
+  // The visualization worker publishes from its own thread
+  if (viz_worker_)
+    viz_worker_->Stop();
+  // Callbacks use playback_, make sure none is running or will be called
+  synch_sub_.shutdown();
+  credits_sub_.shutdown();
+  ack_sub_.shutdown();
+}
 
-    cout << "kitti_player needs a directory tree like the following:" << endl;
-    cout << "└── training" << endl;
-    cout << "    ├── image_02              " << endl;
-    cout << "    │   └── 0000              " << endl;
-    cout << "    │   └── 0001              " << endl;
-    cout << "    ├── oxts                  " << endl;
-    cout << "    │   └── 0000.txt          " << endl;
-    cout << "    │   └── 0001.txt          " << endl;
-    cout << "    ├── velodyne              " << endl;
-    cout << "    │   └── 0000              " << endl;
-    cout << "    │   └── 0001              " << endl;
+void KittiTrackingPlayer::Stop() {
+  stopped_ = true;
+  playback_.Stop();
+}
 
-    return 1;
-  }
+bool KittiTrackingPlayer::Init() {
+  int dataset_index = 5;
+  // Init the viewer with the first point cloud and corresponding tracklets
+  dataset_.reset(new KittiDataset(KittiConfig::availableDatasets.at(dataset_index)));
 
-  if (!(options.all_data || options.color || options.gps || options.grayscale || options.imu || options.velodyne)) {
+  if (!(options_.all_data || options_.color || options_.gps || options_.grayscale || options_.imu || options_.velodyne)) {
     ROS_WARN_STREAM("Job finished without playing the dataset. No 'publishing' parameters provided");
-    node.shutdown();
-    return 1;
+    return false;
   }
 
-  ROS_WARN_STREAM("You have choose play back " << sequence_num << " data");
-
-  dir_root = options.path;
-  dir_image02 = options.path;
-  dir_oxts = options.path;
-  dir_velodyne_points = options.path;
+  ROS_WARN_STREAM("You have choose play back " << options_.sequence << " data");
 
-  (*(options.path.end() - 1) != '/' ? dir_root = options.path + "/" : dir_root = options.path);
-  (*(options.path.end() - 1) != '/' ? dir_image02 = options.path + "/image_02/" : dir_image02 = options.path + "image_02/");
-  (*(options.path.end() - 1) != '/' ? dir_calib = options.path + "/calib/" : dir_calib = options.path + "calib/");
-  (*(options.path.end() - 1) != '/' ? dir_label02 = options.path + "/label_02/" : dir_label02 = options.path + "label_02/");
-  (*(options.path.end() - 1) != '/' ? dir_oxts = options.path + "/oxts/" : dir_oxts = options.path + "oxts/");
-  (*(options.path.end() - 1) != '/' ? dir_velodyne_points = options.path + "/velodyne/" : dir_velodyne_points = options.path + "velodyne/");
+  const string& path = options_.path;
+  (*(path.end() - 1) != '/' ? dir_image02_ = path + "/image_02/" : dir_image02_ = path + "image_02/");
+  (*(path.end() - 1) != '/' ? dir_calib_ = path + "/calib/" : dir_calib_ = path + "calib/");
+  (*(path.end() - 1) != '/' ? dir_label02_ = path + "/label_02/" : dir_label02_ = path + "label_02/");
+  (*(path.end() - 1) != '/' ? dir_oxts_ = path + "/oxts/" : dir_oxts_ = path + "oxts/");
+  (*(path.end() - 1) != '/' ? dir_velodyne_points_ = path + "/velodyne/" : dir_velodyne_points_ = path + "velodyne/");
 
   // Check all the directories
-  if ((options.all_data && ((opendir(dir_image02.c_str()) == NULL) ||
-                            (opendir(dir_oxts.c_str()) == NULL) ||
-                            (opendir(dir_label02.c_str()) == NULL) ||
-                            (opendir(dir_calib.c_str()) == NULL) ||
-                            (opendir(dir_velodyne_points.c_str()) == NULL))) ||
-      (options.color && ((opendir(dir_image02.c_str()) == NULL) ||
-                         (opendir(dir_label02.c_str()) == NULL))) ||
-      (options.imu && ((opendir(dir_oxts.c_str()) == NULL))) ||
-      (options.gps && ((opendir(dir_oxts.c_str()) == NULL))) ||
-      (options.velodyne && ((opendir(dir_velodyne_points.c_str()) == NULL)))) {
+  auto exists = [](const string& dir_name) {
+    DIR* dir = opendir(dir_name.c_str());
+    if (dir == NULL)
+      return false;
+    closedir(dir);
+    return true;
+  };
+  if ((options_.all_data && (!exists(dir_image02_) ||
+                             !exists(dir_oxts_) ||
+                             !exists(dir_label02_) ||
+                             !exists(dir_calib_) ||
+                             !exists(dir_velodyne_points_))) ||
+      (options_.color && (!exists(dir_image02_) ||
+                          !exists(dir_label02_))) ||
+      (options_.imu && !exists(dir_oxts_)) ||
+      (options_.gps && !exists(dir_oxts_)) ||
+      (options_.velodyne && !exists(dir_velodyne_points_))) {
     ROS_ERROR("Incorrect tree directory , use --help for details");
-    node.shutdown();
-    return -1;
+    return false;
   } else {
     ROS_INFO_STREAM("Checking directories...");
-    ROS_INFO_STREAM(options.path << string(sequence_num) << "\t[OK]");
+    ROS_INFO_STREAM(path << options_.sequence << "\t[OK]");
   }
 
   //count elements in the folder
-  string filename_image02 = dir_image02 + sequence_num + "/";
-  if (options.all_data)  //if replay all data in data folders
-  {
-    total_entries = kitti_utils::ListFilesInDirectory(filename_image02);
+  string filename_image02 = dir_image02_ + options_.sequence + "/";
+  if (options_.all_data || options_.color) {
+    total_entries_ = countEntries(filename_image02);
+  } else if (options_.velodyne) {
+    total_entries_ = countEntries(dir_velodyne_points_ + options_.sequence + "/");
   } else {
-    bool done = false;
-    if (!done && options.color) {
-      total_entries = 0;
-      dir = opendir(filename_image02.c_str());
-      while ((ent = readdir(dir))) {
-        //skip . & ..
-        len = strlen(ent->d_name);
-        //skip . & ..
-        if (len > 2)
-          total_entries++;
-      }
-      closedir(dir);
-      done = true;
-    }
-    if (!done && options.gps) {
-      total_entries = 0;
-      dir = opendir(dir_oxts.c_str());
-      while ((ent = readdir(dir))) {
-        //skip . & ..
-        len = strlen(ent->d_name);
-        //skip . & ..
-        if (len > 2)
-          total_entries++;
-      }
-      closedir(dir);
-      done = true;
-    }
-    if (!done && options.imu) {
-      total_entries = 0;
-      dir = opendir(dir_oxts.c_str());
-      while ((ent = readdir(dir))) {
-        //skip . & ..
-        len = strlen(ent->d_name);
-        //skip . & ..
-        if (len > 2)
-          total_entries++;
-      }
-      closedir(dir);
-      done = true;
-    }
-    if (!done && options.velodyne) {
-      total_entries = 0;
-      dir = opendir(dir_oxts.c_str());
-      while ((ent = readdir(dir))) {
-        //skip . & ..
-        len = strlen(ent->d_name);
-        //skip . & ..
-        if (len > 2)
-          total_entries++;
-      }
-      closedir(dir);
-      done = true;
-    }
+    total_entries_ = countEntries(dir_oxts_);
   }
 
   // Check options.startFrame and total_entries
-  if (options.startFrame > total_entries) {
+  if (options_.startFrame > total_entries_) {
     ROS_ERROR("Error, start number > total entries in the dataset");
-    node.shutdown();
-    return -1;
+    return false;
   } else {
-    entries_played = options.startFrame;
-    ROS_INFO_STREAM("The entry point (frame number) is: " << entries_played);
-    ROS_WARN_STREAM("The total frames numberis: " << total_entries);
-  }
-
-  if (options.viewer) {
-    ROS_INFO_STREAM("Opening CV viewer(s)");
-    if (options.color || options.all_data) {
-      ROS_DEBUG_STREAM("color||all " << options.color << " " << options.all_data);
-      cv::namedWindow("CameraSimulator Color Viewer", CV_WINDOW_AUTOSIZE);
-      full_filename_image02 = dir_image02 + sequence_num + boost::str(boost::format("%06d") % 0) + ".png";
-      cv_image02 = cv::imread(full_filename_image02, CV_LOAD_IMAGE_UNCHANGED);
-      cv::waitKey(5);
-    }
-    ROS_INFO_STREAM("Opening CV viewer(s)... OK");
+    ROS_INFO_STREAM("The entry point (frame number) is: " << options_.startFrame);
+    ROS_WARN_STREAM("The total frames numberis: " << total_entries_);
   }
 
   // CAMERA INFO SECTION: read one for all
-  ros_cameraInfoMsg_camera02.header.stamp = ros::Time::now();
-  ros_cameraInfoMsg_camera02.header.frame_id = ros::this_node::getName();
-  ros_cameraInfoMsg_camera02.height = 0;
-  ros_cameraInfoMsg_camera02.width = 0;
-  //ros_cameraInfoMsg_camera02.D.resize(5);
-  //ros_cameraInfoMsg_camera02.distortion_model=sensor_msgs::distortion_models::PLUMB_BOB;
+  ros_cameraInfoMsg_camera02_.header.stamp = ros::Time::now();
+  ros_cameraInfoMsg_camera02_.header.frame_id = ros::this_node::getName();
+  ros_cameraInfoMsg_camera02_.height = 0;
+  ros_cameraInfoMsg_camera02_.width = 0;
 
   //get color camera calibration matrix and set the image size
-
-  if (options.color || options.all_data) {
-    //Assume same height/width for the camera pair
-    full_filename_image02 = dir_image02 + sequence_num + "/" + boost::str(boost::format("%06d") % 0) + ".png";
-    cv_image02 = cv::imread(full_filename_image02, CV_LOAD_IMAGE_UNCHANGED);
-    cv::waitKey(5);
-    ros_cameraInfoMsg_camera03.height = ros_cameraInfoMsg_camera02.height = cv_image02.rows;  // -1;TODO: CHECK, qui potrebbe essere -1
-    ros_cameraInfoMsg_camera03.width = ros_cameraInfoMsg_camera02.width = cv_image02.cols;    // -1;
+  if (options_.color || options_.all_data) {
+    string full_filename_image02 = filename_image02 + boost::str(boost::format("%06d") % 0) + ".png";
+    cv_image02_ = cv::imread(full_filename_image02, CV_LOAD_IMAGE_UNCHANGED);
+    ros_cameraInfoMsg_camera02_.height = cv_image02_.rows;
+    ros_cameraInfoMsg_camera02_.width = cv_image02_.cols;
 
     // Read detection label
-    string full_fliename_label02 = dir_label02 + sequence_num + ".txt";
-    kitti_track_label = new KittiTrackLabel(full_fliename_label02, cv::Size(cv_image02.size()));
+    string full_fliename_label02 = dir_label02_ + options_.sequence + ".txt";
+    kitti_track_label_.reset(new KittiTrackLabel(full_fliename_label02, cv::Size(cv_image02_.size())));
+  }
+
+  // Decode the images of the next frames while the current one is published
+  if (options_.color || options_.all_data) {
+    decode_pool_.reset(new kitti_utils::ImageDecodePool(options_.decodeThreads, 4));
+    decode_pool_->AddCamera("image_02", filename_image02 + "%06d.png", CV_LOAD_IMAGE_UNCHANGED);
+    if (!options_.imageCache.empty()) {
+      // e.g. <cache>/training_0000.imgcache
+      string dataset_name = path.substr(0, path.find_last_not_of('/') + 1);
+      dataset_name = dataset_name.substr(dataset_name.find_last_of('/') + 1);
+      decode_pool_->EnableCache(options_.imageCache + "/" + dataset_name + "_" + options_.sequence + ".imgcache");
+    }
+    decode_pool_->Start(options_.startFrame, total_entries_);
   }
 
   // Load calibration matrix anyway
-  full_filename_calibration = dir_calib + sequence_num + ".txt";
-  calib_params = kitti_utils::Calibration(full_filename_calibration);
+  string full_filename_calibration = dir_calib_ + options_.sequence + ".txt";
+  calib_params_ = kitti_utils::Calibration(full_filename_calibration);
+  // Extrinsics of the oxts-unit, used by the deskewing, the map and the object states
+  const Eigen::Isometry3d imu_to_velo = ImuToVelo(calib_params_);
+  velo_to_imu_ = imu_to_velo.inverse();
+
+  // Parse all the gps and imu records once
+  if (options_.all_data || options_.gps || options_.imu || options_.deskew || options_.accumulate) {
+    if (!oxts_.LoadFile(dir_oxts_ + options_.sequence + ".txt"))
+      return false;
+    // The world frame starts at the first played frame
+    if (!trajectory_.Build(oxts_, options_.startFrame))
+      return false;
+  }
+
+  if (options_.deskew) {
+    if (!(options_.velodyne || options_.all_data))
+      ROS_WARN_STREAM("Deskewing needs the velodyne data (-v), no deskewed cloud will be published");
+    // Tracking sequences have no timestamps, frames are kVeloScanPeriod apart in the trajectory time
+    std::vector<ros::Time> stamps(trajectory_.size());
+    for (unsigned int i = 0; i < stamps.size(); ++i)
+      stamps[i] = ros::Time(i * kVeloScanPeriod);
+    if (!trajectory_.SetStamps(stamps))
+      return false;
+
+    deskewer_.reset(new kitti_utils::CloudDeskewer(180, kVeloScanPeriod));
+    deskewer_->SetImuToVelo(imu_to_velo);
+  }
+  if ((options_.deskew || options_.accumulate) && calib_params_.Imu2Velo().size() != 12)
+    ROS_WARN_STREAM("No Tr_imu_velo in " << full_filename_calibration << ", the oxts-unit is taken at the velodyne position");
+
+  if (options_.accumulate) {
+    if (!(options_.velodyne || options_.all_data))
+      ROS_WARN_STREAM("Accumulation needs the velodyne data (-v), the map will stay empty");
+    voxel_map_.reset(new kitti_utils::VoxelMap(options_.voxelSize, options_.mapAge, kMaxMapVoxels));
+  }
+
+  // Object states, in the world frame when the oxts trajectory is loaded
+  object_states_.reset(new kitti_utils::ObjectStateBuilder(kVeloScanPeriod));
+  object_states_->SetCalibration(calib_params_);
+  if (!trajectory_.empty())
+    object_states_->SetTrajectory(&trajectory_, imu_to_velo);
+
+  // Visualization images drawn on the color image, published and shown by a low priority thread.
+  // No HighGUI call is made by the player thread, without -V none at all.
+  if (options_.color || options_.all_data) {
+    viz_worker_.reset(new kitti_utils::VizWorker(calib_params_, options_.viewer,
+        [this](const kitti_utils::VizWorker::Frame& frame, const kitti_utils::VizWorker::Output& output) {
+          PublishViz(frame, output);
+        }));
+  }
+
+  if (options_.labels) {
+    if (!(options_.velodyne || options_.all_data))
+      ROS_WARN_STREAM("Labelling needs the velodyne data (-v), no labelled cloud will be published");
+    labeller_.reset(new kitti_utils::TrackletLabeller());
+  }
+
+  if (options_.rangeImage) {
+    if (!(options_.velodyne || options_.all_data))
+      ROS_WARN_STREAM("Range images need the velodyne data (-v), no range image will be published");
+    range_image_.reset(new kitti_utils::RangeImageBuilder());
+  }
+  return true;
+}
+
+int KittiTrackingPlayer::Run() {
+  unsigned int entries_played = options_.startFrame;  //number of elements played until now
+  int ret = 0;
 
   /******************************************************************************
- *  This is the main Loop
- */
+   *  This is the main Loop
+   */
   // display progress bar
-  boost::progress_display progress(total_entries);
+  boost::progress_display progress(total_entries_);
+  ros::WallTime next_diagnostics = ros::WallTime::now() + ros::WallDuration(kDiagnosticsPeriod);
   do {
-    // this refs #600 synchMode
-    if (options.synchMode) {
-      if (waitSynch == true) {
-        //ROS_DEBUG_STREAM("Waiting for synch...");
-        ros::spinOnce();
-        continue;
-      } else {
-        ROS_DEBUG_STREAM("Run after received synch...");
-        waitSynch = true;
-      }
+    // this refs #600 synchMode, also paces the loop according to the playback mode
+    {
+      kitti_utils::FrameProfiler::Timer timer(profiler_, kTimeSleep);
+      if (!playback_.WaitForNextFrame())
+        break;
     }
 
     // single timestamp for all published stuff
     ros::Time current_timestamp = ros::Time::now();
 
-    // Parse tracklet
-    std::vector<KittiTracklet> availableTracklets;
-    loadAvailableTracklets(dataset, entries_played, availableTracklets);
-    iv_dynamicobject_msgs::ObjectArray object_array;
-    showBoundingBox(vis_marker_pub_, entries_played, availableTracklets, object_array);
-    object_array.header.stamp = current_timestamp;
-    object_array_pub.publish(object_array);
+    ros::WallTime frame_start = ros::WallTime::now();
+    if (!PlayFrame(entries_played, current_timestamp)) {
+      ret = -1;
+      break;
+    }
+    // images were copied into the messages, the slot can be filled with a next frame
+    if (decode_pool_)
+      decode_pool_->ReleaseFrame(entries_played);
+    ros::WallTime frame_end = ros::WallTime::now();
+    profiler_.RecordFrame(entries_played, (frame_end - frame_start).toSec());
+
+    if (frame_end >= next_diagnostics) {
+      diagnostic_msgs::DiagnosticArrayPtr diagnostics = boost::make_shared<diagnostic_msgs::DiagnosticArray>();
+      diagnostics->header.stamp = current_timestamp;
+      diagnostics->status.resize(1);
+      profiler_.FillStatus(diagnostics->status[0]);
+      diagnostics_pub_.publish(diagnostics);
+      next_diagnostics = frame_end + ros::WallDuration(kDiagnosticsPeriod);
+    }
 
-    //publish 02 color camera image
-    if (options.color || options.all_data) {
-      full_filename_image02 = dir_image02 + sequence_num + "/" + boost::str(boost::format("%06d") % entries_played) + ".png";
-      ROS_DEBUG_STREAM(full_filename_image02 << endl
-                                             << endl);
+    playback_.FramePublished(current_timestamp);
+    ++progress;
+    entries_played++;
+  } while (entries_played <= total_entries_ - 1 && ros::ok() && !stopped_);
 
-      cv_image02 = cv::imread(full_filename_image02, CV_LOAD_IMAGE_UNCHANGED);
+  if (viz_worker_)
+    viz_worker_->Stop();
 
-      if ((cv_image02.data == NULL)) {
-        ROS_ERROR_STREAM("Error reading color images 02");
-        ROS_ERROR_STREAM(full_filename_image02 << endl);
-        node.shutdown();
-        return -1;
-      }
+  playback_.PrintSummary();
+  stages_.PrintSummary();
+  profiler_.PrintSummary();
+  if (decode_pool_)
+    decode_pool_->PrintStats();
+  if (viz_worker_)
+    viz_worker_->PrintStats();
+  if (voxel_map_)
+    voxel_map_->PrintStats();
 
-      if (options.viewer) {
-        //display the left image only
-        cv::imshow("CameraSimulator Color Viewer", cv_image02);
-        //give some time to draw images
-        cv::waitKey(5);
-      }
+  ROS_INFO_STREAM("Done!");
+  return ret;
+}
 
-      cv_bridge_img.encoding = sensor_msgs::image_encodings::BGR8;
-      cv_bridge_img.header.frame_id = ros::this_node::getName();
-      // first handle 02 color camera image
-      if (!options.timestamps) {
-        cv_bridge_img.header.stamp = current_timestamp;
-        ros_msg02.header.stamp = ros_cameraInfoMsg_camera02.header.stamp = cv_bridge_img.header.stamp;
-      }
+void KittiTrackingPlayer::PublishViz(const kitti_utils::VizWorker::Frame& frame, const kitti_utils::VizWorker::Output& output) {
+  if (frame.draw_boxes) {
+    darknet_ros_msgs::BoundingBoxesPtr bounding_boxes = boost::make_shared<darknet_ros_msgs::BoundingBoxes>();
+    bounding_boxes->header.stamp = frame.stamp;
+    bounding_boxes->header.frame_id = "detection";
+    for (size_t i = 0; i < output.boxes.size(); ++i) {
+      if (!output.boxes[i].visible)
+        continue;
+      darknet_ros_msgs::BoundingBox bounding_box;
+      bounding_box.Class = frame.names[i];
+      bounding_box.probability = 1.0;
+      bounding_box.xmin = output.boxes[i].bbox.tl().x;
+      bounding_box.ymin = output.boxes[i].bbox.tl().y;
+      bounding_box.xmax = output.boxes[i].bbox.br().x;
+      bounding_box.ymax = output.boxes[i].bbox.br().y;
+      bounding_boxes->bounding_boxes.push_back(bounding_box);
+    }
+    bounding_boxes_pub_.publish(bounding_boxes);
+  }
 
-      cv_bridge_img.image = cv_image02;
-      cv_bridge_img.toImageMsg(ros_msg02);
+  cv_bridge::CvImage cv_bridge_img;
+  cv_bridge_img.encoding = sensor_msgs::image_encodings::BGR8;
+  cv_bridge_img.header.frame_id = ros::this_node::getName();
+  cv_bridge_img.header.stamp = frame.stamp;
+  auto publish = [&cv_bridge_img](image_transport::Publisher& pub, const cv::Mat& image) {
+    if (image.empty() || pub.getNumSubscribers() == 0)
+      return;
+    cv_bridge_img.image = image;
+    pub.publish(cv_bridge_img.toImageMsg());
+  };
+  publish(image_boxes_pub_, output.boxes_image);
+  publish(image_labels_pub_, output.labels_image);
+  publish(image_projection_pub_, output.projection_image);
+}
 
-      // Publish raw image
-      pub02.publish(ros_msg02, ros_cameraInfoMsg_camera02);
+bool KittiTrackingPlayer::PlayFrame(unsigned int entries_played, const ros::Time& current_timestamp) {
+  std_msgs::Header header_support;
 
-      // Publish image with bboxes
-      publishImageWithBBoxes(raw_image_with_bboxes_pub, cv_image02,
-                             kitti_track_label->getObjectVec(entries_played), &cv_bridge_img.header);
+  // Only the stages whose output is subscribed or shown run, enabled stages are counted
+  const bool color = options_.color || options_.all_data;
+  const bool velodyne = options_.velodyne || options_.all_data;
+  const bool need_markers = stages_.Run(kMarkers, vis_marker_pub_.getNumSubscribers() > 0);
+  const bool need_objects = stages_.Run(kObjectArray, object_array_pub_.getNumSubscribers() > 0);
+  const bool need_overlay = color && stages_.Run(kBoxOverlay, image_boxes_pub_.getNumSubscribers() > 0 ||
+                                                              bounding_boxes_pub_.getNumSubscribers() > 0 || options_.viewer);
+  const bool need_label_image = color && stages_.Run(kLabelImage, image_labels_pub_.getNumSubscribers() > 0 || options_.viewer);
+  const bool need_projection = color && velodyne && stages_.Run(kProjection, image_projection_pub_.getNumSubscribers() > 0 ||
+                                                                             options_.viewer);
+  const bool need_image = color && stages_.Run(kImageDecode, pub02_.getNumSubscribers() > 0 ||
+                                                             raw_image_with_bboxes_pub_.getNumSubscribers() > 0 ||
+                                                             need_overlay || need_label_image || need_projection ||
+                                                             options_.viewer);
+  // The map is built from the deskewed clouds and must see every scan
+  const bool need_deskew = velodyne && deskewer_ && stages_.Run(kDeskew, velo_cloud_deskewed_pub_.getNumSubscribers() > 0 || voxel_map_);
+  const bool need_labels = velodyne && labeller_ && stages_.Run(kLabels, velo_cloud_labelled_pub_.getNumSubscribers() > 0);
+  const bool need_range_image = velodyne && range_image_ && stages_.Run(kRangeImage, range_image_pub_.getNumSubscribers() > 0 ||
+                                                                                     range_intensity_pub_.getNumSubscribers() > 0 ||
+                                                                                     range_xyz_pub_.getNumSubscribers() > 0);
+  const bool need_cloud = velodyne && stages_.Run(kCloudLoad, velo_cloud_pub_.getNumSubscribers() > 0 || need_deskew ||
+                                                              need_labels || need_range_image || voxel_map_ || need_projection);
+
+  // Parse tracklet
+  if (need_markers || need_objects || need_overlay) {
+    kitti_utils::FrameProfiler::Timer timer(profiler_, kTimeTracklets);
+    object_states_->Build(dataset_->getTracklets(), entries_played);
+    if (need_markers)
+      showBoundingBox(vis_marker_pub_, object_states_->States(), markers_buffer_);
+    if (need_objects) {
+      iv_dynamicobject_msgs::ObjectArrayPtr object_array = boost::make_shared<iv_dynamicobject_msgs::ObjectArray>();
+      fillObjectArray(object_states_->States(), *object_array);
+      object_array->header.stamp = current_timestamp;
+      object_array_pub_.publish(object_array);
+    }
+  }
 
-      if (options.viewer) {
-        // Add label drawing
-        drawBBoxes(cv_image02, kitti_track_label->getObjectVec(entries_played));
+  // Without subscriber the decode workers skip the next frames, a skipped frame is decoded when needed again
+  if (color)
+    decode_pool_->SetPrefetch(need_image);
+  cv_image02_.release();
+
+  //publish 02 color camera image
+  std::vector<ObjectDetect> labels;
+  if (need_image) {
+    string full_filename_image02 = dir_image02_ + options_.sequence + "/" + boost::str(boost::format("%06d") % entries_played) + ".png";
+    ROS_DEBUG_STREAM(full_filename_image02 << endl
+                                           << endl);
+    {
+      // Time the player waits for the decode workers, 0 when the frame was prefetched
+      kitti_utils::FrameProfiler::Timer timer(profiler_, kTimeImageWait);
+      if (!decode_pool_->WaitFrame(entries_played)) {
+        ROS_ERROR_STREAM("Error reading color images 02");
+        ROS_ERROR_STREAM(full_filename_image02 << endl);
+        return false;
       }
     }
+    cv_image02_ = decode_pool_->Image(entries_played, 0);
+    kitti_utils::FrameProfiler::Timer timer(profiler_, kTimeImagePublish);
+
+    cv_bridge::CvImage cv_bridge_img;
+    cv_bridge_img.encoding = sensor_msgs::image_encodings::BGR8;
+    cv_bridge_img.header.frame_id = ros::this_node::getName();
+    // first handle 02 color camera image
+    cv_bridge_img.header.stamp = current_timestamp;
+    ros_cameraInfoMsg_camera02_.header.stamp = cv_bridge_img.header.stamp;
+    cv_bridge_img.image = cv_image02_;
+
+    // Publish raw image, the image may be decoded for the visualization only
+    if (pub02_.getNumSubscribers() > 0)
+      pub02_.publish(cv_bridge_img.toImageMsg(), boost::make_shared<sensor_msgs::CameraInfo>(ros_cameraInfoMsg_camera02_));
+
+    // Publish image with bboxes
+    labels = kitti_track_label_->getObjectVec(entries_played);
+    publishImageWithBBoxes(raw_image_with_bboxes_pub_, cv_image02_, labels, &cv_bridge_img.header);
+  }
 
-    // Publish velodyne lidar point cloud
-    pcl::PointCloud<pcl::PointXYZI>::Ptr points_pub;
-    if (options.velodyne || options.all_data) {
-      header_support.stamp = current_timestamp;
-      full_filename_velodyne = dir_velodyne_points + sequence_num + "/" + boost::str(boost::format("%06d") % entries_played) + ".bin";
+  // Publish velodyne lidar point cloud
+  sensor_msgs::PointCloud2ConstPtr points_pub;
+  if (need_cloud) {
+    header_support.stamp = current_timestamp;
+    string full_filename_velodyne = dir_velodyne_points_ + options_.sequence + "/" + boost::str(boost::format("%06d") % entries_played) + ".bin";
 
-      // if (!options.timestamps)
-      points_pub = publish_velodyne(velo_cloud_pub, full_filename_velodyne, &header_support);
-      double points_pub_timestamp = header_support.stamp.toSec();
+    {
+      kitti_utils::FrameProfiler::Timer timer(profiler_, kTimeCloudRead);
+      points_pub = publish_velodyne(velo_cloud_pub_, full_filename_velodyne, &header_support, velo_cloud_buffer_);
     }
 
-    // Get gps and imu data lines
-    static std::vector<std::string> lines;  // every element represent a single line, don't change
-    if (options.all_data || options.gps || options.imu) {
-      typedef boost::tokenizer<boost::char_separator<char> > tokenizer;
-      full_filename_oxts = dir_oxts + sequence_num + ".txt";
-
-      static bool init_read = true;
-      if (init_read) {
-        // Read oxts contents in file
-        boost::char_separator<char> sep_line{"\n"};
-
-        // Read all contents in file
-        std::ifstream t(full_filename_oxts);
-        if (!t.is_open()) {
-          ROS_ERROR_STREAM("Fail to open " << full_filename_oxts);
-          return 0;
-        }
-
-        std::stringstream buffer;
-        buffer << t.rdbuf();
-        std::string contents(buffer.str());
-
-        // Separate every line
-        tokenizer tok_line(contents, sep_line);
-        lines = std::vector<std::string>(tok_line.begin(), tok_line.end());
-
-        init_read = false;  // Dont repeat read
-      }
+    // Same cloud with every point moved to its position at the frame time
+    if (points_pub && need_deskew && entries_played < trajectory_.size()) {
+      kitti_utils::FrameProfiler::Timer timer(profiler_, kTimeDeskew);
+      if (!velo_cloud_deskewed_buffer_ || !velo_cloud_deskewed_buffer_.unique())
+        velo_cloud_deskewed_buffer_ = boost::make_shared<sensor_msgs::PointCloud2>();
+      if (deskewer_->Deskew(trajectory_, ros::Time(entries_played * kVeloScanPeriod), *points_pub, *velo_cloud_deskewed_buffer_))
+        velo_cloud_deskewed_pub_.publish(sensor_msgs::PointCloud2ConstPtr(velo_cloud_deskewed_buffer_));
+    }
+
+    // Same cloud with the label and instance of the tracklet box containing every point,
+    // the boxes are annotated on the raw scans
+    if (points_pub && need_labels) {
+      kitti_utils::FrameProfiler::Timer timer(profiler_, kTimeLabels);
+      labeller_->SetTracklets(dataset_->getTracklets(), entries_played);
+      labeller_->Label(*points_pub);
+      if (!velo_cloud_labelled_buffer_ || !velo_cloud_labelled_buffer_.unique())
+        velo_cloud_labelled_buffer_ = boost::make_shared<sensor_msgs::PointCloud2>();
+      labeller_->ToCloud(*points_pub, *velo_cloud_labelled_buffer_);
+      velo_cloud_labelled_buffer_->header = points_pub->header;
+      velo_cloud_labelled_pub_.publish(sensor_msgs::PointCloud2ConstPtr(velo_cloud_labelled_buffer_));
     }
 
-    //publish GPS data
-    if (options.gps || options.all_data) {
-      header_support.stamp = current_timestamp;  //ros::Time::now();
+    // Spherical projection of the scan, the images are copied into the messages
+    if (points_pub && need_range_image) {
+      kitti_utils::FrameProfiler::Timer timer(profiler_, kTimeRangeImage);
+      range_image_->Build(*points_pub);
+      cv_bridge::CvImage cv_bridge_img;
+      cv_bridge_img.header = points_pub->header;
+      auto publish = [&cv_bridge_img](image_transport::Publisher& pub, const cv::Mat& image, const string& encoding) {
+        if (pub.getNumSubscribers() == 0)
+          return;
+        cv_bridge_img.encoding = encoding;
+        cv_bridge_img.image = image;
+        pub.publish(cv_bridge_img.toImageMsg());
+      };
+      publish(range_image_pub_, range_image_->Range(), sensor_msgs::image_encodings::TYPE_32FC1);
+      publish(range_intensity_pub_, range_image_->Intensity(), sensor_msgs::image_encodings::TYPE_32FC1);
+      publish(range_xyz_pub_, range_image_->Xyz(), sensor_msgs::image_encodings::TYPE_32FC3);
+    }
 
-      if (!getGPS(lines, entries_played, &ros_msgGpsFix, &header_support)) {
-        ROS_ERROR_STREAM("Fail to open " << full_filename_oxts);
-        node.shutdown();
-        return -1;
+    // Local map in the world frame, built from the deskewed clouds when available
+    if (points_pub && voxel_map_ && entries_played < trajectory_.size()) {
+      kitti_utils::FrameProfiler::Timer timer(profiler_, kTimeMap);
+      const sensor_msgs::PointCloud2& scan = deskewer_ && velo_cloud_deskewed_buffer_ ? *velo_cloud_deskewed_buffer_ : *points_pub;
+      voxel_map_->Insert(scan, trajectory_.Pose(entries_played) * velo_to_imu_, entries_played);
+
+      if ((entries_played - options_.startFrame) % std::max(1u, options_.mapEvery) == 0 && velo_map_pub_.getNumSubscribers() > 0) {
+        if (!velo_map_buffer_ || !velo_map_buffer_.unique())
+          velo_map_buffer_ = boost::make_shared<sensor_msgs::PointCloud2>();
+        voxel_map_->ToCloud(*velo_map_buffer_);
+        velo_map_buffer_->header.frame_id = "world";
+        velo_map_buffer_->header.stamp = current_timestamp;
+        velo_map_pub_.publish(sensor_msgs::PointCloud2ConstPtr(velo_map_buffer_));
       }
+    }
+  }
 
-      if (firstGpsData) {
-        // this refs to BUG #551 - If a starting frame is specified, a wrong
-        // initial-gps-fix is taken. Fixing this issue forcing filename to
-        // 0000000001.txt
-        // The FULL dataset should be always downloaded.
-        if (!getGPS(lines, 1, &ros_msgGpsFix, &header_support)) {
-          ROS_ERROR_STREAM("Fail to open " << full_filename_oxts);
-          node.shutdown();
-          return -1;
-        }
-        ROS_DEBUG_STREAM("Setting initial GPS fix at " << endl
-                                                       << ros_msgGpsFix);
-        firstGpsData = false;
-        ros_msgGpsFixInitial = ros_msgGpsFix;
-        ros_msgGpsFixInitial.header.frame_id = "/local_map";
-        ros_msgGpsFixInitial.altitude = 0.0f;
-      }
+  //publish GPS data
+  const ros::WallTime oxts_start = ros::WallTime::now();
+  if (options_.gps || options_.all_data) {
+    header_support.stamp = current_timestamp;  //ros::Time::now();
 
-      gps_pub.publish(ros_msgGpsFix);
-      gps_pub_initial.publish(ros_msgGpsFixInitial);
+    if (!getGPS(oxts_, entries_played, &ros_msgGpsFix_, &header_support)) {
+      ROS_ERROR_STREAM("No oxts record for frame " << entries_played);
+      return false;
     }
 
-    if (options.imu || options.all_data) {
-      header_support.stamp = current_timestamp;  //ros::Time::now();
-
-      if (!getIMU(lines, entries_played, &ros_msgImu, &header_support)) {
-        ROS_ERROR_STREAM("Fail to open " << full_filename_oxts);
-        node.shutdown();
-        return -1;
+    if (firstGpsData_) {
+      // this refs to BUG #551 - If a starting frame is specified, a wrong
+      // initial-gps-fix is taken. Fixing this issue forcing filename to
+      // 0000000001.txt
+      // The FULL dataset should be always downloaded.
+      sensor_msgs::NavSatFix first_gps_fix;
+      if (!getGPS(oxts_, 1, &first_gps_fix, &header_support)) {
+        ROS_ERROR_STREAM("No oxts record for frame 1");
+        return false;
       }
-      imu_pub.publish(ros_msgImu);
+      ROS_DEBUG_STREAM("Setting initial GPS fix at " << endl
+                                                     << first_gps_fix);
+      firstGpsData_ = false;
+      ros_msgGpsFixInitial_ = first_gps_fix;
+      ros_msgGpsFixInitial_.header.frame_id = "/local_map";
+      ros_msgGpsFixInitial_.altitude = 0.0f;
     }
 
-    // Publish pose tf
-    header_support.stamp = current_timestamp;
-    publishPoseTF(ros_msgGpsFix, ros_msgImu, &header_support);
+    gps_pub_.publish(boost::make_shared<sensor_msgs::NavSatFix>(ros_msgGpsFix_));
+    gps_pub_initial_.publish(boost::make_shared<sensor_msgs::NavSatFix>(ros_msgGpsFixInitial_));
+  }
 
-    // Visualize cloud projection
-    showProjection(points_pub, cv_image02);
+  if (options_.imu || options_.all_data) {
+    header_support.stamp = current_timestamp;  //ros::Time::now();
 
-    ++progress;
-    entries_played++;
+    if (!getIMU(oxts_, entries_played, &ros_msgImu_, &header_support)) {
+      ROS_ERROR_STREAM("No oxts record for frame " << entries_played);
+      return false;
+    }
+    imu_pub_.publish(boost::make_shared<sensor_msgs::Imu>(ros_msgImu_));
+  }
+  if (options_.gps || options_.imu || options_.all_data)
+    profiler_.Record(kTimeOxts, (ros::WallTime::now() - oxts_start).toSec());
 
-    if (!options.synchMode)
-      loop_rate.sleep();
-  } while (entries_played <= total_entries - 1 && ros::ok());
-
-  if (options.viewer) {
-    ROS_INFO_STREAM(" Closing CV viewer(s)");
-    if (options.color || options.all_data)
-      cv::destroyWindow("CameraSimulator Color Viewer");
-    if (options.grayscale || options.all_data)
-      cv::destroyWindow("CameraSimulator Grayscale Viewer");
-    if (options.viewDisparities)
-      cv::destroyWindow("Reprojection of Detected Lines");
-    ROS_INFO_STREAM(" Closing CV viewer(s)... OK");
+  // Publish pose tf, only when the oxts records are loaded
+  if (entries_played < trajectory_.size() && stages_.Run(kPoseTF, tf_pub_.getNumSubscribers() > 0)) {
+    kitti_utils::FrameProfiler::Timer timer(profiler_, kTimePoseTF);
+    header_support.stamp = current_timestamp;
+    publishPoseTF(tf_pub_, trajectory_.Pose(entries_played), &header_support);
   }
 
-  ROS_INFO_STREAM("Done!");
-  node.shutdown();
+  // Visualization images, drawn on the low priority thread which copies the image
+  if (need_image && (need_overlay || need_label_image || need_projection || options_.viewer)) {
+    kitti_utils::FrameProfiler::Timer timer(profiler_, kTimeVizPost);
+    viz_worker_->Post(entries_played, current_timestamp, cv_image02_,
+                      need_overlay ? &object_states_->States() : NULL,
+                      need_overlay ? &object_states_->Corners() : NULL,
+                      need_label_image ? &labels : NULL,
+                      need_projection ? points_pub : sensor_msgs::PointCloud2ConstPtr());
+  }
 
-  return 0;
+  return true;
 }
+
+} // namespace kitti_tracking_player
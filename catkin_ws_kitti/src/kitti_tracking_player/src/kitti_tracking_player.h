@@ -0,0 +1,210 @@
+/*
+ * @Description: KITTI tracking dataset player, used by the standalone node and by the nodelet
+ * @References:
+ */
+#pragma once
+
+// C++
+#include <atomic>
+#include <string>
+#include <vector>
+// ROS
+#include <cv_bridge/cv_bridge.h>
+#include <image_transport/image_transport.h>
+#include <ros/ros.h>
+#include <sensor_msgs/CameraInfo.h>
+#include <sensor_msgs/Imu.h>
+#include <sensor_msgs/NavSatFix.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <visualization_msgs/MarkerArray.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <kitti_common/frame_profiler.h>
+#include <kitti_common/image_decode_pool.h>
+#include <kitti_common/oxts_table.h>
+#include <kitti_common/trajectory.h>
+
+#include "KittiDataset.h"
+#include "cloud_deskewer.h"
+#include "kitti_track_label.h"
+#include "kitti_utils.h"
+#include "object_state.h"
+#include "playback_controller.h"
+#include "range_image.h"
+#include "stage_counter.h"
+#include "tracklet_labeller.h"
+#include "viz_worker.h"
+#include "voxel_map.h"
+
+namespace kitti_tracking_player {
+
+struct kitti_player_options {
+  std::string path;
+  std::string sequence;      // sequence to play, e.g. 0000
+  float frequency;           // publisher frequency. 1 > Kitti default 10Hz
+  bool all_data;             // publish everything
+  bool velodyne;             // publish velodyne point clouds /as PCL
+  bool gps;                  // publish GPS sensor_msgs/NavSatFix    message
+  bool imu;                  // publish IMU sensor_msgs/Imu Message  message
+  bool grayscale;            // publish
+  bool color;                // publish
+  bool viewer;               // enable CV viewer
+  bool timestamps;           // use KITTI timestamps;
+  bool sendTransform;        // publish velodyne TF IMU 3DOF orientation wrt fixed frame
+  bool stereoDisp;           // use precalculated stereoDisparities
+  bool viewDisparities;      // view use precalculated stereoDisparities
+  bool synchMode;            // start with synchMode on (wait for message to send next frame)
+  unsigned int startFrame;   // start the replay at frame ...
+  std::string gpsReferenceFrame;  // publish GPS points into RVIZ as RVIZ Markers
+  std::string playbackMode;  // realtime, max or adaptive
+  unsigned int ackWindow;    // adaptive mode: max number of published frames not yet acknowledged
+  unsigned int decodeThreads;  // number of threads decoding the images of the next frames
+  std::string imageCache;    // directory of the decoded image cache files, empty to disable
+  bool deskew;               // publish the motion compensated velodyne clouds too
+  bool accumulate;           // publish a voxel map of the last scans in the world frame
+  float voxelSize;           // edge of the map voxels (m)
+  unsigned int mapAge;       // frames a map voxel is kept without being hit
+  unsigned int mapEvery;     // publish the map every N frames
+  bool labels;               // publish the velodyne clouds with the tracklet label and instance of every point
+  bool rangeImage;           // publish the range, intensity and xyz images of the spherical projection of the scans
+};
+
+/**
+ * @brief Parse the player command line options (without the program name)
+ * @return 0 if the player can be started, 1 if only the help was requested, -1 on parse errors
+ *
+ * Allowed options:
+ *   -h [ --help ]                       help message
+ *   -d [ --directory  ] arg             *required* - path to the kitti dataset Directory
+ *   -s [ --sequence   ] arg             *required* - sequence to play, e.g. 0000
+ *   -f [ --frequency  ] arg (=1)        set replay Frequency
+ *   -a [ --all        ] [=arg(=1)] (=0) replay All data
+ *   -v [ --velodyne   ] [=arg(=1)] (=0) replay Velodyne data
+ *   -g [ --gps        ] [=arg(=1)] (=0) replay Gps data
+ *   -i [ --imu        ] [=arg(=1)] (=0) replay Imu data
+ *   -C [ --color      ] [=arg(=1)] (=0) replay Stereo Color images
+ *   -V [ --viewer     ] [=arg(=1)] (=0) enable image viewer
+ *   -F [ --frame      ] [=arg(=0)] (=0) start playing at frame ...
+ *   -p [ --gpsPoints  ] arg             publish GPS/RTK markers to RVIZ
+ *   -S [ --synchMode  ] [=arg(=1)] (=0) wait for signal to load next frame
+ *   -M [ --mode       ] arg (=realtime) playback mode: realtime, max or adaptive
+ *   -W [ --window     ] arg (=2)        adaptive mode in-flight window
+ *   -j [ --decodeThreads ] arg (=2)     number of image decoding threads
+ *   -c [ --cache      ] arg             directory of the decoded image cache
+ *   -k [ --deskew     ] [=arg(=1)] (=0) publish motion compensated clouds on velo/pointcloud_deskewed
+ *   -A [ --accumulate ] [=arg(=1)] (=0) publish the last scans in the world frame on velo/map
+ *   --voxelSize arg (=0.2)              map voxel size (m)
+ *   --mapAge arg (=50)                  frames a map voxel is kept without being hit
+ *   --mapEvery arg (=10)                publish the map every N frames
+ *   -l [ --labels     ] [=arg(=1)] (=0) publish clouds with per point label and instance on velo/pointcloud_labelled
+ *   -R [ --rangeImage ] [=arg(=1)] (=0) publish the 64 x 2048 range images on velo/range_image/{range,intensity,xyz}
+ */
+int ParseOptions(const std::vector<std::string>& args, kitti_player_options& options);
+
+/**
+ * @brief Player for the KITTI tracking dataset.
+ *        All messages are published as shared pointers, so that subscribers living in the same
+ *        process (nodelets) receive them without serialization.
+ */
+class KittiTrackingPlayer {
+public:
+  /**
+   * @param node Node handle used to advertise the topics, e.g. in namespace "kitti"
+   */
+  KittiTrackingPlayer(const ros::NodeHandle& node, const kitti_player_options& options);
+  virtual ~KittiTrackingPlayer();
+
+  /**
+   * @brief Check the dataset directories, load calibration, labels and oxts data
+   * @return false if the dataset can not be played
+   */
+  bool Init();
+
+  /**
+   * @brief Play the sequence until its end, Stop() or ROS shutdown
+   * @return 0 at the end of the dataset, -1 if errors
+   */
+  int Run();
+
+  /// Make Run() return as soon as possible, can be called from any thread
+  void Stop();
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+private:
+  /// Publish all enabled data of one frame, false on read errors
+  bool PlayFrame(unsigned int frame, const ros::Time& current_timestamp);
+
+  /// Publish the visualization images and the bounding boxes, called on the visualization thread
+  void PublishViz(const kitti_utils::VizWorker::Frame& frame, const kitti_utils::VizWorker::Output& output);
+
+  kitti_player_options options_;
+  ros::NodeHandle node_;
+  kitti_utils::PlaybackController playback_;
+  kitti_utils::StageCounter stages_;
+  kitti_utils::FrameProfiler profiler_;
+  std::atomic<bool> stopped_;
+
+  // Dataset content
+  std::string dir_image02_;
+  std::string dir_label02_;
+  std::string dir_oxts_;
+  std::string dir_calib_;
+  std::string dir_velodyne_points_;
+  unsigned int total_entries_;
+  kitti_utils::Calibration calib_params_;
+  boost::shared_ptr<KittiDataset> dataset_;
+  boost::shared_ptr<KittiTrackLabel> kitti_track_label_;
+  boost::shared_ptr<kitti_utils::ImageDecodePool> decode_pool_;
+  kitti_utils::OxtsTable oxts_;
+  kitti_utils::Trajectory trajectory_;
+  Eigen::Isometry3d velo_to_imu_;  // inverse of Tr_imu_velo, computed once in Init()
+  boost::shared_ptr<kitti_utils::CloudDeskewer> deskewer_;
+  boost::shared_ptr<kitti_utils::VoxelMap> voxel_map_;
+  boost::shared_ptr<kitti_utils::TrackletLabeller> labeller_;
+  boost::shared_ptr<kitti_utils::RangeImageBuilder> range_image_;
+  boost::shared_ptr<kitti_utils::ObjectStateBuilder> object_states_;
+  boost::shared_ptr<kitti_utils::VizWorker> viz_worker_;
+
+  // ROS publishers and subscribers
+  image_transport::ImageTransport it_;
+  image_transport::CameraPublisher pub02_;
+  image_transport::Publisher image_boxes_pub_;
+  image_transport::Publisher image_labels_pub_;
+  image_transport::Publisher image_projection_pub_;
+  image_transport::Publisher range_image_pub_;
+  image_transport::Publisher range_intensity_pub_;
+  image_transport::Publisher range_xyz_pub_;
+  ros::Publisher bounding_boxes_pub_;
+  ros::Publisher velo_cloud_pub_;
+  ros::Publisher velo_cloud_deskewed_pub_;
+  ros::Publisher velo_map_pub_;
+  ros::Publisher velo_cloud_labelled_pub_;
+  ros::Publisher gps_pub_;
+  ros::Publisher gps_pub_initial_;
+  ros::Publisher imu_pub_;
+  ros::Publisher raw_image_with_bboxes_pub_;
+  ros::Publisher vis_marker_pub_;
+  ros::Publisher object_array_pub_;
+  ros::Publisher tf_pub_;
+  ros::Publisher diagnostics_pub_;
+  ros::Subscriber synch_sub_;
+  ros::Subscriber credits_sub_;
+  ros::Subscriber ack_sub_;
+
+  // State kept between frames
+  cv::Mat cv_image02_;
+  sensor_msgs::CameraInfo ros_cameraInfoMsg_camera02_;
+  sensor_msgs::PointCloud2Ptr velo_cloud_buffer_;
+  sensor_msgs::PointCloud2Ptr velo_cloud_deskewed_buffer_;
+  sensor_msgs::PointCloud2Ptr velo_map_buffer_;
+  sensor_msgs::PointCloud2Ptr velo_cloud_labelled_buffer_;
+  visualization_msgs::MarkerArrayPtr markers_buffer_;
+  sensor_msgs::NavSatFix ros_msgGpsFix_;
+  sensor_msgs::NavSatFix ros_msgGpsFixInitial_;  // This message contains the first reading of the file
+  bool firstGpsData_;                            // Flag to store the ros_msgGpsFixInitial message
+  sensor_msgs::Imu ros_msgImu_;
+};
+
+} // namespace kitti_tracking_player
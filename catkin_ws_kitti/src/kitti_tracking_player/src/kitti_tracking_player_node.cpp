@@ -0,0 +1,34 @@
+/*
+ * @Description: Standalone node of the KITTI tracking dataset player
+ * @References:
+ */
+
+#include <ros/ros.h>
+
+#include "kitti_tracking_player.h"
+
+int main(int argc, char** argv) {
+  kitti_tracking_player::kitti_player_options options;
+  int ret = kitti_tracking_player::ParseOptions(std::vector<std::string>(argv + 1, argv + argc), options);
+  if (ret != 0)
+    return ret > 0 ? 0 : -1;
+
+  ros::init(argc, argv, "kitti_tracking_player");
+  ros::NodeHandle node("kitti");
+
+  /// This sets the logger level; use this to disable all ROS prints
+  if (ros::console::set_logger_level(ROSCONSOLE_DEFAULT_NAME, ros::console::levels::Info))
+    ros::console::notifyLoggerLevelsChanged();
+  else
+    std::cout << "Error while setting the logger level!" << std::endl;
+
+  kitti_tracking_player::KittiTrackingPlayer player(node, options);
+
+  // Synch and acknowledge callbacks must run while the player thread is waiting
+  ros::AsyncSpinner spinner(1);
+  spinner.start();
+
+  if (!player.Init())
+    return -1;
+  return player.Run();
+}
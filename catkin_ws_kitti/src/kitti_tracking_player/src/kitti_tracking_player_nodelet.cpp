@@ -0,0 +1,57 @@
+/*
+ * @Description: Nodelet of the KITTI tracking dataset player, consumers loaded in the same manager
+ *               receive the published messages without serialization
+ * @References:
+ */
+
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+
+#include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "kitti_tracking_player.h"
+
+namespace kitti_tracking_player {
+
+class KittiTrackingPlayerNodelet : public nodelet::Nodelet {
+public:
+  KittiTrackingPlayerNodelet() {}
+
+  ~KittiTrackingPlayerNodelet() {
+    if (player_) {
+      player_->Stop();
+    }
+    if (play_thread_.joinable()) {
+      play_thread_.join();
+    }
+  }
+
+private:
+  virtual void onInit() {
+    // Same options as the standalone node, given in the launch file with args="load ... -- -d ..."
+    kitti_player_options options;
+    if (ParseOptions(getMyArgv(), options) != 0) {
+      NODELET_ERROR("Invalid kitti_tracking_player arguments, nothing will be played");
+      return;
+    }
+
+    player_.reset(new KittiTrackingPlayer(ros::NodeHandle(getNodeHandle(), "kitti"), options));
+    // onInit must return quickly, the player loop runs in its own thread while the
+    // manager threads serve the synch and acknowledge callbacks
+    play_thread_ = boost::thread(&KittiTrackingPlayerNodelet::Play, this);
+  }
+
+  void Play() {
+    if (!player_->Init())
+      return;
+    player_->Run();
+  }
+
+  boost::shared_ptr<KittiTrackingPlayer> player_;
+  boost::thread play_thread_;
+};
+
+} // namespace kitti_tracking_player
+
+PLUGINLIB_EXPORT_CLASS(kitti_tracking_player::KittiTrackingPlayerNodelet, nodelet::Nodelet)
@@ -9,8 +9,12 @@
 
 #include "kitti_utils.h"
 
+#include <algorithm>
+#include <cstdio>
 #include <fstream>
 
+#include <kitti_common/cloud_utils.h>
+
 #include "utils/string_utils.h"
 
 namespace kitti_utils {
@@ -18,6 +22,100 @@ namespace kitti_utils {
 using std::cout;
 using std::endl;
 
+static_assert(sizeof(VeloPoint) == 4 * sizeof(float), "VeloPoint must match the velodyne .bin layout");
+
+namespace {
+/// Points read and converted at once by the transforming reader, 64 KB
+const size_t kReadChunkPoints = 4096;
+}
+
+bool ReadVeloPoints(const std::string& velo_bin_path, sensor_msgs::PointCloud2& point_cloud) {
+  FILE* input = std::fopen(velo_bin_path.c_str(), "rb");
+  if (input == NULL) {
+    cout<<"[ReadVeloPoints] Could not read file: "<<velo_bin_path<<endl;
+    return false;
+  }
+  std::fseek(input, 0, SEEK_END);
+  long file_size = std::ftell(input);
+  std::fseek(input, 0, SEEK_SET);
+
+  size_t num_points = file_size > 0 ? file_size / sizeof(VeloPoint) : 0;
+  point_cloud.data.resize(num_points * sizeof(VeloPoint));
+  size_t num_read = std::fread(point_cloud.data.data(), sizeof(VeloPoint), num_points, input);
+  std::fclose(input);
+  if (num_read != num_points) {
+    cout<<"[ReadVeloPoints] Truncated file: "<<velo_bin_path<<endl;
+    point_cloud.data.resize(num_read * sizeof(VeloPoint));
+  }
+
+  // Fields only need to be set once when the message is reused
+  if (point_cloud.fields.size() != 4) {
+    const char* names[4] = {"x", "y", "z", "intensity"};
+    point_cloud.fields.resize(4);
+    for (int i = 0; i < 4; ++i) {
+      point_cloud.fields[i].name = names[i];
+      point_cloud.fields[i].offset = i * sizeof(float);
+      point_cloud.fields[i].datatype = sensor_msgs::PointField::FLOAT32;
+      point_cloud.fields[i].count = 1;
+    }
+  }
+  point_cloud.height = 1;
+  point_cloud.width = num_read;
+  point_cloud.point_step = sizeof(VeloPoint);
+  point_cloud.row_step = point_cloud.point_step * point_cloud.width;
+  point_cloud.is_bigendian = false;
+  point_cloud.is_dense = true;
+  return true;
+}
+
+bool ReadVeloPoints(const std::string& velo_bin_path, const Eigen::Affine3f& transform, KittiPointCloud& point_cloud) {
+  FILE* input = std::fopen(velo_bin_path.c_str(), "rb");
+  if (input == NULL) {
+    cout<<"[ReadVeloPoints] Could not read file: "<<velo_bin_path<<endl;
+    return false;
+  }
+  std::fseek(input, 0, SEEK_END);
+  long file_size = std::ftell(input);
+  std::fseek(input, 0, SEEK_SET);
+  size_t num_points = file_size > 0 ? file_size / sizeof(VeloPoint) : 0;
+  point_cloud.points.resize(num_points);
+
+  // (x', y', z', 1) = A * (x, y, z, intensity) + b, a 4x4 product Eigen maps to SIMD registers
+  Eigen::Matrix4f A = Eigen::Matrix4f::Zero();
+  A.topLeftCorner<3, 3>() = transform.linear();
+  Eigen::Vector4f b;
+  b << transform.translation(), 1.0f;
+
+  // The file is streamed through a small buffer and converted right into the points of the cloud
+  VeloPoint chunk[kReadChunkPoints];
+  size_t num_read = 0;
+  while (num_read < num_points) {
+    size_t count = std::fread(chunk, sizeof(VeloPoint), std::min(kReadChunkPoints, num_points - num_read), input);
+    if (count == 0) {
+      break;
+    }
+    KittiPoint* out = &point_cloud.points[num_read];
+    for (size_t i = 0; i < count; ++i) {
+      out[i].getVector4fMap() = A * Eigen::Map<const Eigen::Vector4f>(&chunk[i].x) + b;
+      out[i].intensity = chunk[i].intensity;
+    }
+    num_read += count;
+  }
+  std::fclose(input);
+  if (num_read != num_points) {
+    cout<<"[ReadVeloPoints] Truncated file: "<<velo_bin_path<<endl;
+    point_cloud.points.resize(num_read);
+  }
+  point_cloud.width = num_read;
+  point_cloud.height = 1;
+  point_cloud.is_dense = true;
+  return true;
+}
+
+bool TransformKittiCloud(const std::string& velo_bin_path, KittiPointCloud& kitti_cloud, bool do_z_shift, float z_shift_value) {
+  return ReadVeloPoints(velo_bin_path, GetKittiCloudTransform(do_z_shift, z_shift_value), kitti_cloud);
+}
+
 Calibration::Calibration(const std::string& calib_file_path) {
   LoadFile2Map(calib_file_path);
   
@@ -30,6 +128,10 @@ Calibration::Calibration(const std::string& calib_file_path) {
 	auto Velo2Cam_temp = calib_params_["Tr_velo_cam"];
 	Velo2Cam_ = Eigen::Map<const Eigen::Matrix<float, 3, 4, Eigen::RowMajor> >(Velo2Cam_temp.data());
 
+	auto Imu2Velo_temp = calib_params_.find("Tr_imu_velo");
+	if (Imu2Velo_temp != calib_params_.end() && Imu2Velo_temp->second.size() == 12)
+		Imu2Velo_ = Eigen::Map<const Eigen::Matrix<float, 3, 4, Eigen::RowMajor> >(Imu2Velo_temp->second.data());
+
   cout<<"P2 = "<<P2_<<endl;
   cout<<"R_Rect_0 = "<<R_Rect_0_<<endl;
   cout<<"Velo2Cam = "<<Velo2Cam_<<endl;
@@ -53,11 +155,11 @@ void Calibration::LoadFile2Map(const std::string& calib_file_path) {
 }
 
 Eigen::MatrixXf Calibration::Cartesian2Homogenous(const Eigen::MatrixXf& pts_3d) {
-  if (pts_3d.size() == 4) {
+  if (pts_3d.rows() == 4) {
     return pts_3d;
   }
   Eigen::MatrixXf temp = Eigen::MatrixXf::Ones(1, pts_3d.cols());
-  Eigen::MatrixXf ret;
+  Eigen::MatrixXf ret(pts_3d.rows() + 1, pts_3d.cols());
   ret << pts_3d,
                temp;
   return ret;
@@ -16,6 +16,8 @@
 // PCL
 #include <pcl/point_cloud.h>
 #include <pcl/point_types.h>
+// ROS
+#include <sensor_msgs/PointCloud2.h>
 
 #include <Eigen/Dense>
 
@@ -25,6 +27,17 @@ typedef KittiPointCloud::Ptr KittiPointCloudPtr;
 
 namespace kitti_utils {
 
+/**
+ * @brief One point as stored in velodyne .bin files, 16 bytes without padding.
+ *        This is also the wire layout of the clouds filled by ReadVeloPoints(path, PointCloud2)
+ */
+struct VeloPoint {
+  float x;
+  float y;
+  float z;
+  float intensity;
+};
+
 /**
  * @brief This function will find all files in specified directories, including hidden files
  *                Assume no subdirectory in dir_name folder
@@ -70,6 +83,38 @@ inline bool ReadVeloPoints(const std::string& velo_bin_path, KittiPointCloud& po
   }
 }
 
+/**
+ * @brief Read a velodyne .bin file directly into a PointCloud2 with float32 fields x, y, z, intensity
+ *        and 16 bytes point step, the file content is copied as is into the data buffer.
+ *        The data buffer of point_cloud is reused, so keep the message alive between frames to avoid allocations.
+ */
+bool ReadVeloPoints(const std::string& velo_bin_path, sensor_msgs::PointCloud2& point_cloud);
+
+/**
+ * @brief Read a velodyne .bin file into point_cloud, applying the rigid transform to x, y, z while the floats
+ *        are converted, in one pass over the file without intermediate cloud. point_cloud is replaced, not
+ *        appended to, and its points are reused, so keep the cloud alive between frames to avoid allocations.
+ */
+bool ReadVeloPoints(const std::string& velo_bin_path, const Eigen::Affine3f& transform, KittiPointCloud& point_cloud);
+
+/**
+ * @brief Read a velodyne .bin file already rotated by GetKittiCloudTransform (kitti_common/cloud_utils.h), in one
+ *        pass with ReadVeloPoints. The points of kitti_cloud are reused, keep it alive between frames.
+ */
+bool TransformKittiCloud(const std::string& velo_bin_path, KittiPointCloud& kitti_cloud,
+                         bool do_z_shift = false, float z_shift_value = 1.73);
+
+/**
+ * @brief Access the points of a cloud filled by ReadVeloPoints(path, PointCloud2)
+ */
+inline const VeloPoint* GetVeloPoints(const sensor_msgs::PointCloud2& point_cloud) {
+  return reinterpret_cast<const VeloPoint*>(point_cloud.data.data());
+}
+
+inline size_t GetVeloPointsSize(const sensor_msgs::PointCloud2& point_cloud) {
+  return point_cloud.data.size() / sizeof(VeloPoint);
+}
+
 /**
  * @brief KITTI Tracking dataset calibration parameters manage class
  */ 
@@ -87,6 +132,9 @@ public:
 
   Eigen::MatrixXf Velo2Cam() const { return Velo2Cam_; }
 
+  /// 3x4 from oxts-unit to velodyne coordinates (Tr_imu_velo), empty if not in the file
+  Eigen::MatrixXf Imu2Velo() const { return Imu2Velo_; }
+
   /**
    * @brief Get the 3x4 from 3d velodyne coordinate to 2d image coodinates transformation matrix
    */ 
@@ -115,6 +163,7 @@ protected:
   Eigen::MatrixXf P0_, P1_, P2_, P3_;
   Eigen::MatrixXf R_Rect_0_;
   Eigen::MatrixXf Velo2Cam_, Cam2Velo_;
+  Eigen::MatrixXf Imu2Velo_;
 };
 
 } // namespace kitti_utils
\ No newline at end of file
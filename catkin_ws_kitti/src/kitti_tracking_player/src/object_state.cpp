@@ -0,0 +1,157 @@
+/*
+ * @Description: Geometry and attributes of all the tracklets of a frame, computed in one batch
+ * @References:
+ */
+
+#include "object_state.h"
+
+#include <cmath>
+
+namespace kitti_utils {
+
+namespace {
+/// Corners of the unit box with the bottom center at the origin, see ObjectStateBuilder::Corners()
+Eigen::Matrix<float, 3, 8> UnitBoxCorners() {
+  Eigen::Matrix<float, 3, 8> corners;
+  corners << 0.5f, -0.5f, -0.5f,  0.5f, 0.5f, -0.5f, -0.5f,  0.5f,
+             0.5f,  0.5f, -0.5f, -0.5f, 0.5f,  0.5f, -0.5f, -0.5f,
+             0.0f,  0.0f,  0.0f,  0.0f, 1.0f,  1.0f,  1.0f,  1.0f;
+  return corners;
+}
+}
+
+ObjectStateBuilder::ObjectStateBuilder(double frame_period)
+    : frame_period_(frame_period > 0.0 ? frame_period : 0.1),
+      has_calibration_(false),
+      velo_to_cam_(Eigen::Affine3f::Identity()),
+      trajectory_(NULL),
+      velo_to_imu_(Eigen::Isometry3d::Identity()) {
+}
+
+void ObjectStateBuilder::SetCalibration(const Calibration& calib) {
+  Eigen::MatrixXf velo_to_ref = calib.Velo2Cam();
+  Eigen::MatrixXf rect = calib.R_Rect_0();
+  has_calibration_ = velo_to_ref.rows() == 3 && velo_to_ref.cols() == 4 && rect.rows() == 3 && rect.cols() == 3;
+  if (!has_calibration_) {
+    return;
+  }
+  Eigen::Affine3f velo_to_cam = Eigen::Affine3f::Identity();
+  velo_to_cam.matrix().topRows<3>() = velo_to_ref;
+  Eigen::Affine3f ref_to_rect = Eigen::Affine3f::Identity();
+  ref_to_rect.linear() = rect;
+  velo_to_cam_ = ref_to_rect * velo_to_cam;
+}
+
+void ObjectStateBuilder::SetTrajectory(const Trajectory* trajectory, const Eigen::Isometry3d& imu_to_velo) {
+  trajectory_ = trajectory;
+  velo_to_imu_ = imu_to_velo.inverse();
+}
+
+bool ObjectStateBuilder::VeloToWorld(int frame, Eigen::Isometry3d* velo_to_world) const {
+  if (!trajectory_ || frame < 0 || frame >= static_cast<int>(trajectory_->size())) {
+    return false;
+  }
+  *velo_to_world = trajectory_->Pose(frame) * velo_to_imu_;
+  return true;
+}
+
+void ObjectStateBuilder::Build(Tracklets& tracklets, int frame) {
+  states_.clear();
+  steps_.clear();
+  const int num_tracklets = tracklets.numberOfTracklets();
+  velo_positions_.resize(3, num_tracklets);
+  previous_positions_.resize(3, num_tracklets);
+  next_positions_.resize(3, num_tracklets);
+
+  // Velodyne frame state, and the positions at the neighbour frames when the tracklet is active there
+  std::vector<int> has_previous, has_next;
+  for (int id = 0; id < num_tracklets; ++id) {
+    Tracklets::tPose* pose;
+    if (!tracklets.getPose(id, frame, pose)) {
+      continue;
+    }
+    const KittiTracklet* tracklet = tracklets.getTracklet(id);
+    const int i = states_.size();
+    ObjectState state;
+    state.id = id;
+    state.label = KittiDataset::getLabel(tracklet->objectType.c_str());
+    state.class_name = tracklet->objectType;
+    state.length = tracklet->l;
+    state.width = tracklet->w;
+    state.height = tracklet->h;
+    state.velo_position = Eigen::Vector3f(pose->tx, pose->ty, pose->tz);
+    state.velo_yaw = pose->rz;
+    state.cam_position.setZero();
+    state.has_world = false;
+    state.world_position.setZero();
+    state.world_yaw = 0.0;
+    state.world_velocity.setZero();
+    state.speed = 0.0f;
+    states_.push_back(state);
+
+    velo_positions_.col(i) = state.velo_position;
+    Tracklets::tPose* neighbour = NULL;
+    has_previous.push_back(tracklets.getPose(id, frame - 1, neighbour));
+    previous_positions_.col(i) = has_previous.back() ? Eigen::Vector3f(neighbour->tx, neighbour->ty, neighbour->tz)
+                                                     : state.velo_position;
+    has_next.push_back(tracklets.getPose(id, frame + 1, neighbour));
+    next_positions_.col(i) = has_next.back() ? Eigen::Vector3f(neighbour->tx, neighbour->ty, neighbour->tz)
+                                             : state.velo_position;
+    steps_.push_back(has_previous.back() + has_next.back());
+  }
+  const int num_objects = states_.size();
+  velo_positions_.conservativeResize(3, num_objects);
+  previous_positions_.conservativeResize(3, num_objects);
+  next_positions_.conservativeResize(3, num_objects);
+
+  // Corners, rotated around z and translated to the bottom center
+  static const Eigen::Matrix<float, 3, 8> unit_corners = UnitBoxCorners();
+  corners_.resize(3, 8 * num_objects);
+  for (int i = 0; i < num_objects; ++i) {
+    const ObjectState& state = states_[i];
+    Eigen::Matrix3f rotation_scale = Eigen::AngleAxisf(state.velo_yaw, Eigen::Vector3f::UnitZ()).toRotationMatrix() *
+                                     Eigen::Vector3f(state.length, state.width, state.height).asDiagonal();
+    corners_.middleCols<8>(8 * i) = (rotation_scale * unit_corners).colwise() + state.velo_position;
+  }
+
+  if (has_calibration_ && num_objects > 0) {
+    Eigen::Matrix3Xf cam_positions = (velo_to_cam_.linear() * velo_positions_).colwise() + velo_to_cam_.translation();
+    for (int i = 0; i < num_objects; ++i) {
+      states_[i].cam_position = cam_positions.col(i);
+    }
+  }
+
+  // World frame, the neighbour positions are transformed with the pose of their own frame
+  Eigen::Isometry3d to_world, previous_to_world, next_to_world;
+  const bool has_world = VeloToWorld(frame, &to_world);
+  const bool has_previous_world = VeloToWorld(frame - 1, &previous_to_world);
+  const bool has_next_world = VeloToWorld(frame + 1, &next_to_world);
+  if (has_world && num_objects > 0) {
+    Eigen::Matrix3Xd world = to_world * velo_positions_.cast<double>();
+    Eigen::Matrix3Xd previous_world = has_previous_world ? previous_to_world * previous_positions_.cast<double>() : world;
+    Eigen::Matrix3Xd next_world = has_next_world ? next_to_world * next_positions_.cast<double>() : world;
+    for (int i = 0; i < num_objects; ++i) {
+      ObjectState& state = states_[i];
+      state.has_world = true;
+      state.world_position = world.col(i);
+      Eigen::Vector3d heading = to_world.linear() * Eigen::Vector3d(std::cos(state.velo_yaw), std::sin(state.velo_yaw), 0.0);
+      state.world_yaw = std::atan2(heading.y(), heading.x());
+      const Eigen::Vector3d previous = has_previous[i] && has_previous_world ? previous_world.col(i) : world.col(i);
+      const Eigen::Vector3d next = has_next[i] && has_next_world ? next_world.col(i) : world.col(i);
+      const int steps = (has_previous[i] && has_previous_world) + (has_next[i] && has_next_world);
+      if (steps > 0) {
+        state.world_velocity = (next - previous) / (steps * frame_period_);
+      }
+      state.speed = state.world_velocity.norm();
+    }
+  } else {
+    // Velocity relative to the ego vehicle
+    for (int i = 0; i < num_objects; ++i) {
+      if (steps_[i] > 0) {
+        states_[i].speed = (next_positions_.col(i) - previous_positions_.col(i)).norm() / (steps_[i] * frame_period_);
+      }
+    }
+  }
+}
+
+} // namespace kitti_utils
@@ -0,0 +1,93 @@
+/*
+ * @Description: Geometry and attributes of all the tracklets of a frame, computed in one batch
+ * @References:
+ */
+#pragma once
+
+// C++
+#include <string>
+#include <vector>
+// Eigen
+#include <Eigen/Geometry>
+
+#include <kitti_common/trajectory.h>
+
+#include "KittiDataset.h"
+#include "kitti_utils.h"
+
+namespace kitti_utils {
+
+/// State of one tracklet at a frame
+struct ObjectState {
+  int id;                          // tracklet id
+  int label;                       // KittiDataset::getLabel()
+  std::string class_name;          // tracklet object type
+  float length, width, height;     // box size (m)
+  Eigen::Vector3f velo_position;   // bottom center in the velodyne frame (m)
+  float velo_yaw;                  // heading in the velodyne frame (rad)
+  Eigen::Vector3f cam_position;    // bottom center in the rectified camera frame (m), zero without calibration
+  bool has_world;                  // world pose and velocity are valid, needs the trajectory
+  Eigen::Vector3d world_position;  // bottom center in the world frame (m)
+  double world_yaw;                // heading in the world frame (rad)
+  Eigen::Vector3d world_velocity;  // finite difference of the world positions at the neighbour frames (m/s)
+  float speed;                     // norm of world_velocity, of the velodyne frame velocity without trajectory
+};
+
+/**
+ * @brief Build the state of all the tracklets active at a frame: box corners, camera frame position,
+ *        world frame pose from the ego trajectory and velocity from the neighbour frames.
+ *        Positions of all the objects are transformed together, one matrix product per frame
+ *        and per transform, and the results are kept in buffers reused between frames.
+ *
+ *          builder.SetCalibration(calib);
+ *          builder.SetTrajectory(&trajectory, imu_to_velo);
+ *          builder.Build(tracklets, frame);
+ *          builder.States() ... builder.Corners()
+ */
+class ObjectStateBuilder {
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  /// @param frame_period time between two frames (s)
+  explicit ObjectStateBuilder(double frame_period = 0.1);
+
+  /// Velodyne to rectified camera transformation, R_rect * Tr_velo_cam
+  void SetCalibration(const Calibration& calib);
+
+  /**
+   * @brief Ego poses used for the world frame states, not owned
+   * @param imu_to_velo extrinsics from the oxts-unit to the velodyne
+   */
+  void SetTrajectory(const Trajectory* trajectory, const Eigen::Isometry3d& imu_to_velo);
+
+  /// Compute the states of the tracklets active at frame
+  void Build(Tracklets& tracklets, int frame);
+
+  size_t size() const { return states_.size(); }
+  const std::vector<ObjectState>& States() const { return states_; }
+
+  /**
+   * @brief Box corners in the velodyne frame, 8 columns per object in the order of States():
+   *        bottom face then top face, each front left, rear left, rear right, front right
+   */
+  const Eigen::Matrix3Xf& Corners() const { return corners_; }
+
+private:
+  /// Velodyne to world transformation at frame, false outside the trajectory
+  bool VeloToWorld(int frame, Eigen::Isometry3d* velo_to_world) const;
+
+  double frame_period_;
+  bool has_calibration_;
+  Eigen::Affine3f velo_to_cam_;
+  const Trajectory* trajectory_;
+  Eigen::Isometry3d velo_to_imu_;
+
+  std::vector<ObjectState> states_;
+  Eigen::Matrix3Xf corners_;
+  Eigen::Matrix3Xf velo_positions_;     // 3 x N, current frame
+  Eigen::Matrix3Xf previous_positions_;  // 3 x N, at the previous frame (or current if none)
+  Eigen::Matrix3Xf next_positions_;      // 3 x N, at the next frame (or current if none)
+  std::vector<int> steps_;               // number of frames between previous and next, per object
+};
+
+} // namespace kitti_utils
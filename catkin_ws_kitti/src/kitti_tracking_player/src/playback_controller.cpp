@@ -0,0 +1,181 @@
+/*
+ * @Description: Pacing of the player main loop, decides when the next frame can be published
+ * @References:
+ */
+
+#include "playback_controller.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace kitti_utils {
+
+namespace {
+// Upper bound of a single condition variable wait, so that ros::ok() is polled regularly
+const std::chrono::milliseconds kMaxWaitSlice(100);
+}
+
+bool ParsePlaybackMode(const std::string& name, PlaybackMode* mode) {
+  if (name == "realtime") {
+    *mode = PlaybackMode::kRealtime;
+  } else if (name == "max") {
+    *mode = PlaybackMode::kMaxThroughput;
+  } else if (name == "adaptive") {
+    *mode = PlaybackMode::kAdaptive;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+PlaybackController::PlaybackController(PlaybackMode mode, double frequency, unsigned int window, bool synch_mode)
+    : mode_(mode),
+      window_(window > 0 ? window : 1),
+      synch_mode_(synch_mode),
+      rate_(frequency),
+      credits_(0),
+      stopped_(false),
+      ack_timeout_(1.0),
+      frames_published_(0),
+      frames_acked_(0),
+      frames_lost_(0),
+      ack_latency_sum_(0.0),
+      ack_latency_max_(0.0) {
+}
+
+bool PlaybackController::WaitForNextFrame() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (frames_published_ == 0) {
+    return ros::ok() && !stopped_;
+  }
+
+  if (synch_mode_) {
+    // Downstream nodes decide the pace, no additional sleep
+    return WaitForCredit(lock);
+  }
+
+  switch (mode_) {
+    case PlaybackMode::kRealtime:
+      lock.unlock();
+      rate_.sleep();
+      lock.lock();
+      break;
+    case PlaybackMode::kMaxThroughput:
+      break;
+    case PlaybackMode::kAdaptive:
+      return WaitForWindow(lock);
+  }
+  return ros::ok() && !stopped_;
+}
+
+bool PlaybackController::WaitForCredit(std::unique_lock<std::mutex>& lock) {
+  while (credits_ == 0) {
+    if (!ros::ok() || stopped_) {
+      return false;
+    }
+    cond_.wait_for(lock, kMaxWaitSlice);
+  }
+  --credits_;
+  ROS_DEBUG_STREAM("Run after received synch, " << credits_ << " credits left");
+  return true;
+}
+
+bool PlaybackController::WaitForWindow(std::unique_lock<std::mutex>& lock) {
+  while (in_flight_.size() >= window_) {
+    if (!ros::ok() || stopped_) {
+      return false;
+    }
+    if (ros::WallTime::now() - in_flight_.front().second > ack_timeout_) {
+      ROS_WARN_STREAM("No acknowledge for frame stamped " << in_flight_.front().first << ", considered lost");
+      in_flight_.pop_front();
+      ++frames_lost_;
+      break;
+    }
+    cond_.wait_for(lock, kMaxWaitSlice);
+  }
+  return true;
+}
+
+void PlaybackController::AddCredits(uint32_t credits) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    credits_ += credits;
+  }
+  cond_.notify_one();
+}
+
+void PlaybackController::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+  }
+  cond_.notify_all();
+}
+
+void PlaybackController::SynchCallback(const std_msgs::Bool::ConstPtr& msg) {
+  ROS_INFO_STREAM("Synch received");
+  if (msg->data)
+    AddCredits(1);
+}
+
+void PlaybackController::CreditsCallback(const std_msgs::UInt32::ConstPtr& msg) {
+  ROS_INFO_STREAM("Synch received for " << msg->data << " frames");
+  AddCredits(msg->data);
+}
+
+void PlaybackController::FramePublished(const ros::Time& stamp) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  last_publish_time_ = ros::WallTime::now();
+  if (frames_published_ == 0) {
+    start_time_ = last_publish_time_;
+  }
+  ++frames_published_;
+
+  if (mode_ == PlaybackMode::kAdaptive && !synch_mode_) {
+    in_flight_.push_back(std::make_pair(stamp, last_publish_time_));
+  }
+
+  if (frames_published_ > 1) {
+    ROS_INFO_STREAM_THROTTLE(10.0, "Playback achieved "
+                             << (frames_published_ - 1) / (last_publish_time_ - start_time_).toSec() << " frames/s");
+  }
+}
+
+void PlaybackController::AckCallback(const std_msgs::Header::ConstPtr& msg) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Acknowledges may skip frames, all frames up to the acknowledged one are done
+    while (!in_flight_.empty() && in_flight_.front().first <= msg->stamp) {
+      if (in_flight_.front().first == msg->stamp) {
+        double latency = (ros::WallTime::now() - in_flight_.front().second).toSec();
+        ack_latency_sum_ += latency;
+        ack_latency_max_ = std::max(ack_latency_max_, latency);
+        ++frames_acked_;
+      }
+      in_flight_.pop_front();
+    }
+  }
+  cond_.notify_one();
+}
+
+double PlaybackController::AchievedFrequency() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (frames_published_ < 2) {
+    return 0.0;
+  }
+  double elapsed = (last_publish_time_ - start_time_).toSec();
+  return elapsed > 0.0 ? (frames_published_ - 1) / elapsed : 0.0;
+}
+
+void PlaybackController::PrintSummary() const {
+  double frequency = AchievedFrequency();
+  std::lock_guard<std::mutex> lock(mutex_);
+  ROS_INFO_STREAM("Playback published " << frames_published_ << " frames at " << frequency << " frames/s");
+  if (mode_ == PlaybackMode::kAdaptive) {
+    double mean_latency = frames_acked_ > 0 ? ack_latency_sum_ / frames_acked_ : 0.0;
+    ROS_INFO_STREAM("Acknowledged " << frames_acked_ << " frames, lost " << frames_lost_
+                    << ", ack latency mean " << mean_latency * 1e3 << " ms, max " << ack_latency_max_ * 1e3 << " ms");
+  }
+}
+
+} // namespace kitti_utils
@@ -0,0 +1,111 @@
+/*
+ * @Description: Pacing of the player main loop, decides when the next frame can be published
+ * @References:
+ */
+#pragma once
+
+// C++
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <utility>
+// ROS
+#include <ros/ros.h>
+#include <std_msgs/Bool.h>
+#include <std_msgs/Header.h>
+#include <std_msgs/UInt32.h>
+
+namespace kitti_utils {
+
+/**
+ * @brief How the player paces the published frames
+ *        kRealtime:      sleep to keep the requested frequency (default)
+ *        kMaxThroughput: publish as soon as the next frame is ready
+ *        kAdaptive:      keep at most window frames not yet acknowledged by downstream nodes
+ */
+enum class PlaybackMode { kRealtime, kMaxThroughput, kAdaptive };
+
+/**
+ * @brief Parse playback mode name: "realtime", "max" or "adaptive"
+ * @return false if the name is unknown
+ */
+bool ParsePlaybackMode(const std::string& name, PlaybackMode* mode);
+
+/**
+ * @brief Pace the player loop and measure the achieved frame rate.
+ *        In adaptive mode downstream nodes acknowledge a processed frame by publishing
+ *        the header of the message they received (only the stamp is used).
+ *        In synch mode every frame after the first one needs a credit, credits are granted
+ *        one by one (std_msgs/Bool true) or in batches (std_msgs/UInt32 N).
+ *        Callbacks are expected to run in another thread (ros::AsyncSpinner), the player
+ *        thread sleeps on a condition variable while waiting.
+ */
+class PlaybackController {
+public:
+  PlaybackController(PlaybackMode mode, double frequency, unsigned int window, bool synch_mode);
+
+  PlaybackMode mode() const { return mode_; }
+
+  /**
+   * @brief Block until the next frame may be published according to the playback mode
+   *        and the synch credits. The first frame is never delayed.
+   * @return false if ROS is shutting down while waiting
+   */
+  bool WaitForNextFrame();
+
+  /// Grant credits in synch mode and wake up the player
+  void AddCredits(uint32_t credits);
+
+  void SynchCallback(const std_msgs::Bool::ConstPtr& msg);
+
+  void CreditsCallback(const std_msgs::UInt32::ConstPtr& msg);
+
+  /// Wake up and make any pending and future wait return false
+  void Stop();
+
+  /**
+   * @brief Must be called once all messages of a frame have been published
+   * @param stamp the stamp used in the headers of this frame
+   */
+  void FramePublished(const ros::Time& stamp);
+
+  void AckCallback(const std_msgs::Header::ConstPtr& msg);
+
+  /// Published frames per second since the first published frame
+  double AchievedFrequency() const;
+
+  void PrintSummary() const;
+
+private:
+  /// Wait for a synch credit, called with the lock held
+  bool WaitForCredit(std::unique_lock<std::mutex>& lock);
+  /// Wait until the in-flight window has room, called with the lock held
+  bool WaitForWindow(std::unique_lock<std::mutex>& lock);
+
+  PlaybackMode mode_;
+  unsigned int window_;
+  bool synch_mode_;
+  ros::Rate rate_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cond_;
+  uint64_t credits_;
+  bool stopped_;
+
+  /// Frames published but not yet acknowledged, with their publish wall time
+  std::deque<std::pair<ros::Time, ros::WallTime> > in_flight_;
+  /// If no acknowledge arrives in this duration the oldest frame is considered lost
+  ros::WallDuration ack_timeout_;
+
+  ros::WallTime start_time_;
+  ros::WallTime last_publish_time_;
+  unsigned int frames_published_;
+  unsigned int frames_acked_;
+  unsigned int frames_lost_;
+  double ack_latency_sum_;
+  double ack_latency_max_;
+};
+
+} // namespace kitti_utils
@@ -0,0 +1,116 @@
+/*
+ * @Description: Spherical projection of the velodyne scans into range, intensity and xyz images
+ * @References: RangeNet++ (Milioto et al., IROS 2019) and its SemanticKITTI projection
+ */
+
+#include "range_image.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <Eigen/Core>
+
+#include "array_math.h"
+
+namespace kitti_utils {
+
+namespace {
+const float kPi = 3.14159265f;
+/// Points closer to the sensor are not projected (m)
+const float kMinRange = 1e-3f;
+
+/// Points projected per block of the vectorized pass, the block arrays stay in L1
+const int kBlockSize = 256;
+
+typedef Eigen::Array<float, Eigen::Dynamic, 1> ArrayXf;
+}
+
+RangeImageBuilder::RangeImageBuilder(int rows, int cols, float fov_up, float fov_down)
+    : rows_(std::max(rows, 1)),
+      cols_(std::max(cols, 1)),
+      fov_up_(fov_up * kPi / 180.0f),
+      fov_((fov_up - fov_down) * kPi / 180.0f),
+      range_(rows_, cols_, CV_32FC1),
+      intensity_(rows_, cols_, CV_32FC1),
+      xyz_(rows_, cols_, CV_32FC3),
+      index_(rows_, cols_, CV_32SC1),
+      num_filled_(0) {
+  if (!(fov_ > 0.0f)) {
+    fov_ = 28.0f * kPi / 180.0f;
+  }
+}
+
+void RangeImageBuilder::Build(const sensor_msgs::PointCloud2& cloud) {
+  BuildPoints(reinterpret_cast<const float*>(GetVeloPoints(cloud)), sizeof(VeloPoint) / sizeof(float), 3,
+              GetVeloPointsSize(cloud));
+}
+
+void RangeImageBuilder::Build(const KittiPointCloud& cloud) {
+  // pcl::PointXYZI is x, y, z, padding, intensity, padding
+  const float* points = cloud.points.empty() ? NULL : &cloud.points[0].x;
+  BuildPoints(points, sizeof(KittiPoint) / sizeof(float), 4, cloud.size());
+}
+
+void RangeImageBuilder::BuildPoints(const float* points, size_t stride, size_t intensity_offset, size_t num_points) {
+  pixels_.resize(num_points);
+  ranges_.resize(num_points);
+
+  // Pixel and range of every point, block by block with Eigen array expressions
+  const float col_scale = 0.5f * cols_, row_scale = rows_ / fov_;
+  const float max_col = cols_ - 1.0f, max_row = rows_ - 1.0f;
+  ArrayXf x(kBlockSize), y(kBlockSize), z(kBlockSize), xy2(kBlockSize), u(kBlockSize), v(kBlockSize);
+  for (size_t start = 0; start < num_points; start += kBlockSize) {
+    const int count = static_cast<int>(std::min<size_t>(kBlockSize, num_points - start));
+    Eigen::Map<const Eigen::Array<float, 3, Eigen::Dynamic>, 0, Eigen::OuterStride<> > xyz(
+        points + start * stride, 3, count, Eigen::OuterStride<>(stride));
+    x.resize(count);
+    y.resize(count);
+    z.resize(count);
+    x = xyz.row(0).transpose();
+    y = xyz.row(1).transpose();
+    z = xyz.row(2).transpose();
+    xy2 = x.square() + y.square();
+    Eigen::Map<ArrayXf> range(&ranges_[start], count);
+    range = (xy2 + z.square()).sqrt();
+    // Column 0 at the back (yaw = pi), the columns grow turning clockwise seen from above.
+    // FastAtan2 is within 1.2e-5 rad, a column is 3e-3 rad wide
+    u = (col_scale * (1.0f - FastAtan2(y, x) / kPi)).max(0.0f).min(max_col);
+    v = (row_scale * (fov_up_ - FastAtan2(z, xy2.sqrt()))).max(0.0f).min(max_row);
+    Eigen::Map<Eigen::Array<int32_t, Eigen::Dynamic, 1> >(&pixels_[start], count) =
+        (range > kMinRange).select(v.cast<int32_t>() * cols_ + u.cast<int32_t>(), -1);
+  }
+
+  range_.setTo(-1.0f);
+  intensity_.setTo(-1.0f);
+  xyz_.setTo(cv::Scalar::all(-1.0f));
+  index_.setTo(-1);
+  float* range = range_.ptr<float>();
+  float* intensity = intensity_.ptr<float>();
+  float* xyz = xyz_.ptr<float>();
+  int32_t* index = index_.ptr<int32_t>();
+
+  // Keep the closest point of every pixel
+  num_filled_ = 0;
+  for (size_t i = 0; i < num_points; ++i) {
+    const int32_t pixel = pixels_[i];
+    if (pixel < 0) {
+      continue;
+    }
+    if (index[pixel] >= 0) {
+      if (ranges_[i] >= range[pixel]) {
+        continue;
+      }
+    } else {
+      ++num_filled_;
+    }
+    const float* point = points + i * stride;
+    range[pixel] = ranges_[i];
+    intensity[pixel] = point[intensity_offset];
+    xyz[3 * pixel] = point[0];
+    xyz[3 * pixel + 1] = point[1];
+    xyz[3 * pixel + 2] = point[2];
+    index[pixel] = static_cast<int32_t>(i);
+  }
+}
+
+} // namespace kitti_utils
@@ -0,0 +1,79 @@
+/*
+ * @Description: Spherical projection of the velodyne scans into range, intensity and xyz images
+ * @References: RangeNet++ (Milioto et al., IROS 2019) and its SemanticKITTI projection
+ */
+#pragma once
+
+// C++
+#include <cstdint>
+#include <vector>
+// OpenCV
+#include <opencv2/core/core.hpp>
+// ROS
+#include <sensor_msgs/PointCloud2.h>
+
+#include "kitti_utils.h"
+
+namespace kitti_utils {
+
+/**
+ * @brief Project the points of a scan on a rows x cols grid of elevation and azimuth, the input of the range
+ *        image networks. The rows follow a fixed beam model, the vertical field of view split in rows equal
+ *        bins from fov_up (row 0) to fov_down, and the columns split the 360 deg from the back of the vehicle,
+ *        clockwise seen from above, so that the left (+y) is at cols / 4 and the front (+x) in the middle column.
+ *
+ *        The pixels of all the points are computed in one vectorized pass over the scan (Eigen array expressions
+ *        and a polynomial atan2), then the points are scattered into the images, the closest point of a pixel
+ *        is kept. Pixels without point have -1 in all channels and in the index image.
+ *        Images are reused between frames.
+ *
+ *          builder.Build(cloud);
+ *          builder.Range() ... builder.Intensity() ... builder.Xyz() ... builder.Index()
+ */
+class RangeImageBuilder {
+public:
+  /**
+   * @param rows, cols image size, 64 x 2048 for the HDL-64E
+   * @param fov_up, fov_down elevation of the top of the first row and of the bottom of the last row (deg)
+   */
+  explicit RangeImageBuilder(int rows = 64, int cols = 2048, float fov_up = 3.0f, float fov_down = -25.0f);
+
+  /// Project a cloud in the VeloPoint layout (ReadVeloPoints)
+  void Build(const sensor_msgs::PointCloud2& cloud);
+  void Build(const KittiPointCloud& cloud);
+
+  int Rows() const { return rows_; }
+  int Cols() const { return cols_; }
+
+  /// Distance to the sensor (m), CV_32FC1
+  const cv::Mat& Range() const { return range_; }
+  /// Reflectance, CV_32FC1
+  const cv::Mat& Intensity() const { return intensity_; }
+  /// x, y, z in the velodyne frame (m), CV_32FC3
+  const cv::Mat& Xyz() const { return xyz_; }
+  /// Index of the point in the cloud, CV_32SC1
+  const cv::Mat& Index() const { return index_; }
+
+  /// Number of pixels with a point after the last Build()
+  size_t NumFilled() const { return num_filled_; }
+
+private:
+  /// Project num_points points of stride floats each, starting with x, y, z, intensity at intensity_offset
+  void BuildPoints(const float* points, size_t stride, size_t intensity_offset, size_t num_points);
+
+  int rows_;
+  int cols_;
+  float fov_up_;    // rad
+  float fov_;       // rad
+  cv::Mat range_;
+  cv::Mat intensity_;
+  cv::Mat xyz_;
+  cv::Mat index_;
+  size_t num_filled_;
+
+  // Per point pixel (-1 if not projected) and range of the vectorized pass
+  std::vector<int32_t> pixels_;
+  std::vector<float> ranges_;
+};
+
+} // namespace kitti_utils
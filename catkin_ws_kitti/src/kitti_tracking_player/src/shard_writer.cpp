@@ -0,0 +1,119 @@
+/*
+ * @Description: Append records to large sequential shard files, with a text index
+ * @References:
+ */
+
+#include "shard_writer.h"
+
+#include <ros/console.h>
+
+namespace kitti_utils {
+
+namespace {
+const size_t kStdioBufferSize = 8 << 20;
+const uint64_t kRecordAlignment = 8;
+}
+
+ShardWriter::ShardWriter(const std::string& dir, const std::string& prefix, uint64_t max_shard_bytes)
+    : dir_(dir),
+      prefix_(prefix),
+      max_shard_bytes_(max_shard_bytes),
+      index_file_(NULL),
+      shard_file_(NULL),
+      shard_(0),
+      offset_(0),
+      num_records_(0),
+      total_bytes_(0) {
+  if (!dir_.empty() && dir_[dir_.size() - 1] != '/') {
+    dir_ += '/';
+  }
+}
+
+ShardWriter::~ShardWriter() {
+  Close();
+}
+
+bool ShardWriter::Open() {
+  std::string index_filename = dir_ + prefix_ + ".index";
+  index_file_ = fopen(index_filename.c_str(), "w");
+  if (!index_file_) {
+    ROS_ERROR_STREAM("Fail to create " << index_filename);
+    return false;
+  }
+  return true;
+}
+
+bool ShardWriter::OpenShard() {
+  char name[32];
+  snprintf(name, sizeof(name), "-%05u.shard", shard_);
+  shard_name_ = prefix_ + name;
+  std::string filename = dir_ + shard_name_;
+  shard_file_ = fopen(filename.c_str(), "wb");
+  if (!shard_file_) {
+    ROS_ERROR_STREAM("Fail to create " << filename);
+    return false;
+  }
+  stdio_buffer_.resize(kStdioBufferSize);
+  setvbuf(shard_file_, stdio_buffer_.data(), _IOFBF, stdio_buffer_.size());
+  offset_ = 0;
+  return true;
+}
+
+bool ShardWriter::CloseShard() {
+  if (!shard_file_) {
+    return true;
+  }
+  bool ok = fclose(shard_file_) == 0;
+  if (!ok) {
+    ROS_ERROR_STREAM("Fail to write " << dir_ << shard_name_);
+  }
+  shard_file_ = NULL;
+  ++shard_;
+  return ok;
+}
+
+bool ShardWriter::Write(const std::string& key, const void* data, size_t size) {
+  if (!index_file_) {
+    return false;
+  }
+  uint64_t padding = (kRecordAlignment - offset_ % kRecordAlignment) % kRecordAlignment;
+  if (shard_file_ && offset_ > 0 && offset_ + padding + size > max_shard_bytes_) {
+    if (!CloseShard()) {
+      return false;
+    }
+  }
+  if (!shard_file_) {
+    if (!OpenShard()) {
+      return false;
+    }
+    padding = 0;
+  }
+
+  static const char zeros[kRecordAlignment] = {0};
+  if (padding > 0 && fwrite(zeros, 1, padding, shard_file_) != padding) {
+    ROS_ERROR_STREAM("Fail to write " << dir_ << shard_name_);
+    return false;
+  }
+  offset_ += padding;
+  if (fwrite(data, 1, size, shard_file_) != size) {
+    ROS_ERROR_STREAM("Fail to write " << dir_ << shard_name_);
+    return false;
+  }
+  fprintf(index_file_, "%s %llu %llu %s\n", shard_name_.c_str(), static_cast<unsigned long long>(offset_),
+          static_cast<unsigned long long>(size), key.c_str());
+  offset_ += size;
+  total_bytes_ += size;
+  ++num_records_;
+  return true;
+}
+
+bool ShardWriter::Close() {
+  bool ok = CloseShard();
+  if (index_file_) {
+    ok = fclose(index_file_) == 0 && ok;
+    index_file_ = NULL;
+  }
+  return ok;
+}
+
+} // namespace kitti_utils
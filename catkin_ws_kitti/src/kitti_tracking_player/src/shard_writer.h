@@ -0,0 +1,65 @@
+/*
+ * @Description: Append records to large sequential shard files, with a text index
+ * @References:
+ */
+#pragma once
+
+// C++
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace kitti_utils {
+
+/**
+ * @brief Write records one after the other into <dir>/<prefix>-00000.shard, <prefix>-00001.shard...
+ *        A new shard is started when the current one would exceed max_shard_bytes (a single larger
+ *        record gets a shard of its own). Records start at 8 byte aligned offsets, the gaps are zeros.
+ *        Every record gets a line in <dir>/<prefix>.index:
+ *          <shard file name> <offset> <size> <key>
+ *        Files are written through a large stdio buffer, so the disk only sees long sequential writes.
+ *        Not thread safe, the exporter writes from a single thread.
+ */
+class ShardWriter {
+public:
+  /**
+   * @param dir output directory, must exist
+   * @param prefix file name prefix of the shards and of the index
+   * @param max_shard_bytes shard size limit
+   */
+  ShardWriter(const std::string& dir, const std::string& prefix, uint64_t max_shard_bytes);
+  ~ShardWriter();
+
+  /// Create the index file, false if it can not be written
+  bool Open();
+
+  /// Append a record, key must not contain white spaces
+  bool Write(const std::string& key, const void* data, size_t size);
+
+  /// Flush and close the current shard and the index
+  bool Close();
+
+  unsigned int NumShards() const { return shard_ + (shard_file_ ? 1 : 0); }
+  uint64_t NumRecords() const { return num_records_; }
+  uint64_t TotalBytes() const { return total_bytes_; }
+
+private:
+  bool OpenShard();
+  bool CloseShard();
+
+  std::string dir_;
+  std::string prefix_;
+  uint64_t max_shard_bytes_;
+
+  FILE* index_file_;
+  FILE* shard_file_;
+  std::string shard_name_;
+  unsigned int shard_;  // number of closed shards
+  uint64_t offset_;     // write position in the current shard
+  uint64_t num_records_;
+  uint64_t total_bytes_;
+  std::vector<char> stdio_buffer_;
+};
+
+} // namespace kitti_utils
@@ -0,0 +1,41 @@
+/*
+ * @Description: Count the frames each processing stage of a player ran or was skipped
+ * @References:
+ */
+
+#include "stage_counter.h"
+
+#include <ros/console.h>
+
+namespace kitti_utils {
+
+int StageCounter::AddStage(const std::string& name) {
+  Stage stage;
+  stage.name = name;
+  stage.ran = 0;
+  stage.skipped = 0;
+  stages_.push_back(stage);
+  return stages_.size() - 1;
+}
+
+bool StageCounter::Run(int stage, bool needed) {
+  if (needed) {
+    ++stages_[stage].ran;
+  } else {
+    ++stages_[stage].skipped;
+  }
+  return needed;
+}
+
+void StageCounter::PrintSummary() const {
+  ROS_INFO_STREAM("Processing stages, frames run / skipped without subscriber:");
+  for (const Stage& stage : stages_) {
+    // Stages not enabled by the options are never counted
+    if (stage.ran + stage.skipped == 0) {
+      continue;
+    }
+    ROS_INFO_STREAM("  " << stage.name << ": " << stage.ran << " / " << stage.skipped);
+  }
+}
+
+} // namespace kitti_utils
@@ -0,0 +1,43 @@
+/*
+ * @Description: Count the frames each processing stage of a player ran or was skipped
+ * @References:
+ */
+#pragma once
+
+// C++
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace kitti_utils {
+
+/**
+ * @brief Processing stages of a player that run only when their output is needed (a subscriber,
+ *        a viewer or another stage). For every stage the number of frames it ran and was skipped
+ *        is counted and printed at the end of the playback. Used from the player thread only.
+ *
+ *          int decode = stages.AddStage("image decode");
+ *          if (stages.Run(decode, pub.getNumSubscribers() > 0)) { ... }
+ */
+class StageCounter {
+public:
+  /// Register a stage, returns its index for Run()
+  int AddStage(const std::string& name);
+
+  /// Count the stage for the current frame, returns needed
+  bool Run(int stage, bool needed);
+
+  /// Log the frames run and skipped per stage
+  void PrintSummary() const;
+
+private:
+  struct Stage {
+    std::string name;
+    uint64_t ran;
+    uint64_t skipped;
+  };
+
+  std::vector<Stage> stages_;
+};
+
+} // namespace kitti_utils
@@ -0,0 +1,213 @@
+/*
+ * @Description: Assign the points of a scan to the tracklet boxes in a single pass
+ * @References:
+ */
+
+#include "tracklet_labeller.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "kitti_utils.h"
+
+namespace kitti_utils {
+
+TrackletLabeller::TrackletLabeller(float cell_size)
+    : cell_size_(cell_size > 0.0f ? cell_size : 1.0f),
+      min_x_(0.0f),
+      min_y_(0.0f),
+      cols_(0),
+      rows_(0) {
+}
+
+void TrackletLabeller::SetTracklets(Tracklets& tracklets, int frame) {
+  boxes_.clear();
+  for (int id = 0; id < tracklets.numberOfTracklets(); ++id) {
+    Tracklets::tPose* pose;
+    if (!tracklets.getPose(id, frame, pose)) {
+      continue;
+    }
+    const KittiTracklet* tracklet = tracklets.getTracklet(id);
+    LabelBox box;
+    box.tx = pose->tx;
+    box.ty = pose->ty;
+    box.tz = pose->tz;
+    box.rz = pose->rz;
+    box.l = tracklet->l;
+    box.w = tracklet->w;
+    box.h = tracklet->h;
+    box.instance = id;
+    box.label = KittiDataset::getLabel(tracklet->objectType.c_str());
+    boxes_.push_back(box);
+  }
+  BuildGrid();
+}
+
+void TrackletLabeller::SetBoxes(const std::vector<LabelBox>& boxes) {
+  boxes_ = boxes;
+  BuildGrid();
+}
+
+void TrackletLabeller::BuildGrid() {
+  tests_.resize(boxes_.size());
+  if (indices_.size() < boxes_.size()) {
+    indices_.resize(boxes_.size());
+  }
+  cols_ = 0;
+  rows_ = 0;
+  if (boxes_.empty()) {
+    return;
+  }
+
+  // Footprint bounds of every box, and of all of them
+  std::vector<float> bounds(4 * boxes_.size());
+  float max_x = -INFINITY, max_y = -INFINITY;
+  min_x_ = INFINITY;
+  min_y_ = INFINITY;
+  for (size_t i = 0; i < boxes_.size(); ++i) {
+    const LabelBox& box = boxes_[i];
+    BoxTest& test = tests_[i];
+    test.cx = box.tx;
+    test.cy = box.ty;
+    test.cos_yaw = std::cos(box.rz);
+    test.sin_yaw = std::sin(box.rz);
+    test.half_l = 0.5f * box.l;
+    test.half_w = 0.5f * box.w;
+    test.min_z = box.tz;
+    test.max_z = box.tz + box.h;
+
+    float extent_x = std::abs(test.cos_yaw) * test.half_l + std::abs(test.sin_yaw) * test.half_w;
+    float extent_y = std::abs(test.sin_yaw) * test.half_l + std::abs(test.cos_yaw) * test.half_w;
+    float* b = &bounds[4 * i];
+    b[0] = box.tx - extent_x;
+    b[1] = box.ty - extent_y;
+    b[2] = box.tx + extent_x;
+    b[3] = box.ty + extent_y;
+    min_x_ = std::min(min_x_, b[0]);
+    min_y_ = std::min(min_y_, b[1]);
+    max_x = std::max(max_x, b[2]);
+    max_y = std::max(max_y, b[3]);
+  }
+  cols_ = static_cast<int>((max_x - min_x_) / cell_size_) + 1;
+  rows_ = static_cast<int>((max_y - min_y_) / cell_size_) + 1;
+
+  // Count the candidates of every cell, then fill them (compressed rows)
+  const float inv_cell = 1.0f / cell_size_;
+  cell_start_.assign(cols_ * rows_ + 1, 0);
+  for (int pass = 0; pass < 2; ++pass) {
+    if (pass == 1) {
+      for (size_t c = 1; c < cell_start_.size(); ++c) {
+        cell_start_[c] += cell_start_[c - 1];
+      }
+      cell_boxes_.resize(cell_start_.back());
+    }
+    for (size_t i = 0; i < boxes_.size(); ++i) {
+      const float* b = &bounds[4 * i];
+      int col_begin = static_cast<int>((b[0] - min_x_) * inv_cell);
+      int row_begin = static_cast<int>((b[1] - min_y_) * inv_cell);
+      int col_end = std::min(static_cast<int>((b[2] - min_x_) * inv_cell), cols_ - 1);
+      int row_end = std::min(static_cast<int>((b[3] - min_y_) * inv_cell), rows_ - 1);
+      for (int row = row_begin; row <= row_end; ++row) {
+        for (int col = col_begin; col <= col_end; ++col) {
+          int cell = row * cols_ + col;
+          if (pass == 0) {
+            ++cell_start_[cell + 1];
+          } else {
+            // cell_start_[cell] is used as the insert position, shifted back below
+            cell_boxes_[cell_start_[cell]++] = i;
+          }
+        }
+      }
+    }
+  }
+  for (size_t c = cell_start_.size() - 1; c > 0; --c) {
+    cell_start_[c] = cell_start_[c - 1];
+  }
+  cell_start_[0] = 0;
+}
+
+void TrackletLabeller::Label(const sensor_msgs::PointCloud2& cloud) {
+  LabelPoints(reinterpret_cast<const float*>(GetVeloPoints(cloud)), sizeof(VeloPoint) / sizeof(float),
+              GetVeloPointsSize(cloud));
+}
+
+void TrackletLabeller::Label(const KittiPointCloud& cloud) {
+  LabelPoints(cloud.points.empty() ? NULL : &cloud.points[0].x, sizeof(KittiPoint) / sizeof(float),
+              cloud.points.size());
+}
+
+void TrackletLabeller::LabelPoints(const float* xyz, size_t stride, size_t num_points) {
+  instance_ids_.assign(num_points, -1);
+  labels_.assign(num_points, -1);
+  for (size_t i = 0; i < boxes_.size(); ++i) {
+    indices_[i].clear();
+  }
+  if (boxes_.empty()) {
+    return;
+  }
+
+  const float inv_cell = 1.0f / cell_size_;
+  const float width = cols_ * cell_size_;
+  const float height = rows_ * cell_size_;
+  for (size_t p = 0; p < num_points; ++p, xyz += stride) {
+    float gx = xyz[0] - min_x_;
+    float gy = xyz[1] - min_y_;
+    if (!(gx >= 0.0f && gx < width && gy >= 0.0f && gy < height)) {
+      continue;
+    }
+    int cell = static_cast<int>(gy * inv_cell) * cols_ + static_cast<int>(gx * inv_cell);
+    for (int c = cell_start_[cell]; c < cell_start_[cell + 1]; ++c) {
+      const int box = cell_boxes_[c];
+      const BoxTest& test = tests_[box];
+      if (xyz[2] < test.min_z || xyz[2] > test.max_z) {
+        continue;
+      }
+      // Point in the box frame
+      float dx = xyz[0] - test.cx;
+      float dy = xyz[1] - test.cy;
+      float u = test.cos_yaw * dx + test.sin_yaw * dy;
+      float v = test.cos_yaw * dy - test.sin_yaw * dx;
+      if (std::abs(u) > test.half_l || std::abs(v) > test.half_w) {
+        continue;
+      }
+      indices_[box].push_back(p);
+      if (instance_ids_[p] < 0) {
+        instance_ids_[p] = boxes_[box].instance;
+        labels_[p] = boxes_[box].label;
+      }
+    }
+  }
+}
+
+void TrackletLabeller::ToCloud(const sensor_msgs::PointCloud2& cloud, sensor_msgs::PointCloud2& labelled) const {
+  if (labelled.fields.size() != 6) {
+    const char* names[6] = {"x", "y", "z", "intensity", "label", "instance"};
+    labelled.fields.resize(6);
+    for (int i = 0; i < 6; ++i) {
+      labelled.fields[i].name = names[i];
+      labelled.fields[i].offset = i * sizeof(float);
+      labelled.fields[i].datatype = i < 4 ? sensor_msgs::PointField::FLOAT32 : sensor_msgs::PointField::INT32;
+      labelled.fields[i].count = 1;
+    }
+  }
+  const VeloPoint* points = GetVeloPoints(cloud);
+  const size_t num_points = std::min(GetVeloPointsSize(cloud), instance_ids_.size());
+  labelled.data.resize(num_points * sizeof(LabelledPoint));
+  LabelledPoint* out = reinterpret_cast<LabelledPoint*>(labelled.data.data());
+  for (size_t i = 0; i < num_points; ++i) {
+    out[i].x = points[i].x;
+    out[i].y = points[i].y;
+    out[i].z = points[i].z;
+    out[i].intensity = points[i].intensity;
+    out[i].label = labels_[i];
+    out[i].instance = instance_ids_[i];
+  }
+  labelled.height = 1;
+  labelled.width = num_points;
+  labelled.point_step = sizeof(LabelledPoint);
+  labelled.row_step = labelled.point_step * labelled.width;
+  labelled.is_bigendian = false;
+  labelled.is_dense = true;
+}
+
+} // namespace kitti_utils
@@ -0,0 +1,113 @@
+/*
+ * @Description: Assign the points of a scan to the tracklet boxes in a single pass
+ * @References:
+ */
+#pragma once
+
+// C++
+#include <cstdint>
+#include <vector>
+// ROS
+#include <sensor_msgs/PointCloud2.h>
+
+#include "KittiDataset.h"
+
+namespace kitti_utils {
+
+/// Oriented box of a tracklet at one frame, in the velodyne frame
+struct LabelBox {
+  float tx, ty, tz;  // center of the bottom face (m)
+  float rz;          // yaw (rad)
+  float l, w, h;     // length along x, width along y, height (m)
+  int32_t instance;  // instance id written for the points inside the box
+  int32_t label;     // class, KittiDataset::getLabel()
+};
+
+/// One point of a labelled cloud (TrackletLabeller::ToCloud), 24 bytes without padding
+struct LabelledPoint {
+  float x;
+  float y;
+  float z;
+  float intensity;
+  int32_t label;     // -1 outside all boxes
+  int32_t instance;  // -1 outside all boxes
+};
+
+/**
+ * @brief Find the points of all the boxes of a frame in one pass over the scan, instead of one
+ *        pcl::CropBox pass per tracklet. The bird's eye view footprints of the boxes are rasterized
+ *        once into a grid of candidate lists; every point is then mapped to its cell and only tested
+ *        against the few boxes overlapping that cell, most points fall outside the grid and are
+ *        rejected by a bounds check.
+ *        Boxes are rotated around z only (rx and ry are always 0 in the KITTI tracklets).
+ *        All buffers are kept between frames.
+ *
+ *          labeller.SetTracklets(dataset->getTracklets(), frame);
+ *          labeller.Label(cloud);
+ *          labeller.Indices(i) ... labeller.InstanceIds() ... labeller.ToCloud(cloud, labelled)
+ */
+class TrackletLabeller {
+public:
+  /// @param cell_size edge length of the grid cells (m)
+  explicit TrackletLabeller(float cell_size = 1.0f);
+
+  /// Use the boxes of the tracklets active at frame, the instance id is the tracklet id
+  void SetTracklets(Tracklets& tracklets, int frame);
+
+  void SetBoxes(const std::vector<LabelBox>& boxes);
+
+  /// Label a cloud in the VeloPoint layout (ReadVeloPoints)
+  void Label(const sensor_msgs::PointCloud2& cloud);
+  void Label(const KittiPointCloud& cloud);
+
+  size_t NumBoxes() const { return boxes_.size(); }
+  const LabelBox& Box(size_t box) const { return boxes_[box]; }
+
+  /// Indices of the points inside a box, a point inside two overlapping boxes is in both lists
+  const std::vector<int>& Indices(size_t box) const { return indices_[box]; }
+
+  /// Instance id of every point, -1 for the points outside all boxes (first box wins on overlaps)
+  const std::vector<int32_t>& InstanceIds() const { return instance_ids_; }
+
+  /// Label of every point, -1 for the points outside all boxes
+  const std::vector<int32_t>& Labels() const { return labels_; }
+
+  /**
+   * @brief Fill labelled with the points of cloud (VeloPoint layout) followed by int32 fields label
+   *        and instance, in the LabelledPoint layout. cloud must be the one given to the last Label() call.
+   *        The data buffer of labelled is reused, header not modified.
+   */
+  void ToCloud(const sensor_msgs::PointCloud2& cloud, sensor_msgs::PointCloud2& labelled) const;
+
+private:
+  /// Box in the form used by the point test
+  struct BoxTest {
+    float cx, cy;
+    float cos_yaw, sin_yaw;
+    float half_l, half_w;
+    float min_z, max_z;
+  };
+
+  /// Rasterize the box footprints into the candidate grid
+  void BuildGrid();
+
+  /// Label num_points points of stride floats each, starting with x, y, z
+  void LabelPoints(const float* xyz, size_t stride, size_t num_points);
+
+  float cell_size_;
+  std::vector<LabelBox> boxes_;
+  std::vector<BoxTest> tests_;
+
+  // Grid over the union of the box footprints, candidates of cell c are
+  // cell_boxes_[cell_start_[c], cell_start_[c + 1])
+  float min_x_, min_y_;
+  int cols_, rows_;
+  std::vector<int> cell_start_;
+  std::vector<int> cell_boxes_;
+
+  std::vector<std::vector<int> > indices_;
+  std::vector<int32_t> instance_ids_;
+  std::vector<int32_t> labels_;
+};
+
+} // namespace kitti_utils
@@ -0,0 +1,253 @@
+/*
+ * @Description: Low priority thread drawing the visualization images of the player, and showing them
+ * @References:
+ */
+
+#include "viz_worker.h"
+
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <ros/console.h>
+
+namespace kitti_utils {
+
+namespace {
+/// Nice value of the worker thread, drawing only gets the CPU left by the player and its consumers
+const int kWorkerNice = 10;
+/// The viewer windows are refreshed at this period even without new frame (ms)
+const int kViewerPeriod = 30;
+
+const char* const kImageWindow = "CameraSimulator Color Viewer";
+const char* const kBoxesWindow = "tracklet boxes";
+const char* const kLabelsWindow = "bboxes";
+const char* const kProjectionWindow = "img_fusion_result";
+
+/// Draw the 2D labels, colored by type, with the occlusion state
+void DrawLabels(const std::vector<ObjectDetect>& labels, cv::Mat& image) {
+  for (const ObjectDetect& rect : labels) {
+    if (rect.type == "Car")
+      cv::rectangle(image, rect.bbox, cv::Scalar(142, 0, 0), 2);
+    else if (rect.type == "Pedestrian")
+      cv::rectangle(image, rect.bbox, cv::Scalar(60, 20, 220), 2);
+    else if (rect.type == "Cyclist")
+      cv::rectangle(image, rect.bbox, cv::Scalar(32, 11, 119), 2);
+    else
+      cv::rectangle(image, rect.bbox, cv::Scalar(255, 255, 255), 2);
+    cv::putText(image, std::to_string(rect.occluded), rect.bbox.tl(), cv::FONT_HERSHEY_PLAIN, 0.8, cv::Scalar(0, 255, 255));
+    cv::putText(image, rect.type, cv::Point(rect.bbox.tl().x + 8, rect.bbox.tl().y - 2), cv::FONT_HERSHEY_PLAIN, 0.8, cv::Scalar(0, 255, 255));
+  }
+}
+
+/// Draw the points in front of the camera colored by their distance, hue from 0 at 1 m to 120 at 70 m
+void DrawProjection(const sensor_msgs::PointCloud2& cloud, const Eigen::Matrix<float, 3, 4>& velo_to_image,
+                    const cv::Mat& image, cv::Mat& hsv_image, cv::Mat& result) {
+  cv::cvtColor(image, hsv_image, CV_BGR2HSV);
+  const VeloPoint* points = GetVeloPoints(cloud);
+  const size_t num_points = GetVeloPointsSize(cloud);
+  const float min_distance = 1.0f, max_distance = 70.0f, scale = 120.0f;
+  for (size_t i = 0; i < num_points; ++i) {
+    const VeloPoint& point = points[i];
+    if (point.x < 0) {
+      continue;
+    }
+    Eigen::Vector3f projected = velo_to_image.leftCols<3>() * Eigen::Vector3f(point.x, point.y, point.z) + velo_to_image.col(3);
+    if (projected.z() <= 0.0f) {
+      continue;
+    }
+    float distance = std::sqrt(point.x * point.x + point.y * point.y + point.z * point.z);
+    int hue = (distance - min_distance) / (max_distance - min_distance) * scale;
+    cv::circle(hsv_image, cv::Point(projected.x() / projected.z(), projected.y() / projected.z()), 2, cv::Scalar(hue, 255, 255), -1);
+  }
+  cv::cvtColor(hsv_image, result, CV_HSV2BGR);
+}
+}
+
+VizWorker::VizWorker(const Calibration& calib, bool viewer, const Callback& callback)
+    : velo_to_image_(Eigen::Matrix<float, 3, 4>::Zero()),
+      has_calibration_(false),
+      viewer_(viewer),
+      callback_(callback),
+      has_pending_(false),
+      stopped_(false),
+      drawn_(0),
+      dropped_(0),
+      draw_time_sum_(0.0),
+      draw_time_max_(0.0) {
+  projector_.SetCalibration(calib);
+  has_calibration_ = calib.P2().rows() == 3 && calib.P2().cols() == 4 &&
+                     calib.R_Rect_0().rows() == 3 && calib.R_Rect_0().cols() == 3 &&
+                     calib.Velo2Cam().rows() == 3 && calib.Velo2Cam().cols() == 4;
+  if (has_calibration_) {
+    velo_to_image_ = calib.GetVelo2ImageMatrix();
+  }
+  pending_.draw_boxes = false;
+  pending_.draw_labels = false;
+  working_.draw_boxes = false;
+  working_.draw_labels = false;
+  worker_ = std::thread(&VizWorker::WorkerLoop, this);
+}
+
+VizWorker::~VizWorker() {
+  Stop();
+}
+
+void VizWorker::Post(unsigned int frame, const ros::Time& stamp, const cv::Mat& image,
+                     const std::vector<ObjectState>* states, const Eigen::Matrix3Xf* corners,
+                     const std::vector<ObjectDetect>* labels, const sensor_msgs::PointCloud2ConstPtr& cloud) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (stopped_) {
+    return;
+  }
+  if (has_pending_) {
+    ++dropped_;
+  }
+  pending_.frame = frame;
+  pending_.stamp = stamp;
+  image.copyTo(pending_.image);
+
+  pending_.draw_boxes = states && corners;
+  if (pending_.draw_boxes) {
+    pending_.corners = *corners;
+    pending_.names.resize(states->size());
+    pending_.ids.resize(states->size());
+    pending_.colors.resize(states->size());
+    for (size_t i = 0; i < states->size(); ++i) {
+      const ObjectState& state = (*states)[i];
+      pending_.names[i] = state.class_name;
+      pending_.ids[i] = state.id;
+      int r = 0, g = 255, b = 0;
+      KittiDataset::getColor(state.class_name.c_str(), r, g, b);
+      pending_.colors[i] = cv::Scalar(b, g, r);
+    }
+  }
+
+  pending_.draw_labels = labels != NULL;
+  if (pending_.draw_labels) {
+    pending_.labels = *labels;
+  }
+
+  pending_.cloud = has_calibration_ ? cloud : sensor_msgs::PointCloud2ConstPtr();
+  has_pending_ = true;
+  cond_.notify_one();
+}
+
+void VizWorker::Draw() {
+  const cv::Mat& image = working_.image;
+
+  output_.boxes.clear();
+  if (working_.draw_boxes) {
+    projector_.Project(working_.corners, image.size());
+    output_.boxes = projector_.Boxes();
+    image.copyTo(output_.boxes_image);
+    for (size_t i = 0; i < output_.boxes.size() && i < working_.colors.size(); ++i) {
+      const ProjectedBox& box = output_.boxes[i];
+      BoxProjector::Draw(box, working_.colors[i], output_.boxes_image);
+      if (box.visible) {
+        cv::putText(output_.boxes_image, working_.names[i] + " " + std::to_string(working_.ids[i]),
+                    cv::Point(box.bbox.x, std::max(box.bbox.y - 4, 12)),
+                    cv::FONT_HERSHEY_SIMPLEX, 0.5, working_.colors[i], 1);
+      }
+    }
+  } else {
+    output_.boxes_image.release();
+  }
+
+  if (working_.draw_labels) {
+    image.copyTo(output_.labels_image);
+    DrawLabels(working_.labels, output_.labels_image);
+  } else {
+    output_.labels_image.release();
+  }
+
+  if (working_.cloud) {
+    DrawProjection(*working_.cloud, velo_to_image_, image, hsv_image_, output_.projection_image);
+  } else {
+    output_.projection_image.release();
+  }
+}
+
+void VizWorker::WorkerLoop() {
+  if (setpriority(PRIO_PROCESS, syscall(SYS_gettid), kWorkerNice) != 0) {
+    ROS_WARN_STREAM("Could not lower the priority of the visualization thread");
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    auto ready = [this] { return stopped_ || has_pending_; };
+    if (viewer_) {
+      cond_.wait_for(lock, std::chrono::milliseconds(kViewerPeriod), ready);
+    } else {
+      cond_.wait(lock, ready);
+    }
+    if (stopped_) {
+      break;
+    }
+    if (!has_pending_) {
+      // Keep the windows responsive between frames
+      lock.unlock();
+      cv::waitKey(1);
+      lock.lock();
+      continue;
+    }
+    // Take the pending frame, its buffers go back to Post() for the next one
+    std::swap(pending_, working_);
+    has_pending_ = false;
+    lock.unlock();
+
+    auto start = std::chrono::steady_clock::now();
+    Draw();
+    // The player reuses its cloud buffer once nobody holds it
+    working_.cloud.reset();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (callback_) {
+      callback_(working_, output_);
+    }
+    if (viewer_) {
+      cv::imshow(kImageWindow, working_.image);
+      if (!output_.boxes_image.empty())
+        cv::imshow(kBoxesWindow, output_.boxes_image);
+      if (!output_.labels_image.empty())
+        cv::imshow(kLabelsWindow, output_.labels_image);
+      if (!output_.projection_image.empty())
+        cv::imshow(kProjectionWindow, output_.projection_image);
+      cv::waitKey(1);
+    }
+
+    lock.lock();
+    ++drawn_;
+    draw_time_sum_ += elapsed;
+    draw_time_max_ = std::max(draw_time_max_, elapsed);
+  }
+  lock.unlock();
+  if (viewer_) {
+    cv::destroyAllWindows();
+  }
+}
+
+void VizWorker::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+  }
+  cond_.notify_all();
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+}
+
+void VizWorker::PrintStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  double mean = drawn_ > 0 ? draw_time_sum_ / drawn_ : 0.0;
+  ROS_INFO_STREAM("Visualization: " << drawn_ << " frames drawn, " << dropped_ << " dropped, drawing mean "
+                  << mean * 1e3 << " ms, max " << draw_time_max_ * 1e3 << " ms");
+}
+
+} // namespace kitti_utils
@@ -0,0 +1,123 @@
+/*
+ * @Description: Low priority thread drawing the visualization images of the player, and showing them
+ * @References:
+ */
+#pragma once
+
+// C++
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+// Eigen
+#include <Eigen/Core>
+// OpenCV
+#include <opencv2/core/core.hpp>
+// ROS
+#include <ros/time.h>
+#include <sensor_msgs/PointCloud2.h>
+
+#include "box_projector.h"
+#include "kitti_track_label.h"
+#include "kitti_utils.h"
+#include "object_state.h"
+
+namespace kitti_utils {
+
+/**
+ * @brief Draw the visualization images of the frames on a low priority thread, so that the player never
+ *        waits for them: the projected tracklet boxes, the 2D labels and the velodyne points projected in
+ *        the color image. The images are handed to a callback publishing them, and with a local viewer
+ *        they are shown by the same thread, which owns all the HighGUI windows.
+ *
+ *        The player posts the image and the data of a frame and goes on; if the worker is still busy
+ *        with an older frame when a new one is posted, the waiting frame is replaced by the new one.
+ *        Frame buffers are reused, the image is copied into a buffer owned by the worker and the cloud
+ *        is held by its shared pointer.
+ */
+class VizWorker {
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  struct Frame {
+    unsigned int frame;
+    ros::Time stamp;
+    cv::Mat image;                        // copy of the camera image
+    // Tracklet boxes, drawn when draw_boxes
+    bool draw_boxes;
+    Eigen::Matrix3Xf corners;
+    std::vector<std::string> names;
+    std::vector<int> ids;
+    std::vector<cv::Scalar> colors;
+    // 2D labels, drawn when draw_labels
+    bool draw_labels;
+    std::vector<ObjectDetect> labels;
+    // Velodyne points projected in the image when cloud is set
+    sensor_msgs::PointCloud2ConstPtr cloud;
+  };
+
+  /// Images drawn for a frame, empty when not requested
+  struct Output {
+    std::vector<ProjectedBox> boxes;
+    cv::Mat boxes_image;
+    cv::Mat labels_image;
+    cv::Mat projection_image;
+  };
+
+  /// Called on the worker thread with the images of a frame
+  typedef std::function<void(const Frame& frame, const Output& output)> Callback;
+
+  /**
+   * @param viewer show the camera image and the drawn images in HighGUI windows
+   * @param callback publish the images, may be empty
+   */
+  VizWorker(const Calibration& calib, bool viewer, const Callback& callback);
+  ~VizWorker();
+
+  /**
+   * @brief Hand a frame over to the worker
+   * @param states, corners tracklet boxes (ObjectStateBuilder), not drawn if NULL
+   * @param labels 2D labels, not drawn if NULL
+   * @param cloud velodyne points projected in the image, not drawn if empty
+   */
+  void Post(unsigned int frame, const ros::Time& stamp, const cv::Mat& image,
+            const std::vector<ObjectState>* states, const Eigen::Matrix3Xf* corners,
+            const std::vector<ObjectDetect>* labels, const sensor_msgs::PointCloud2ConstPtr& cloud);
+
+  /// Finish the frame being drawn, close the windows and stop the worker, pending frames are dropped
+  void Stop();
+
+  /// Log the number of drawn and dropped frames and the drawing time
+  void PrintStats() const;
+
+private:
+  void WorkerLoop();
+  /// Draw the images requested by working_ into output_
+  void Draw();
+
+  BoxProjector projector_;
+  Eigen::Matrix<float, 3, 4> velo_to_image_;
+  bool has_calibration_;
+  bool viewer_;
+  Callback callback_;
+  Frame pending_;
+  Frame working_;
+  Output output_;
+  cv::Mat hsv_image_;  // projection drawn in HSV, reused
+  bool has_pending_;
+  bool stopped_;
+  mutable std::mutex mutex_;
+  std::condition_variable cond_;
+  std::thread worker_;
+
+  // Statistics, protected by mutex_
+  uint64_t drawn_;
+  uint64_t dropped_;
+  double draw_time_sum_;  // s
+  double draw_time_max_;  // s
+};
+
+} // namespace kitti_utils
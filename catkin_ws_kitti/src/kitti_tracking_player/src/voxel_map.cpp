@@ -0,0 +1,256 @@
+/*
+ * @Description: Local map of the last scans in the world frame, downsampled in a voxel hash map
+ * @References:
+ */
+
+#include "voxel_map.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include <ros/console.h>
+
+#include "kitti_utils.h"
+
+namespace kitti_utils {
+
+namespace {
+const int kKeyBits = 21;
+const int64_t kKeyOffset = int64_t(1) << (kKeyBits - 1);
+const uint64_t kKeyMask = (uint64_t(1) << kKeyBits) - 1;
+// Keys use 63 bits, this one is never a voxel
+const uint64_t kEmptyKey = ~uint64_t(0);
+// Points hashed and prefetched together
+const size_t kBlockSize = 64;
+// Scans needed to sweep the whole table for aged voxels
+const size_t kSweepScans = 8;
+
+// MurmurHash3 finalizer, all the key bits (x, y and z) change the low bits used as slot
+inline size_t Hash(uint64_t key) {
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdull;
+  key ^= key >> 33;
+  key *= 0xc4ceb9fe1a85ec53ull;
+  key ^= key >> 33;
+  return static_cast<size_t>(key);
+}
+}
+
+VoxelMap::VoxelMap(float voxel_size, unsigned int max_age, size_t max_voxels)
+    : voxel_size_(voxel_size > 0.0f ? voxel_size : 0.1f),
+      inverse_voxel_size_(1.0f / voxel_size_),
+      max_age_(max_age > 0 ? max_age : 1),
+      max_voxels_(max_voxels > 8 ? max_voxels : 8),
+      sweep_cursor_(0),
+      size_(0),
+      num_inserts_(0),
+      num_points_(0),
+      insert_time_sum_(0.0),
+      insert_time_max_(0.0) {
+  size_t table_size = 1;
+  while (table_size < 2 * max_voxels_) {
+    table_size *= 2;
+  }
+  Voxel empty;
+  empty.key = kEmptyKey;
+  table_.assign(table_size, empty);
+  table_mask_ = table_size - 1;
+}
+
+uint64_t VoxelMap::Key(float x, float y, float z) const {
+  // Coordinates outside +-2^20 voxels wrap around, far beyond a KITTI sequence
+  uint64_t ix = static_cast<uint64_t>(static_cast<int64_t>(std::floor(x * inverse_voxel_size_)) + kKeyOffset) & kKeyMask;
+  uint64_t iy = static_cast<uint64_t>(static_cast<int64_t>(std::floor(y * inverse_voxel_size_)) + kKeyOffset) & kKeyMask;
+  uint64_t iz = static_cast<uint64_t>(static_cast<int64_t>(std::floor(z * inverse_voxel_size_)) + kKeyOffset) & kKeyMask;
+  return (ix << (2 * kKeyBits)) | (iy << kKeyBits) | iz;
+}
+
+size_t VoxelMap::FindSlot(uint64_t key, size_t home) const {
+  size_t slot = home;
+  while (table_[slot].key != key && table_[slot].key != kEmptyKey) {
+    slot = (slot + 1) & table_mask_;
+  }
+  return slot;
+}
+
+void VoxelMap::EraseSlot(size_t slot) {
+  // Backward shift deletion, no tombstones so the probe sequences stay short
+  size_t next = slot;
+  while (true) {
+    next = (next + 1) & table_mask_;
+    if (table_[next].key == kEmptyKey) {
+      break;
+    }
+    size_t home = Hash(table_[next].key) & table_mask_;
+    bool stays = slot <= next ? (slot < home && home <= next) : (slot < home || home <= next);
+    if (stays) {
+      continue;
+    }
+    table_[slot] = table_[next];
+    slot = next;
+  }
+  table_[slot].key = kEmptyKey;
+  --size_;
+}
+
+void VoxelMap::Insert(const sensor_msgs::PointCloud2& cloud, const Eigen::Isometry3d& velo_to_world, unsigned int frame) {
+  auto start = std::chrono::steady_clock::now();
+
+  SweepAged(frame);
+
+  const Eigen::Matrix3f rotation = velo_to_world.linear().cast<float>();
+  const Eigen::Vector3f translation = velo_to_world.translation().cast<float>();
+  const VeloPoint* points = GetVeloPoints(cloud);
+  const size_t num_points = GetVeloPointsSize(cloud);
+
+  Eigen::Vector3f world[kBlockSize];
+  uint64_t keys[kBlockSize];
+  size_t homes[kBlockSize];
+  for (size_t begin = 0; begin < num_points; begin += kBlockSize) {
+    const size_t count = std::min(kBlockSize, num_points - begin);
+    // Transform and hash the block, the table lines are loaded while the next points are hashed
+    for (size_t i = 0; i < count; ++i) {
+      const VeloPoint& p = points[begin + i];
+      world[i] = rotation * Eigen::Vector3f(p.x, p.y, p.z) + translation;
+      keys[i] = Key(world[i].x(), world[i].y(), world[i].z());
+      homes[i] = Hash(keys[i]) & table_mask_;
+      __builtin_prefetch(&table_[homes[i]], 1);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+      const float intensity = points[begin + i].intensity;
+      size_t slot = FindSlot(keys[i], homes[i]);
+      Voxel& voxel = table_[slot];
+      if (voxel.key == keys[i]) {
+        voxel.sum_x += world[i].x();
+        voxel.sum_y += world[i].y();
+        voxel.sum_z += world[i].z();
+        voxel.sum_intensity += intensity;
+        ++voxel.count;
+        voxel.last_frame = frame;
+        continue;
+      }
+      if (size_ >= max_voxels_) {
+        EvictOldest();
+        slot = FindSlot(keys[i], homes[i]);
+      }
+      Voxel& added = table_[slot];
+      added.key = keys[i];
+      added.sum_x = world[i].x();
+      added.sum_y = world[i].y();
+      added.sum_z = world[i].z();
+      added.sum_intensity = intensity;
+      added.count = 1;
+      added.last_frame = frame;
+      ++size_;
+    }
+  }
+
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  ++num_inserts_;
+  num_points_ += num_points;
+  insert_time_sum_ += elapsed;
+  insert_time_max_ = std::max(insert_time_max_, elapsed);
+}
+
+void VoxelMap::SweepAged(unsigned int frame) {
+  if (frame < max_age_) {
+    return;
+  }
+  const uint32_t min_frame = frame - max_age_ + 1;
+  size_t remaining = table_.size() / kSweepScans;
+  while (remaining > 0) {
+    const Voxel& voxel = table_[sweep_cursor_];
+    if (voxel.key != kEmptyKey && voxel.last_frame < min_frame) {
+      // A following voxel may be moved into this slot, check it again
+      EraseSlot(sweep_cursor_);
+    } else {
+      sweep_cursor_ = (sweep_cursor_ + 1) & table_mask_;
+      --remaining;
+    }
+  }
+}
+
+void VoxelMap::EvictBefore(uint32_t min_frame) {
+  size_t slot = 0;
+  while (slot < table_.size()) {
+    const Voxel& voxel = table_[slot];
+    if (voxel.key != kEmptyKey && voxel.last_frame < min_frame) {
+      // A following voxel may be moved into this slot, check it again
+      EraseSlot(slot);
+    } else {
+      ++slot;
+    }
+  }
+}
+
+void VoxelMap::EvictOldest() {
+  // Remove more than needed, so that this does not run again for the next new voxels
+  const size_t keep = max_voxels_ * 7 / 8;
+  std::vector<uint32_t> last_frames;
+  last_frames.reserve(size_);
+  for (const Voxel& voxel : table_) {
+    if (voxel.key != kEmptyKey) {
+      last_frames.push_back(voxel.last_frame);
+    }
+  }
+  std::vector<uint32_t>::iterator nth = last_frames.begin() + (last_frames.size() - keep);
+  std::nth_element(last_frames.begin(), nth, last_frames.end());
+  // Voxels of the same frame as the limit are kept, unless they are the most recent ones
+  uint32_t min_frame = *nth;
+  bool has_older = std::any_of(last_frames.begin(), last_frames.end(), [min_frame](uint32_t f) { return f < min_frame; });
+  EvictBefore(has_older ? min_frame : min_frame + 1);
+}
+
+void VoxelMap::ToCloud(sensor_msgs::PointCloud2& cloud) const {
+  if (cloud.fields.size() != 4) {
+    const char* names[4] = {"x", "y", "z", "intensity"};
+    cloud.fields.resize(4);
+    for (int i = 0; i < 4; ++i) {
+      cloud.fields[i].name = names[i];
+      cloud.fields[i].offset = i * sizeof(float);
+      cloud.fields[i].datatype = sensor_msgs::PointField::FLOAT32;
+      cloud.fields[i].count = 1;
+    }
+  }
+  cloud.data.resize(size_ * sizeof(VeloPoint));
+  VeloPoint* points = reinterpret_cast<VeloPoint*>(cloud.data.data());
+  size_t i = 0;
+  for (const Voxel& voxel : table_) {
+    if (voxel.key == kEmptyKey) {
+      continue;
+    }
+    const float inverse_count = 1.0f / voxel.count;
+    points[i].x = voxel.sum_x * inverse_count;
+    points[i].y = voxel.sum_y * inverse_count;
+    points[i].z = voxel.sum_z * inverse_count;
+    points[i].intensity = voxel.sum_intensity * inverse_count;
+    ++i;
+  }
+  cloud.height = 1;
+  cloud.width = size_;
+  cloud.point_step = sizeof(VeloPoint);
+  cloud.row_step = cloud.point_step * cloud.width;
+  cloud.is_bigendian = false;
+  cloud.is_dense = true;
+}
+
+void VoxelMap::Clear() {
+  for (Voxel& voxel : table_) {
+    voxel.key = kEmptyKey;
+  }
+  size_ = 0;
+}
+
+void VoxelMap::PrintStats() const {
+  if (num_inserts_ == 0) {
+    return;
+  }
+  ROS_INFO_STREAM("Voxel map (" << voxel_size_ << " m): " << size_ << " voxels, "
+                  << num_inserts_ << " scans inserted, mean " << insert_time_sum_ / num_inserts_ * 1e3
+                  << " ms, max " << insert_time_max_ * 1e3 << " ms, "
+                  << insert_time_sum_ / num_points_ * 1e9 << " ns/point");
+}
+
+} // namespace kitti_utils
@@ -0,0 +1,92 @@
+/*
+ * @Description: Local map of the last scans in the world frame, downsampled in a voxel hash map
+ * @References:
+ */
+#pragma once
+
+// C++
+#include <cstdint>
+#include <vector>
+// Eigen
+#include <Eigen/Geometry>
+// ROS
+#include <sensor_msgs/PointCloud2.h>
+
+namespace kitti_utils {
+
+/**
+ * @brief Accumulate velodyne scans in the world frame, one point (the centroid) per voxel.
+ *        The voxels live directly in an open addressing hash table keyed by their integer
+ *        coordinates, allocated once for max_voxels so the memory is bounded and a point
+ *        costs a single table access. Points are hashed in blocks and their slots prefetched.
+ *        Voxels not hit by any scan for max_age frames are removed by a sweep over 1/8 of the table
+ *        per scan (so within max_age + 8 frames), and when the map is full the least recently hit
+ *        voxels are removed first.
+ */
+class VoxelMap {
+public:
+  /**
+   * @param voxel_size edge length of a voxel (m)
+   * @param max_age number of frames a voxel is kept without being hit
+   * @param max_voxels maximum number of voxels kept, the table takes 64 bytes per voxel
+   */
+  VoxelMap(float voxel_size, unsigned int max_age, size_t max_voxels);
+
+  /**
+   * @brief Insert a cloud in the VeloPoint layout (ReadVeloPoints) and evict the old voxels
+   * @param velo_to_world pose of the velodyne in the world frame
+   * @param frame frame number, increasing, used as the age of the voxels
+   */
+  void Insert(const sensor_msgs::PointCloud2& cloud, const Eigen::Isometry3d& velo_to_world, unsigned int frame);
+
+  /// Fill cloud with one point per voxel in the VeloPoint layout, header not modified
+  void ToCloud(sensor_msgs::PointCloud2& cloud) const;
+
+  size_t size() const { return size_; }
+  void Clear();
+
+  /// Log the number of voxels and the time spent in Insert()
+  void PrintStats() const;
+
+private:
+  struct Voxel {
+    uint64_t key;  // kEmptyKey for a free slot
+    float sum_x;
+    float sum_y;
+    float sum_z;
+    float sum_intensity;
+    uint32_t count;
+    uint32_t last_frame;  // last frame hitting the voxel
+  };
+
+  /// Integer voxel coordinates, 21 bits each, packed in a 64 bits key
+  uint64_t Key(float x, float y, float z) const;
+  /// Slot of key, or the free slot where it would be inserted, probing from home
+  size_t FindSlot(uint64_t key, size_t home) const;
+  /// Free slot, moving back the following voxels of the probe sequence
+  void EraseSlot(size_t slot);
+  /// Remove the voxels older than max_age_ in the next part of the table
+  void SweepAged(unsigned int frame);
+  /// Remove the voxels whose last_frame is before min_frame
+  void EvictBefore(uint32_t min_frame);
+  /// Remove the least recently hit voxels until at most max_voxels * 7 / 8 are left
+  void EvictOldest();
+
+  float voxel_size_;
+  float inverse_voxel_size_;
+  unsigned int max_age_;
+  size_t max_voxels_;
+  size_t sweep_cursor_;
+  // Power of 2 size, at most half full
+  std::vector<Voxel> table_;
+  size_t table_mask_;
+  size_t size_;
+
+  // Statistics
+  uint64_t num_inserts_;
+  uint64_t num_points_;
+  double insert_time_sum_;  // s
+  double insert_time_max_;  // s
+};
+
+} // namespace kitti_utils
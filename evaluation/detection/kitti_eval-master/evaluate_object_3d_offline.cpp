@@ -1,13 +1,18 @@
 #include <iostream>
 #include <algorithm>
 #include <stdio.h>
+#include <stdlib.h>
 #include <math.h>
+#include <time.h>
 #include <vector>
 #include <numeric>
+#include <string.h>
 #include <strings.h>
 #include <assert.h>
 
 #include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
 
 #include <boost/numeric/ublas/matrix.hpp>
 #include <boost/numeric/ublas/io.hpp>
@@ -65,6 +70,30 @@ void initGlobals () {
   CLASS_NAMES.push_back("cyclist");
 }
 
+/*=======================================================================
+BENCHMARK MODE: TIME SPENT IN THE EVALUATION STAGES
+=======================================================================*/
+
+// stages of eval_class timed per metric, output includes saving the stats and the plot data
+enum STAGE{CLEAN=0, RECALL=1, THRESHOLDS=2, SWEEP=3, OUTPUT=4};
+const int NUM_STAGE = 5;
+const char *STAGE_NAMES[NUM_STAGE] = {"cleanData", "recall pass", "getThresholds", "threshold sweep", "output"};
+const char *METRIC_NAMES[3] = {"image", "ground", "3d"};
+
+bool    BENCHMARK = false;           // print the timings at the end of the evaluation
+bool    PLOT_CURVES = true;          // run gnuplot, ps2pdf and pdfcrop on the plot data
+double  LOAD_TIME = 0;               // loading ground truth and detections (s)
+double  STAGE_TIME[NUM_STAGE][3];    // per stage and metric (s)
+int64_t OVERLAP_CALLS[3];            // no. of box overlaps computed per metric
+volatile double OVERLAP_SINK = 0;    // keeps the timed overlaps from being optimized out
+
+// monotonic wall time (s)
+double getTime () {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
 /*=======================================================================
 DATA TYPES FOR EVALUATION
 =======================================================================*/
@@ -462,6 +491,7 @@ tPrData computeStatistics(CLASSES current_class, const vector<tGroundtruth> &gt,
 
   tPrData stat = tPrData();
   const double NO_DETECTION = -10000000;
+  int64_t n_overlap = 0;           // no. of computed overlaps, for the benchmark mode
   vector<double> delta;            // holds angular difference for TPs (needed for AOS evaluation)
   vector<bool> assigned_detection; // holds wether a detection was assigned to a valid or ignored ground truth
   assigned_detection.assign(det.size(), false);
@@ -502,6 +532,7 @@ tPrData computeStatistics(CLASSES current_class, const vector<tGroundtruth> &gt,
 
       // find the maximum score for the candidates and get idx of respective detection
       double overlap = boxoverlap(det[j], gt[i], -1);
+      n_overlap++;
 
       // for computing recall thresholds, the candidate with highest score is considered
       if(!compute_fp && overlap>MIN_OVERLAP[metric][current_class] && det[j].thresh>valid_detection){
@@ -579,6 +610,7 @@ tPrData computeStatistics(CLASSES current_class, const vector<tGroundtruth> &gt,
 
         // compute overlap and assign to stuff area, if overlap exceeds class specific value
         double overlap = boxoverlap(det[j], dc[i], 0);
+        n_overlap++;
         if(overlap>MIN_OVERLAP[metric][current_class]){
           assigned_detection[j] = true;
           nstuff++;
@@ -611,6 +643,7 @@ tPrData computeStatistics(CLASSES current_class, const vector<tGroundtruth> &gt,
         stat.similarity = -1;
     }
   }
+  OVERLAP_CALLS[metric] += n_overlap;
   return stat;
 }
 
@@ -640,10 +673,13 @@ bool eval_class (FILE *fp_det, FILE *fp_ori, CLASSES current_class,
     vector<tGroundtruth> dc;
 
     // only evaluate objects of current class and ignore occluded, truncated objects
+    double start = getTime();
     cleanData(current_class, groundtruth[i], detections[i], i_gt, dc, i_det, n_gt, difficulty);
     ignored_gt.push_back(i_gt);
     ignored_det.push_back(i_det);
     dontcare.push_back(dc);
+    double cleaned = getTime();
+    STAGE_TIME[CLEAN][metric] += cleaned - start;
 
     // compute statistics to get recall values
     tPrData pr_tmp = tPrData();
@@ -652,12 +688,16 @@ bool eval_class (FILE *fp_det, FILE *fp_ori, CLASSES current_class,
     // add detection scores to vector over all images
     for(int32_t j=0; j<pr_tmp.v.size(); j++)
       v.push_back(pr_tmp.v[j]);
+    STAGE_TIME[RECALL][metric] += getTime() - cleaned;
   }
 
   // get scores that must be evaluated for recall discretization
+  double start = getTime();
   thresholds = getThresholds(v, n_gt);
+  STAGE_TIME[THRESHOLDS][metric] += getTime() - start;
 
   // compute TP,FP,FN for relevant scores
+  start = getTime();
   vector<tPrData> pr;
   pr.assign(thresholds.size(),tPrData());
   for (int32_t i=0; i<groundtruth.size(); i++){
@@ -698,9 +738,12 @@ bool eval_class (FILE *fp_det, FILE *fp_ori, CLASSES current_class,
     if(compute_aos)
       aos[i] = *max_element(aos.begin()+i, aos.end());
   }
+  double swept = getTime();
+  STAGE_TIME[SWEEP][metric] += swept - start;
 
   // save statisics and finish with success
   saveStats(precision, aos, fp_det, fp_ori);
+  STAGE_TIME[OUTPUT][metric] += getTime() - swept;
     return true;
 }
 
@@ -721,6 +764,9 @@ void saveAndPlotPlots(string dir_name,string file_name,string obj_type,vector<do
           sum[v] += vals[v][i];
   printf("%s AP: %f %f %f\n", file_name.c_str(), sum[0] / 11 * 100, sum[1] / 11 * 100, sum[2] / 11 * 100);
 
+  // the benchmark mode only keeps the plot data
+  if (!PLOT_CURVES)
+    return;
 
   // create png + eps
   for (int32_t j=0; j<2; j++) {
@@ -791,10 +837,179 @@ vector<int32_t> getEvalIndices(const string& result_dir) {
     return indices;
 }
 
+/*=======================================================================
+BENCHMARK MODE: SYNTHETIC DATA AND REPORT
+=======================================================================*/
+
+// create a directory and its missing parents, like mkdir -p
+bool makeDirs (const string &path) {
+  for (size_t pos=path.find('/', 1); ; pos=path.find('/', pos+1)) {
+    string dir = path.substr(0, pos);
+    if (!dir.empty() && mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+      printf("ERROR: Couldn't create directory %s: %s\n", dir.c_str(), strerror(errno));
+      return false;
+    }
+    if (pos == string::npos)
+      return true;
+  }
+}
+
+// uniformly distributed random number in [a, b)
+double uniform (double a, double b) {
+  return a + (b - a) * rand() / ((double)RAND_MAX + 1.0);
+}
+
+// write a KITTI like data set of n_frames frames with n_boxes ground truth objects and n_boxes detections
+// per frame to gt_dir and result_dir/data: cars, pedestrians, cyclists, vans and dontcare areas, about
+// 80% of the objects are detected with some noise, the other detections are false positives
+bool synthesizeData (string gt_dir, string result_dir, int32_t n_frames, int32_t n_boxes) {
+
+  const int32_t N_TYPES = 5;
+  const char   *TYPES[N_TYPES]  = {"Car", "Pedestrian", "Cyclist", "Van", "DontCare"};
+  const double  FREQ[N_TYPES]   = {0.5, 0.2, 0.1, 0.1, 0.1};       // frequency of the types
+  const double  DIMS[N_TYPES][3] = {{1.5, 1.6, 3.9}, {1.75, 0.6, 0.8}, {1.7, 0.6, 1.8}, {2.2, 1.9, 5.0}, {0, 0, 0}}; // h, w, l
+  const double  FOCAL = 721.5, CX = 609.6, CY = 172.9;             // camera 2 of the KITTI object data set
+
+  if (!makeDirs(gt_dir) || !makeDirs(result_dir + "/data"))
+    return false;
+  srand(0);
+
+  for (int32_t f=0; f<n_frames; f++) {
+
+    char file_name[256];
+    sprintf(file_name,"/%06d.txt",f);
+    FILE *fp_gt  = fopen((gt_dir + file_name).c_str(),"w");
+    FILE *fp_det = fopen((result_dir + "/data" + file_name).c_str(),"w");
+    if (!fp_gt || !fp_det) {
+      printf("ERROR: Couldn't write: %s\n", file_name);
+      if (fp_gt)  fclose(fp_gt);
+      if (fp_det) fclose(fp_det);
+      return false;
+    }
+
+    int32_t n_det = 0;
+    for (int32_t i=0; i<n_boxes; i++) {
+
+      // draw the type
+      int32_t type = 0;
+      double r = uniform(0, 1);
+      while (type<N_TYPES-1 && r>=FREQ[type]) {
+        r -= FREQ[type];
+        type++;
+      }
+
+      // dontcare areas only have an image box
+      if (type==N_TYPES-1) {
+        double x1 = uniform(0, 1100), y1 = uniform(120, 220);
+        fprintf(fp_gt,"DontCare -1 -1 -10 %.2f %.2f %.2f %.2f -1 -1 -1 -1000 -1000 -1000 -10\n",
+                x1, y1, x1 + uniform(20, 120), y1 + uniform(10, 60));
+        continue;
+      }
+
+      // 3D box in camera coordinates in front of the camera and its projection in the image
+      double h = DIMS[type][0] * uniform(0.9, 1.1);
+      double w = DIMS[type][1] * uniform(0.9, 1.1);
+      double l = DIMS[type][2] * uniform(0.9, 1.1);
+      double t3 = uniform(5, 60);
+      double t1 = uniform(-0.5, 0.5) * t3;
+      double t2 = uniform(1.5, 1.8);
+      double ry = uniform(-M_PI, M_PI);
+      double alpha = ry - atan2(t1, t3);
+      double u = CX + FOCAL * t1 / t3;
+      double half_width = FOCAL * 0.5 * (fabs(l * sin(ry)) + fabs(w * cos(ry))) / t3;
+      double x1 = u - half_width, x2 = u + half_width;
+      double y1 = CY + FOCAL * (t2 - h) / t3, y2 = CY + FOCAL * t2 / t3;
+      double truncation = uniform(0, 0.6);
+      int32_t occlusion = rand() % 3;
+      fprintf(fp_gt,"%s %.2f %d %.2f %.2f %.2f %.2f %.2f %.2f %.2f %.2f %.2f %.2f %.2f %.2f\n",
+              TYPES[type], truncation, occlusion, alpha, x1, y1, x2, y2, h, w, l, t1, t2, t3, ry);
+
+      // detect it with some noise
+      if (n_det<n_boxes && uniform(0, 1)<0.8) {
+        double s = uniform(0.97, 1.03), du = uniform(-0.03, 0.03) * (x2 - x1);
+        fprintf(fp_det,"%s -1 -1 %.2f %.2f %.2f %.2f %.2f %.2f %.2f %.2f %.2f %.2f %.2f %.2f %.4f\n",
+                TYPES[type], alpha + uniform(-0.1, 0.1), x1 * s + du, y1 * s, x2 * s + du, y2 * s,
+                h * uniform(0.95, 1.05), w * uniform(0.95, 1.05), l * uniform(0.95, 1.05),
+                t1 + uniform(-0.2, 0.2), t2 + uniform(-0.1, 0.1), t3 + uniform(-0.4, 0.4),
+                ry + uniform(-0.1, 0.1), uniform(0.3, 1));
+        n_det++;
+      }
+    }
+
+    // false positives
+    for (; n_det<n_boxes; n_det++) {
+      int32_t type = rand() % 3;
+      double t3 = uniform(5, 60), t1 = uniform(-0.5, 0.5) * t3, t2 = uniform(1.5, 1.8);
+      double x1 = uniform(0, 1100), y1 = uniform(100, 200);
+      fprintf(fp_det,"%s -1 -1 %.2f %.2f %.2f %.2f %.2f %.2f %.2f %.2f %.2f %.2f %.2f %.2f %.4f\n",
+              TYPES[type], uniform(-M_PI, M_PI), x1, y1, x1 + uniform(20, 150), y1 + uniform(25, 120),
+              DIMS[type][0], DIMS[type][1], DIMS[type][2], t1, t2, t3, uniform(-M_PI, M_PI), uniform(0, 0.7));
+    }
+
+    fclose(fp_gt);
+    fclose(fp_det);
+  }
+  return true;
+}
+
+// average time (s) of one boxoverlap call, over the detection / ground truth pairs of the first frames
+double timeOverlap (const vector< vector<tGroundtruth> > &groundtruth, const vector< vector<tDetection> > &detections,
+                    double (*boxoverlap)(tDetection, tGroundtruth, int32_t)) {
+
+  const int64_t MAX_CALLS = 200000;
+  int64_t n = 0;
+  double sum = 0;
+  double start = getTime();
+  for (size_t i=0; i<groundtruth.size() && n<MAX_CALLS; i++)
+    for (size_t j=0; j<detections[i].size(); j++)
+      for (size_t k=0; k<groundtruth[i].size(); k++, n++)
+        sum += boxoverlap(detections[i][j], groundtruth[i][k], -1);
+  double elapsed = getTime() - start;
+  OVERLAP_SINK = sum;
+  return n>0 ? elapsed / n : 0;
+}
+
+// print the time spent in the evaluation stages per metric, the overlap time is estimated from the
+// no. of computed overlaps and the average time of an overlap
+void printBenchmark (const vector< vector<tGroundtruth> > &groundtruth, const vector< vector<tDetection> > &detections,
+                     const vector<bool> &eval_image, const vector<bool> &eval_ground, const vector<bool> &eval_3d,
+                     double total_time) {
+
+  int64_t n_gt = 0, n_det = 0;
+  for (size_t i=0; i<groundtruth.size(); i++) {
+    n_gt  += groundtruth[i].size();
+    n_det += detections[i].size();
+  }
+
+  // only the evaluated metrics are timed
+  double (*overlaps[3])(tDetection, tGroundtruth, int32_t) = {imageBoxOverlap, groundBoxOverlap, box3DOverlap};
+  const vector<bool> *evaluated[3] = {&eval_image, &eval_ground, &eval_3d};
+  double overlap_time[3] = {0, 0, 0};
+  for (int m = 0; m < 3; m++)
+    if (find(evaluated[m]->begin(), evaluated[m]->end(), true) != evaluated[m]->end())
+      overlap_time[m] = timeOverlap(groundtruth, detections, overlaps[m]);
+
+  printf("\nBenchmark: %d frames, %lld ground truth objects, %lld detections\n",
+         (int)groundtruth.size(), (long long)n_gt, (long long)n_det);
+  printf("  %-20s %12.1f ms\n", "load", LOAD_TIME * 1e3);
+  printf("  %-20s %12s %12s %12s\n", "stage (ms)", METRIC_NAMES[0], METRIC_NAMES[1], METRIC_NAMES[2]);
+  for (int s = 0; s < NUM_STAGE; s++)
+    printf("  %-20s %12.1f %12.1f %12.1f\n", STAGE_NAMES[s],
+           STAGE_TIME[s][0] * 1e3, STAGE_TIME[s][1] * 1e3, STAGE_TIME[s][2] * 1e3);
+  printf("  %-20s %12lld %12lld %12lld\n", "overlap calls",
+         (long long)OVERLAP_CALLS[0], (long long)OVERLAP_CALLS[1], (long long)OVERLAP_CALLS[2]);
+  printf("  %-20s %12.1f %12.1f %12.1f\n", "overlap (ns/call)",
+         overlap_time[0] * 1e9, overlap_time[1] * 1e9, overlap_time[2] * 1e9);
+  printf("  %-20s %12.1f %12.1f %12.1f\n", "overlap (est. ms)", OVERLAP_CALLS[0] * overlap_time[0] * 1e3,
+         OVERLAP_CALLS[1] * overlap_time[1] * 1e3, OVERLAP_CALLS[2] * overlap_time[2] * 1e3);
+  printf("  %-20s %12.1f ms\n", "total", total_time * 1e3);
+}
+
 bool eval(string gt_dir, string result_dir, Mail* mail) {
 
   // set some global parameters
   initGlobals();
+  double eval_start = getTime();
 
   // ground truth and result directories
   // string gt_dir         = "data/object/label_2";
@@ -817,6 +1032,7 @@ bool eval(string gt_dir, string result_dir, Mail* mail) {
 
   // for all images read groundtruth and detections
   mail->msg("Loading detections...");
+  double load_start = getTime();
   std::vector<int32_t> indices = getEvalIndices(result_dir + "/data/");
   printf("number of files for evaluation: %d\n", (int)indices.size());
 
@@ -844,6 +1060,7 @@ bool eval(string gt_dir, string result_dir, Mail* mail) {
       return false;
     }
   }
+  LOAD_TIME = getTime() - load_start;
   mail->msg("  done.");
 
   // holds pointers for result files
@@ -863,12 +1080,14 @@ bool eval(string gt_dir, string result_dir, Mail* mail) {
         mail->msg("%s evaluation failed.", CLASS_NAMES[c].c_str());
         return false;
       }
+      double start = getTime();
       fclose(fp_det);
       saveAndPlotPlots(plot_dir, CLASS_NAMES[c] + "_detection", CLASS_NAMES[c], precision, 0);
       if(compute_aos){
         saveAndPlotPlots(plot_dir, CLASS_NAMES[c] + "_orientation", CLASS_NAMES[c], aos, 1);
         fclose(fp_ori);
       }
+      STAGE_TIME[OUTPUT][IMAGE] += getTime() - start;
     }
   }
 
@@ -887,8 +1106,10 @@ bool eval(string gt_dir, string result_dir, Mail* mail) {
         mail->msg("%s evaluation failed.", CLASS_NAMES[c].c_str());
         return false;
       }
+      double start = getTime();
       fclose(fp_det);
       saveAndPlotPlots(plot_dir, CLASS_NAMES[c] + "_detection_ground", CLASS_NAMES[c], precision, 0);
+      STAGE_TIME[OUTPUT][GROUND] += getTime() - start;
     }
   }
 
@@ -904,26 +1125,56 @@ bool eval(string gt_dir, string result_dir, Mail* mail) {
         mail->msg("%s evaluation failed.", CLASS_NAMES[c].c_str());
         return false;
       }
+      double start = getTime();
       fclose(fp_det);
       saveAndPlotPlots(plot_dir, CLASS_NAMES[c] + "_detection_3d", CLASS_NAMES[c], precision, 0);
+      STAGE_TIME[OUTPUT][BOX3D] += getTime() - start;
     }
   }
 
+  if (BENCHMARK)
+    printBenchmark(groundtruth, detections, eval_image, eval_ground, eval_3d, getTime() - eval_start);
+
   // success
   return true;
 }
 
 int32_t main (int32_t argc,char *argv[]) {
 
-  // we need 2 or 4 arguments!
-  if (argc!=3) {
+  // benchmark mode: replay gt_dir and result_dir, or synthesize frames x boxes_per_frame objects into result_dir
+  bool benchmark = argc>1 && !strcmp(argv[1], "--benchmark");
+  if (benchmark) {
+    argc--;
+    argv++;
+  }
+
+  // we need 2 arguments, or 3 to synthesize the benchmark data
+  if (argc!=3 && !(benchmark && argc==4)) {
     cout << "Usage: ./eval_detection_3d_offline gt_dir result_dir" << endl;
+    cout << "       ./eval_detection_3d_offline --benchmark gt_dir result_dir" << endl;
+    cout << "       ./eval_detection_3d_offline --benchmark frames boxes_per_frame result_dir" << endl;
     return 1;
   }
 
   // read arguments
   string gt_dir = argv[1];
   string result_dir = argv[2];
+  if (benchmark) {
+    BENCHMARK = true;
+    PLOT_CURVES = false;
+  }
+  if (argc==4) {
+    int32_t n_frames = atoi(argv[1]), n_boxes = atoi(argv[2]);
+    result_dir = argv[3];
+    gt_dir = result_dir + "/label_2";
+    if (n_frames<=0 || n_boxes<=0) {
+      cout << "frames and boxes_per_frame must be positive" << endl;
+      return 1;
+    }
+    printf("Synthesizing %d frames with %d objects and %d detections each...\n", n_frames, n_boxes, n_boxes);
+    if (!synthesizeData(gt_dir, result_dir, n_frames, n_boxes))
+      return 1;
+  }
 
   // init notification mail
   Mail *mail;